@@ -27,6 +27,8 @@
 @class NESAPUEmulator;
 @class NESCartridge;
 
+#define NO_PENDING_IRQ 0xffffffff
+
 typedef struct cpuregs {
 	
 	uint8_t accumulator;
@@ -46,6 +48,13 @@ typedef struct cpuregs {
 	
 } CPURegisters;
 
+// What the APU's DMC fetches samples through: the cartridge's live PRGROM slot table, and the cycles those fetches
+// owe the CPU, which it charges at its next instruction boundary
+typedef struct {
+	uint8_t **prgromBankPointers;
+	uint_fast32_t stallCycles;
+} NESDMCFetch;
+
 typedef void (*StandardOpPointer)(CPURegisters *,uint8_t);
 typedef uint8_t (*WriteOpPointer)(CPURegisters *,uint8_t);
 typedef void (*OperationMethodPointer)(id, SEL, uint8_t);
@@ -53,7 +62,11 @@ typedef void (*OperationMethodPointer)(id, SEL, uint8_t);
 @interface NES6502Interpreter : NSObject {
 
 	CPURegisters *_cpuRegisters;
-	uint_fast32_t _nextIRQ;
+	uint_fast32_t _nextIRQ; // Earliest of the deadlines below, so one comparison per instruction covers every source
+	uint_fast32_t _nextMapperIRQ;
+	uint_fast32_t _nextAPUIRQ;
+	uint_fast32_t _nextDMCRead; // Cycle the DMC next fetches on, or 0 while fetch stalls are owed
+	NESDMCFetch _dmcFetch;
 	
 	uint8_t *_zeroPage;
 	uint8_t *_stack;
@@ -72,6 +85,15 @@ typedef void (*OperationMethodPointer)(id, SEL, uint8_t);
 	OperationMethodPointer *_operationMethods;
 	SEL *_operationSelectors;
 	uint8_t (*_readByteFromCPUAddressSpace)(id, SEL, uint16_t);
+	void (*_writeByteToCPUAddressSpace)(id, SEL, uint8_t, uint16_t);
+	uint8_t (*_readByteFromPPU)(id, SEL, uint16_t, uint_fast32_t);
+	void (*_writeByteToPPU)(id, SEL, uint8_t, uint16_t, uint_fast32_t);
+	uint_fast32_t (*_nextDMCReadCycle)(id, SEL);
+	
+	// Mapper entry points resolved once per cartridge, NULL where the mapper keeps NESCartridge's behavior
+	void (*_writeByteToWRAM)(id, SEL, uint8_t, uint16_t, uint_fast32_t);
+	void (*_writeByteToPRGROM)(id, SEL, uint8_t, uint16_t, uint_fast32_t);
+	void (*_servicedInterruptOnCycle)(id, SEL, uint_fast32_t);
 	
 	NESCartridge *cartridge;
 	NESPPUEmulator *ppu;
@@ -99,8 +121,9 @@ typedef void (*OperationMethodPointer)(id, SEL, uint8_t);
 - (void)setProgramCounter:(uint16_t)jump;
 - (void)_performNonMaskableInterrupt;
 - (void)setData:(uint_fast32_t)data forController:(int)index;
-- (void)stealCycles:(uint_fast32_t)cycles;
+- (NESDMCFetch *)dmcFetch;
 - (void)setNextIRQ:(uint_fast32_t)cycles;
+- (void)setNextAPUIRQ:(uint_fast32_t)cycle; // Cycle of this frame the APU asserts IRQ on, NO_PENDING_IRQ if none
 
 @property(nonatomic) BOOL encounteredBreakpoint;
 
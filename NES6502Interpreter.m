@@ -26,8 +26,6 @@
 #import "NESPPUEmulator.h"
 #import "NESAPUEmulator.h"
 
-#define NO_PENDING_IRQ 0xffffffff
-
 static void _ADC(CPURegisters *cpuRegisters, uint8_t operand) {
 	
 	uint8_t oldAccumulator = cpuRegisters->accumulator;
@@ -273,7 +271,9 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 - (void)_clearStatus
 {
 	_cpuRegisters->cycle = 0;
-	_nextIRQ = NO_PENDING_IRQ;
+	_nextIRQ = _nextMapperIRQ = _nextAPUIRQ = NO_PENDING_IRQ;
+	_nextDMCRead = 0;
+	_dmcFetch.stallCycles = 0;
 	breakPoint = 0;
 	_encounteredUnsupportedOpcode = NO;
 	_encounteredBreakpoint = NO;
@@ -295,6 +295,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 		switch (address) {
 		
 			case 0x4015:
+				_nextDMCRead = 0; // The read may have fetched, leave charging that to the next instruction boundary
 				return [apu readAPUStatusOnCycle:_cpuRegisters->cycle];
 				break;
 			case 0x4016:
@@ -307,7 +308,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 				break;
 		}
 	}
-	else return [ppu readByteFromCPUAddress:address onCycle:_cpuRegisters->cycle];
+	else return _readByteFromPPU(ppu,@selector(readByteFromCPUAddress:onCycle:),address,_cpuRegisters->cycle);
 	
 	return 0;
 }
@@ -327,7 +328,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	
 		_zeroPage[address & 0x07FF] = byte;
 	}
-	else if (address < 0x4000) [ppu writeByte:byte toPPUFromCPUAddress:address onCycle:_cpuRegisters->cycle];
+	else if (address < 0x4000) _writeByteToPPU(ppu,@selector(writeByte:toPPUFromCPUAddress:onCycle:),byte,address,_cpuRegisters->cycle);
 	else if (address < 0x4020) {
 		
 		if (address == 0x4014) {
@@ -364,16 +365,18 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 		
 			// Write to APU Register (0x4000-0x4017, except 0x4014 and 0x4016)
 			[apu writeByte:byte toAPUFromCPUAddress:address onCycle:_cpuRegisters->cycle];
+			_nextDMCRead = 0; // Writes can start, stop or retime the DMC
 		}
 	}
 	else if (address < 0x6000) return;
 	else if (address < 0x8000) {
 		
-		[cartridge writeByte:byte toWRAMwithCPUAddress:address onCycle:_cpuRegisters->cycle];
+		if (_writeByteToWRAM) _writeByteToWRAM(cartridge,@selector(writeByte:toWRAMwithCPUAddress:onCycle:),byte,address,_cpuRegisters->cycle);
+		else _wram[address & (WRAM_SIZE - 1)] = byte;
 	}
-	else {
+	else if (_writeByteToPRGROM) {
 		
-		[cartridge writeByte:byte toPRGROMwithCPUAddress:address onCycle:_cpuRegisters->cycle];
+		_writeByteToPRGROM(cartridge,@selector(writeByte:toPRGROMwithCPUAddress:onCycle:),byte,address,_cpuRegisters->cycle);
 	}
 }
 
@@ -492,7 +495,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	uint16_t address = [self readAddressFromCPUAddressSpace:_cpuRegisters->programCounter];
 	_cpuRegisters->programCounter += 2;
 	_cpuRegisters->cycle += 4;
-	[self writeByte:_writeOperations[opcode](_cpuRegisters,opcode) toCPUAddress:address];
+	_writeByteToCPUAddressSpace(self,@selector(writeByte:toCPUAddress:),_writeOperations[opcode](_cpuRegisters,opcode),address);
 }
 
 - (void)_performWriteOperationWithAbsoluteX:(uint8_t)opcode
@@ -501,7 +504,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	uint16_t indexedAddress = absoluteAddress + _cpuRegisters->indexRegisterX;
 	_cpuRegisters->cycle += 5;
 	_cpuRegisters->programCounter += 2;
-	[self writeByte:_writeOperations[opcode](_cpuRegisters,opcode) toCPUAddress:indexedAddress];
+	_writeByteToCPUAddressSpace(self,@selector(writeByte:toCPUAddress:),_writeOperations[opcode](_cpuRegisters,opcode),indexedAddress);
 }
 
 - (void)_performWriteOperationWithAbsoluteY:(uint8_t)opcode
@@ -510,7 +513,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	uint16_t indexedAddress = absoluteAddress + _cpuRegisters->indexRegisterY;
 	_cpuRegisters->cycle += 5;
 	_cpuRegisters->programCounter += 2;
-	[self writeByte:_writeOperations[opcode](_cpuRegisters,opcode) toCPUAddress:indexedAddress];
+	_writeByteToCPUAddressSpace(self,@selector(writeByte:toCPUAddress:),_writeOperations[opcode](_cpuRegisters,opcode),indexedAddress);
 }
 
 - (void)_performWriteOperationWithZeroPage:(uint8_t)opcode
@@ -544,7 +547,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 {
 	uint16_t effectiveAddress = _zeroPage[(uint8_t)(_readByteFromCPUAddressSpace(self,@selector(readByteFromCPUAddressSpace:),_cpuRegisters->programCounter) + _cpuRegisters->indexRegisterX)]; // Fetch ADL
 	effectiveAddress += (_zeroPage[(uint8_t)(_readByteFromCPUAddressSpace(self,@selector(readByteFromCPUAddressSpace:),_cpuRegisters->programCounter++) + _cpuRegisters->indexRegisterX + 1)] << 8); // Fetch ADH
-	[self writeByte:_writeOperations[opcode](_cpuRegisters,opcode) toCPUAddress:effectiveAddress];
+	_writeByteToCPUAddressSpace(self,@selector(writeByte:toCPUAddress:),_writeOperations[opcode](_cpuRegisters,opcode),effectiveAddress);
 	
 	_cpuRegisters->cycle += 6;
 }
@@ -562,7 +565,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	uint16_t absoluteAddress = _zeroPage[_readByteFromCPUAddressSpace(self,@selector(readByteFromCPUAddressSpace:),_cpuRegisters->programCounter)]; // Fetch BAL
 	absoluteAddress += (_zeroPage[(uint8_t)(_readByteFromCPUAddressSpace(self,@selector(readByteFromCPUAddressSpace:),_cpuRegisters->programCounter++) + 1)] << 8); // Fetch BAH
 	effectiveAddress = absoluteAddress + _cpuRegisters->indexRegisterY; // Add IndexRegisterY to BAH,BAL, potential page crossing
-	[self writeByte:_writeOperations[opcode](_cpuRegisters,opcode) toCPUAddress:effectiveAddress];
+	_writeByteToCPUAddressSpace(self,@selector(writeByte:toCPUAddress:),_writeOperations[opcode](_cpuRegisters,opcode),effectiveAddress);
 	
 	_cpuRegisters->cycle += 6;
 }
@@ -573,7 +576,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	uint16_t address = [self readAddressFromCPUAddressSpace:_cpuRegisters->programCounter];
 	uint8_t value = _writeOperations[opcode](_cpuRegisters,_readByteFromCPUAddressSpace(self,@selector(readByteFromCPUAddressSpace:),address));
 	_cpuRegisters->programCounter += 2;
-	[self writeByte:value toCPUAddress:address];
+	_writeByteToCPUAddressSpace(self,@selector(writeByte:toCPUAddress:),value,address);
 	
 	_cpuRegisters->cycle += 6; // Read-Modify-Write Absolute operations take 6 cycles
 }
@@ -585,7 +588,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	uint16_t indexedAddress = absoluteAddress + _cpuRegisters->indexRegisterX;
 	uint8_t value = _writeOperations[opcode](_cpuRegisters,_readByteFromCPUAddressSpace(self,@selector(readByteFromCPUAddressSpace:),indexedAddress));
 	_cpuRegisters->programCounter += 2;
-	[self writeByte:value toCPUAddress:indexedAddress];
+	_writeByteToCPUAddressSpace(self,@selector(writeByte:toCPUAddress:),value,indexedAddress);
 	
 	_cpuRegisters->cycle += 7; // Read-Modify-Write ZeroPage operations take a full 7 cycles
 }
@@ -979,6 +982,31 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	_cpuRegisters->cycle += 7;
 }
 
+/* _serviceDMC
+ * Lets the APU make the DMC fetches that have come due, charges the cycles they stalled the CPU for and asks for the
+ * cycle of the next one, so between fetches the interpreter only compares cycle counts.
+ */
+- (void)_serviceDMC
+{
+	[apu runAPUUntilCPUCycle:_cpuRegisters->cycle];
+	_cpuRegisters->cycle += _dmcFetch.stallCycles;
+	_dmcFetch.stallCycles = 0;
+	_nextDMCRead = _nextDMCReadCycle(apu,@selector(nextDMCReadCycle));
+}
+
+/* _serviceInterrupt
+ * Takes an IRQ once the earliest deadline has passed. Mapper IRQs are acknowledged by rescheduling, while the APU holds
+ * its line until the game reads $4015 or writes $4017/$4010, which republishes the deadline through setNextAPUIRQ:.
+ */
+- (void)_serviceInterrupt
+{
+	BOOL mapperIRQ = (_cpuRegisters->cycle >= _nextMapperIRQ);
+	
+	if (mapperIRQ) [ppu recordMapperIRQOnCycle:_cpuRegisters->cycle];
+	[self _performInterrupt];
+	if (mapperIRQ && _servicedInterruptOnCycle) _servicedInterruptOnCycle(cartridge,@selector(servicedInterruptOnCycle:),_cpuRegisters->cycle);
+}
+
 - (void)_performNonMaskableInterrupt
 {
 	_cpuRegisters->statusBreak = 0; // Break is not set for NMI http://www.6502.org/tutorials/register_preservation.html
@@ -1392,6 +1420,14 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	_operationMethods[0xFF] = (void (*)(id, SEL, uint8_t))[self methodForSelector:@selector(_unsupportedOpcode:)]; // ??
 	
 	_readByteFromCPUAddressSpace = (uint8_t (*)(id, SEL, uint16_t))[self methodForSelector:@selector(readByteFromCPUAddressSpace:)];
+	_writeByteToCPUAddressSpace = (void (*)(id, SEL, uint8_t, uint16_t))[self methodForSelector:@selector(writeByte:toCPUAddress:)];
+	_readByteFromPPU = (uint8_t (*)(id, SEL, uint16_t, uint_fast32_t))[ppu methodForSelector:@selector(readByteFromCPUAddress:onCycle:)];
+	_writeByteToPPU = (void (*)(id, SEL, uint8_t, uint16_t, uint_fast32_t))[ppu methodForSelector:@selector(writeByte:toPPUFromCPUAddress:onCycle:)];
+	_nextDMCReadCycle = (uint_fast32_t (*)(id, SEL))[apu methodForSelector:@selector(nextDMCReadCycle)];
+	_dmcFetch.prgromBankPointers = NULL;
+	_writeByteToWRAM = NULL;
+	_writeByteToPRGROM = NULL;
+	_servicedInterruptOnCycle = NULL;
 	
 	return self;
 }
@@ -1408,6 +1444,13 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	[super dealloc];
 }
 
+- (IMP)_mapperMethodForSelector:(SEL)selector
+{
+	IMP method = [cartridge methodForSelector:selector];
+	
+	return (method == [NESCartridge instanceMethodForSelector:selector]) ? NULL : method;
+}
+
 - (void)setCartridge:(NESCartridge *)cart
 {
 	[cart retain];
@@ -1415,7 +1458,14 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	cartridge = cart;
 	
 	_prgromBankPointers = [cartridge prgromBankPointers];
+	_dmcFetch.prgromBankPointers = _prgromBankPointers;
 	_wram = [cartridge wram]; // FIXME: This assumes we have WRAM, which isn't a great assumption.
+	
+	// Resolve the mapper's handlers once so memory access never goes through a message send. Handlers the subclass
+	// doesn't override are left NULL: WRAM writes are then stored inline and PRGROM writes and IRQ acknowledgements dropped.
+	_writeByteToWRAM = (void (*)(id, SEL, uint8_t, uint16_t, uint_fast32_t))[self _mapperMethodForSelector:@selector(writeByte:toWRAMwithCPUAddress:onCycle:)];
+	_writeByteToPRGROM = (void (*)(id, SEL, uint8_t, uint16_t, uint_fast32_t))[self _mapperMethodForSelector:@selector(writeByte:toPRGROMwithCPUAddress:onCycle:)];
+	_servicedInterruptOnCycle = (void (*)(id, SEL, uint_fast32_t))[self _mapperMethodForSelector:@selector(servicedInterruptOnCycle:)];
 }
  
 - (void)reset
@@ -1425,6 +1475,7 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	[self _clearStatus];
 	_cpuRegisters->programCounter = [self readAddressFromCPUAddressSpace:0xfffc];
 	_cpuRegisters->cycle = 8;
+	[apu republishIRQDeadline]; // The APU keeps running through a CPU reset, so its pending IRQ must survive the clear
 }
 
 - (uint16_t)breakPoint
@@ -1448,14 +1499,13 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	
 	while (_cpuRegisters->cycle < cycle) {
 			
-		if ([apu pendingDMCReadsOnCycle:_cpuRegisters->cycle]) {
+		if (_cpuRegisters->cycle >= _nextDMCRead) {
 			
-			[apu runAPUUntilCPUCycle:_cpuRegisters->cycle];
+			[self _serviceDMC];
 		}
 		else if ((_cpuRegisters->cycle >= _nextIRQ) && !_cpuRegisters->statusIRQDisable) {
 		
-			[self _performInterrupt];
-			[cartridge servicedInterruptOnCycle:_cpuRegisters->cycle];
+			[self _serviceInterrupt];
 		}
 		else {
 			
@@ -1467,23 +1517,23 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	return _cpuRegisters->cycle;
 }
 
-- (void)resetCPUCycleCounter {
+// Moves an IRQ deadline into the next frame's cycles; one already due is kept pending from its start
+static inline uint_fast32_t rebaseIRQDeadline(uint_fast32_t deadline, uint_fast32_t frameCycles) {
 	
-	if (_nextIRQ != NO_PENDING_IRQ) {
+	if (deadline == NO_PENDING_IRQ) return NO_PENDING_IRQ;
 	
-		if (_nextIRQ < _cpuRegisters->cycle) {
-		
-			// If there is a pending interrupt, set it for the beginning next frame
-			_nextIRQ = 0;
-		}
-		else {
-		
-			// If the interrupt has yet to occur, set for the next frame
-			_nextIRQ -= _cpuRegisters->cycle;
-		}
-	}
+	return (deadline < frameCycles) ? 0 : deadline - frameCycles;
+}
+
+- (void)resetCPUCycleCounter {
+	
+	_nextMapperIRQ = rebaseIRQDeadline(_nextMapperIRQ,_cpuRegisters->cycle);
+	_nextAPUIRQ = rebaseIRQDeadline(_nextAPUIRQ,_cpuRegisters->cycle);
+	_nextIRQ = MIN(_nextMapperIRQ,_nextAPUIRQ);
+	_nextDMCRead = 0; // Fetches made ending the APU frame are charged to the start of the next
 	
 	_cpuRegisters->cycle = 0;
+	[cartridge frameEnded];
 }
 
 - (uint_fast32_t)executeUntilCycleWithBreak:(uint_fast32_t)cycle
@@ -1499,14 +1549,13 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 {
 	uint8_t opcode;
 	
-	if ([apu pendingDMCReadsOnCycle:_cpuRegisters->cycle]) {
+	if (_cpuRegisters->cycle >= _nextDMCRead) {
 		
-		[apu runAPUUntilCPUCycle:_cpuRegisters->cycle];
+		[self _serviceDMC];
 	}
 	else if ((_cpuRegisters->cycle >= _nextIRQ) && !_cpuRegisters->statusIRQDisable) {
 		
-		[self _performInterrupt];
-		[cartridge servicedInterruptOnCycle:_cpuRegisters->cycle];
+		[self _serviceInterrupt];
 	}
 	else {
 	
@@ -1532,15 +1581,22 @@ static uint8_t _GetIndexRegisterY(CPURegisters *cpuRegisters, uint8_t operand) {
 	_controllers[index] = data;
 }
 
-- (void)stealCycles:(uint_fast32_t)cycles
+- (NESDMCFetch *)dmcFetch
 {
-	_cpuRegisters->cycle += cycles;
+	return &_dmcFetch;
 }
 
 - (void)setNextIRQ:(uint_fast32_t)cycles
 {
-	if (cycles != NO_PENDING_IRQ) _nextIRQ = _cpuRegisters->cycle + cycles;
-	else _nextIRQ = NO_PENDING_IRQ;
+	if (cycles != NO_PENDING_IRQ) _nextMapperIRQ = _cpuRegisters->cycle + cycles;
+	else _nextMapperIRQ = NO_PENDING_IRQ;
+	_nextIRQ = MIN(_nextMapperIRQ,_nextAPUIRQ);
+}
+
+- (void)setNextAPUIRQ:(uint_fast32_t)cycle
+{
+	_nextAPUIRQ = cycle;
+	_nextIRQ = MIN(_nextMapperIRQ,_nextAPUIRQ);
 }
 
 @end
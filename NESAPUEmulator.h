@@ -27,17 +27,44 @@
 #import <AudioToolbox/AudioToolbox.h>
 #include "nes_apu/Nes_Apu.h"
 #include "nes_apu/Blip_Buffer.h"
+#include "nes_apu/Nes_Vrc6.h"
+#include "nes_apu/Nes_Namco.h"
+#include "NESAudioRing.h"
+#include "NESAudioPacing.h"
+#include "NESResampler.h"
 
 #define NUM_BUFFERS 3
+#define NES_APU_SYNTHESIS_RATE 44100 // Blip_Buffer's rate, which the device plays directly unless another is set
 
 @class NES6502Interpreter;
 
-typedef uint8_t (*CPUMemoryReadPointer)(id, SEL, uint16_t);
+#define NO_PENDING_DMC_READ 0xffffffff
+
+typedef enum {
+	
+	NESNoExpansionAudio = 0,
+	NESVRC6ExpansionAudio = 1 << 0,
+	NESNamcoExpansionAudio = 1 << 1
+	
+} NESExpansionAudioChips;
+
+typedef struct {
+	
+	uint32_t frames;
+	uint32_t expansionFrames; // Frames that had expansion chips to end
+	double apuSeconds; // Ending the APU's frames
+	double expansionSeconds; // Ending the expansion chips' frames
+	double mixSeconds; // Ending the shared Blip_Buffer's frames and moving their samples to the ring
+	
+} NESAudioMixTelemetry;
+
+typedef void (*CPUSetIRQPointer)(id, SEL, uint_fast32_t);
 
 typedef struct {
 	NES6502Interpreter *cpuInterpreter;
-	CPUMemoryReadPointer memoryReadFunction;
-} NESMemoryReader;
+	CPUSetIRQPointer setIRQFunction;
+	Nes_Apu *apu;
+} NESIRQNotifier;
 
 typedef struct {
     AudioStreamBasicDescription   dataFormat;
@@ -47,7 +74,7 @@ typedef struct {
     UInt32                        numPacketsToRead;
 	SInt64						  packetsToPlay;
     BOOL                          isRunning;
-	Blip_Buffer* blipBuffer;
+	NESAudioRing *ring; // Finished PCM, written by endFrameOnCycle: and read only by the output callback
 } NESAPUState;
 
 static void HandleOutputBuffer (
@@ -60,34 +87,82 @@ static void HandleOutputBuffer (
 	
 	Nes_Apu *nesAPU;
 	Blip_Buffer *blipBuffer;
+	Nes_Vrc6 *_vrc6; // Expansion chips, NULL unless the cartridge carries them
+	Nes_Namco *_namco;
 	NESAPUState *nesAPUState;
 	
 	blip_time_t time;
 	uint_fast32_t _lastCPUCycle;
 	uint8_t _apuStatus;
+	
+	NESResampler *_resampler; // Converts to the device rate, NULL while that is the synthesis rate
+	NESRateController _rateController;
+	NESAudioPacingTelemetry _pacingTelemetry;
+	uint64_t _lastFrameEndTime;
+	NESAudioMixTelemetry _mixTelemetry;
+	double _secondsPerTick;
+	
+	BOOL _synthesizesAudio;
+	NESIRQNotifier _irqNotifier;
 }
 
 - (void)beginAPUPlayback;
 - (void)stopAPUPlayback;
 
-// Set function for APU to call when it needs to read memory (DMC samples)
+// Have the DMC fetch samples straight from the CPU's PRGROM banks, and the CPU track the APU's IRQ deadline
 -(void)setDMCReadObject:(NES6502Interpreter *)cpu;
+- (void)republishIRQDeadline;
+
+// With synthesis off only what the CPU observes is emulated ($4015, frame and DMC IRQs, DMC fetches); no audio is produced
+- (void)setSynthesizesAudio:(BOOL)flag;
+- (BOOL)synthesizesAudio;
 
-// Set output sample rate
+// Set the device's sample rate, resampling to it from the synthesis rate if they differ (0 for the synthesis rate).
+// Rebuilds the audio queue, so call it while playback is stopped; returns NO and keeps the old rate if it can't.
 - (BOOL)setOutputSampleRate:(long)rate;
 
 // Write to register (0x4000-0x4017, except 0x4014 and 0x4016)
 - (void)writeByte:(uint8_t)byte toAPUFromCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle;
 
+// Sound chips the cartridge carries, replacing any earlier ones. They share the APU's Blip_Buffer and CPU cycle time base,
+// so the mapper's register writes use the same cycles as the APU's, and all are ended in endFrameOnCycle:'s one pass.
+- (void)setExpansionAudio:(NESExpansionAudioChips)chips;
+- (NESExpansionAudioChips)expansionAudio;
+
+// VRC6 oscillator registers ($9000-$9002, $A000-$A002, $B000-$B002)
+- (void)writeByte:(uint8_t)byte toVRC6Oscillator:(int)oscillator register:(int)reg onCycle:(uint_fast32_t)cycle;
+
+// Namco 163 data port ($4800) and write-only address port ($F800)
+- (void)writeByte:(uint8_t)byte toNamcoDataOnCycle:(uint_fast32_t)cycle;
+- (uint8_t)readNamcoData;
+- (void)writeNamcoAddress:(uint8_t)byte;
+
 // Read from status register at 0x4015
 - (uint8_t)readAPUStatusOnCycle:(uint_fast32_t)cycle;
 
-// End a 1/60 sound frame
+// End a 1/60 sound frame, returning seconds to add to the next frame period
 - (double)endFrameOnCycle:(uint_fast32_t)cycle;
 
 // Number of samples in buffer
 - (long)numberOfBufferedSamples;
 
+// Underruns, overruns and fill level of the ring feeding the audio queue
+- (NESAudioRingStatistics)audioRingStatistics;
+- (void)getAudioRingFillHistogram:(uint32_t *)bins; // NES_AUDIO_RING_HISTOGRAM_BINS counts, lowest fill first
+- (void)resetAudioRingStatistics;
+
+// Frame intervals, fill level and resampling adjustments seen by the pacing controller
+- (NESAudioPacingTelemetry)pacingTelemetry;
+- (void)resetPacingTelemetry;
+
+// CPU cycles each oscillator (square 1, square 2, triangle, noise, DMC) skipped without synthesis while silent or halted
+- (void)getIdleCycles:(long *)cycles; // Nes_Apu::osc_count counts
+- (void)resetIdleCycles;
+
+// Time spent ending audio frames, split between the APU, the expansion chips and the shared mix
+- (NESAudioMixTelemetry)mixTelemetry;
+- (void)resetMixTelemetry;
+
 - (void)clearBuffer;
 
 - (void)pause;
@@ -97,7 +172,7 @@ static void HandleOutputBuffer (
 - (void)saveSnapshot;
 - (void)loadSnapshot;
 
-- (int)pendingDMCReadsOnCycle:(uint_fast32_t)cycle;
+- (uint_fast32_t)nextDMCReadCycle; // Cycle the DMC next fetches a sample byte on, or NO_PENDING_DMC_READ
 - (void)runAPUUntilCPUCycle:(uint_fast32_t)cycle;
 
 @end
@@ -24,12 +24,24 @@
 
 #import "NESAPUEmulator.h"
 #import "NES6502Interpreter.h"
+#import "NESCartridge.h"
+#import <mach/mach_time.h>
 
-static int dmc_read_function( void* memoryReader, cpu_addr_t cpuAddress)
+// Samples always come from $8000-$FFFF, so the fetch is a bank table lookup; the CPU charges its stall cycles itself
+static int dmc_read_function( void* dmcFetch, cpu_addr_t cpuAddress)
 {
-	NESMemoryReader *memoryReadStructure = (NESMemoryReader *)memoryReader;
-	[memoryReadStructure->cpuInterpreter stealCycles:4];
-	return memoryReadStructure->memoryReadFunction(memoryReadStructure->cpuInterpreter,@selector(readByteFromCPUAddressSpace:),(uint16_t)cpuAddress);
+	NESDMCFetch *fetch = (NESDMCFetch *)dmcFetch;
+	fetch->stallCycles += 4;
+	return fetch->prgromBankPointers[(cpuAddress & 0x7FFF) / PRGROM_BANK_SIZE][cpuAddress & (PRGROM_BANK_SIZE - 1)];
+}
+
+// Called by Nes_Apu whenever its earliest IRQ may have moved, so the CPU never has to poll the APU for IRQs
+static void apu_irq_changed( void* irqNotifier )
+{
+	NESIRQNotifier *notifier = (NESIRQNotifier *)irqNotifier;
+	cpu_time_t irq = notifier->apu->earliest_irq();
+	
+	notifier->setIRQFunction(notifier->cpuInterpreter,@selector(setNextAPUIRQ:),(irq == Nes_Apu::no_irq) ? NO_PENDING_IRQ : (uint_fast32_t)irq);
 }
 
 static void HandleOutputBuffer (
@@ -37,37 +49,22 @@ static void HandleOutputBuffer (
 								AudioQueueRef       inAQ,
 								AudioQueueBufferRef inBuffer
 ) {
-	// UInt32 bytesToRead;
-	UInt32 bytesRead = 0;
-	UInt32 samplesRead;
-	UInt32 availableSamples;
     NESAPUState *pAqData = (NESAPUState *)aqData;
    
 	// NSLog(@"In HandleOutputBuffer");
 	
 	if (!pAqData->isRunning) {
 		
-		bytesRead = pAqData->bufferByteSize;
 		bzero(inBuffer->mAudioData,pAqData->bufferByteSize);
 		// NSLog(@"NES APU is not running. Filling buffer with zeros.");	
 	}
 	else {
 		
-		availableSamples = pAqData->blipBuffer->samples_avail();
-		if (availableSamples < pAqData->numPacketsToRead) {
-			
-			NSLog(@"Insufficient audio samples for buffering. Inserting silence.");
-			bytesRead = pAqData->bufferByteSize;
-			bzero(inBuffer->mAudioData,pAqData->bufferByteSize);
-		}
-		else {
-			
-			samplesRead = pAqData->blipBuffer->read_samples((blip_sample_t*)inBuffer->mAudioData,pAqData->numPacketsToRead);
-			bytesRead = samplesRead * 2; // As each sample is 16-bits
-		}
+		// Only copies out of the ring; a shortfall is padded with silence and counted as an underrun
+		NESAudioRingRead(pAqData->ring,(int16_t *)inBuffer->mAudioData,pAqData->numPacketsToRead);
 	}
 			
-	inBuffer->mAudioDataByteSize = bytesRead;
+	inBuffer->mAudioDataByteSize = pAqData->bufferByteSize;
 	AudioQueueEnqueueBuffer ( 
 								pAqData->queue,
 								inBuffer,
@@ -99,6 +96,7 @@ static void HandleOutputBuffer (
 	
 	// Set buffer size
 	nesAPUState->numPacketsToRead = [(NSNumber *)[[NSUserDefaults standardUserDefaults] valueForKey:@"audioBufferLength"] unsignedIntValue]; // 44.1kHz at 60 fps = 735 (times 4 to reduce overhead)
+	nesAPUState->numPacketsToRead = (UInt32)((nesAPUState->numPacketsToRead * nesAPUState->dataFormat.mSampleRate) / NES_APU_SYNTHESIS_RATE); // Same latency at other device rates
 	nesAPUState->bufferByteSize = nesAPUState->numPacketsToRead * 2; // 735 samples times four, times 16-bits per sample
 	
 	// Allocate those bufferes
@@ -122,19 +120,25 @@ static void HandleOutputBuffer (
 
 - (id)init {
 
+	mach_timebase_info_data_t timebase;
+	
 	if ([super init]) {
 		
 		time = 0;
 		
 		nesAPU = new Nes_Apu();
+		_vrc6 = NULL;
+		_namco = NULL;
 		blipBuffer = new Blip_Buffer();
-		blipBuffer->clock_rate( 1789773 ); // Should be 1789773 for NES
-		blargg_err_t error = blipBuffer->sample_rate(44100,600); // 600ms to accomodate up to eight times four frames of audio
+		blipBuffer->clock_rate( NES_NTSC_CPU_CLOCK_RATE ); // Should be 1789773 for NES
+		blargg_err_t error = blipBuffer->sample_rate(NES_APU_SYNTHESIS_RATE,600); // 600ms to accomodate up to eight times four frames of audio
 		if (error) NSLog(@"Error allocating blipBuffer.");
 		
 		nesAPU->output(blipBuffer);
+		_synthesizesAudio = YES;
+		_resampler = NULL;
 		nesAPUState = (NESAPUState *)malloc(sizeof(NESAPUState));
-		nesAPUState->dataFormat.mSampleRate = 44100.0;
+		nesAPUState->dataFormat.mSampleRate = NES_APU_SYNTHESIS_RATE;
 		nesAPUState->dataFormat.mFormatID = kAudioFormatLinearPCM;
 		
 		// Sort out endianness
@@ -150,12 +154,21 @@ static void HandleOutputBuffer (
 		nesAPUState->dataFormat.mBitsPerChannel = 16;
 		nesAPUState->isRunning = NO;
 		
-		nesAPUState->blipBuffer = blipBuffer;
-		
 		[[NSUserDefaults standardUserDefaults] registerDefaults:
 		 [NSDictionary dictionaryWithObject:[NSNumber numberWithUnsignedInt:1470] forKey:@"audioBufferLength"]];
 		
 		[self initializeAudioPlaybackQueue];
+		
+		// Room for the six buffers' worth the old run-away check allowed to accumulate
+		nesAPUState->ring = NESAudioRingCreate(nesAPUState->numPacketsToRead * 6);
+		
+		// Aim for the middle of the two to four buffers the old timing nudges kept queued
+		NESRateControllerInitialize(&_rateController,nesAPUState->numPacketsToRead * 3);
+		[self resetPacingTelemetry];
+		
+		mach_timebase_info(&timebase);
+		_secondsPerTick = ((double)timebase.numer / timebase.denom) / 1e9;
+		[self resetMixTelemetry];
 	}
 	
 	return self;
@@ -168,6 +181,10 @@ static void HandleOutputBuffer (
 					   nesAPUState->queue,
 					   true
 					   );
+	NESAudioRingDestroy(nesAPUState->ring);
+	NESResamplerDestroy(_resampler);
+	delete _vrc6;
+	delete _namco;
 	
 	// FIXME: Free NES APU Resources
 	
@@ -177,6 +194,8 @@ static void HandleOutputBuffer (
 - (void)clearBuffer
 {
 	blipBuffer->clear(true);
+	if (_resampler) NESResamplerReset(_resampler);
+	NESAudioRingRequestFlush(nesAPUState->ring); // The callback owns the read side, so it discards what's queued
 }
 
 - (void)pause
@@ -204,7 +223,18 @@ static void HandleOutputBuffer (
 	// Reset the APU and Buffer
 	_lastCPUCycle = 0;
 	nesAPU->reset(false,0);
+	if (_vrc6) _vrc6->reset();
+	if (_namco) _namco->reset();
 	blipBuffer->clear(true);
+	if (_resampler) {
+		
+		NESResamplerReset(_resampler);
+		NESResamplerSetAdjustment(_resampler,0);
+	}
+	NESAudioRingReset(nesAPUState->ring); // The queue is stopped, so nothing is reading
+	NESRateControllerInitialize(&_rateController,nesAPUState->numPacketsToRead * 3);
+	blipBuffer->clock_rate(NES_NTSC_CPU_CLOCK_RATE);
+	[self resetPacingTelemetry];
 	
 	// Prime the playback buffer
 	for (int i = 0; i < NUM_BUFFERS; ++i) {
@@ -222,16 +252,68 @@ static void HandleOutputBuffer (
 // Set function for APU to call when it needs to read memory (DMC samples)
 -(void)setDMCReadObject:(NES6502Interpreter *)cpu {
 
-	NESMemoryReader *dmcUserData = (NESMemoryReader *)malloc(sizeof(NESMemoryReader));
-	dmcUserData->cpuInterpreter = cpu;
-	dmcUserData->memoryReadFunction = (uint8_t (*)(id, SEL, uint16_t))[cpu methodForSelector:@selector(readByteFromCPUAddressSpace:)];
-	nesAPU->dmc_reader(dmc_read_function,dmcUserData);
+	nesAPU->dmc_reader(dmc_read_function,[cpu dmcFetch]);
+	
+	_irqNotifier.cpuInterpreter = cpu;
+	_irqNotifier.setIRQFunction = (CPUSetIRQPointer)[cpu methodForSelector:@selector(setNextAPUIRQ:)];
+	_irqNotifier.apu = nesAPU;
+	nesAPU->irq_notifier(apu_irq_changed,&_irqNotifier);
+	apu_irq_changed(&_irqNotifier);
+}
+
+// Hands the CPU the APU's current IRQ deadline again, for when the CPU has discarded its copy
+- (void)republishIRQDeadline {
+	
+	apu_irq_changed(&_irqNotifier);
+}
+
+- (void)setSynthesizesAudio:(BOOL)flag {
+	
+	if (flag == _synthesizesAudio) return;
+	_synthesizesAudio = flag;
+	
+	if (flag) {
+		
+		// Start from silence, as the oscillators haven't tracked their waveforms meanwhile
+		blipBuffer->clear(true);
+		nesAPU->buffer_cleared();
+		nesAPU->output(blipBuffer);
+	}
+	else nesAPU->output(NULL);
+	
+	if (_vrc6) _vrc6->output(flag ? blipBuffer : NULL);
+	if (_namco) _namco->output(flag ? blipBuffer : NULL);
+}
+
+- (BOOL)synthesizesAudio {
+	
+	return _synthesizesAudio;
 }
 
 // Set output sample rate
 - (BOOL)setOutputSampleRate:(long)rate {
 
-	// simpleApu.sample_rate(rate);
+	NESResampler *resampler = NULL;
+	
+	if (rate == 0) rate = NES_APU_SYNTHESIS_RATE;
+	if (rate == (long)nesAPUState->dataFormat.mSampleRate) return YES;
+	if ((rate < 8000) || (rate > 192000)) return NO;
+	
+	if ((rate != NES_APU_SYNTHESIS_RATE) && !(resampler = NESResamplerCreate(NES_APU_SYNTHESIS_RATE,rate))) return NO;
+	NESResamplerDestroy(_resampler);
+	_resampler = resampler;
+	
+	// The queue's format and buffer sizes follow the rate, so it is rebuilt along with the ring and pacing target
+	nesAPUState->isRunning = NO;
+	AudioQueueStop(nesAPUState->queue,true);
+	AudioQueueDispose(nesAPUState->queue,true);
+	nesAPUState->dataFormat.mSampleRate = rate;
+	[self initializeAudioPlaybackQueue];
+	
+	NESAudioRingDestroy(nesAPUState->ring);
+	nesAPUState->ring = NESAudioRingCreate(nesAPUState->numPacketsToRead * 6);
+	NESRateControllerInitialize(&_rateController,nesAPUState->numPacketsToRead * 3);
+	[self resetPacingTelemetry];
 	
 	return YES;
 }
@@ -242,6 +324,52 @@ static void HandleOutputBuffer (
 	nesAPU->write_register(cycle, address, byte);
 }
 
+- (void)setExpansionAudio:(NESExpansionAudioChips)chips {
+	
+	delete _vrc6;
+	delete _namco;
+	_vrc6 = NULL;
+	_namco = NULL;
+	
+	// Each chip keeps its own synths, as their volumes differ, but they and the APU synthesize through the same buffer
+	if (chips & NESVRC6ExpansionAudio) {
+		
+		_vrc6 = new Nes_Vrc6();
+		_vrc6->output(_synthesizesAudio ? blipBuffer : NULL);
+	}
+	
+	if (chips & NESNamcoExpansionAudio) {
+		
+		_namco = new Nes_Namco();
+		_namco->output(_synthesizesAudio ? blipBuffer : NULL);
+	}
+}
+
+- (NESExpansionAudioChips)expansionAudio {
+	
+	return (NESExpansionAudioChips)((_vrc6 ? NESVRC6ExpansionAudio : 0) | (_namco ? NESNamcoExpansionAudio : 0));
+}
+
+- (void)writeByte:(uint8_t)byte toVRC6Oscillator:(int)oscillator register:(int)reg onCycle:(uint_fast32_t)cycle {
+	
+	if (_vrc6) _vrc6->write_osc(cycle,oscillator,reg,byte);
+}
+
+- (void)writeByte:(uint8_t)byte toNamcoDataOnCycle:(uint_fast32_t)cycle {
+	
+	if (_namco) _namco->write_data(cycle,byte);
+}
+
+- (uint8_t)readNamcoData {
+	
+	return _namco ? (uint8_t)_namco->read_data() : 0;
+}
+
+- (void)writeNamcoAddress:(uint8_t)byte {
+	
+	if (_namco) _namco->write_addr(byte);
+}
+
 // Read from status register at 0x4015
 - (uint8_t)readAPUStatusOnCycle:(uint_fast32_t)cycle {
 
@@ -256,46 +384,172 @@ static void HandleOutputBuffer (
 	return _apuStatus;
 }
 
+/* _resampleIntoRing
+ * Feeds the frame's PCM through the resampler in chunks, moving its output into the ring as it goes. Output the ring has
+ * no room for is dropped and counted as an overrun, as on the direct path.
+ */
+- (void)_resampleIntoRing {
+	
+	blip_sample_t chunk[512];
+	long count;
+	uint32_t available, writableSamples;
+	int16_t *ringRegion;
+	
+	while ((count = MIN(blipBuffer->samples_avail(),(long)MIN(NESResamplerSpace(_resampler),512))) > 0) {
+		
+		NESResamplerWrite(_resampler,chunk,(uint32_t)blipBuffer->read_samples(chunk,count));
+		
+		while ((available = NESResamplerAvailable(_resampler)) > 0) {
+			
+			writableSamples = NESAudioRingBeginWrite(nesAPUState->ring,&ringRegion);
+			if (writableSamples == 0) {
+				
+				NESAudioRingRecordOverrun(nesAPUState->ring,NESResamplerDropOutput(_resampler));
+				break;
+			}
+			
+			NESAudioRingCommitWrite(nesAPUState->ring,NESResamplerRead(_resampler,ringRegion,MIN(writableSamples,available)));
+		}
+	}
+}
+
 // End a 1/60 sound frame
 - (double)endFrameOnCycle:(uint_fast32_t)cycle {
 
-	UInt32 availableSamples;
-	double timingCorrection = 0;
+	long availableSamples;
+	uint32_t writableSamples;
+	int16_t *ringRegion;
+	uint64_t frameEndTime = mach_absolute_time();
+	uint64_t apuEndTime, expansionEndTime;
+	mach_timebase_info_data_t timebase;
+	double frameInterval;
 	
+	// Every chip runs to the same cycle before the shared buffer's frame is ended, once
 	nesAPU->end_frame(cycle);
-	blipBuffer->end_frame(cycle);
+	apuEndTime = mach_absolute_time();
+	if (_vrc6) _vrc6->end_frame(cycle);
+	if (_namco) _namco->end_frame(cycle);
+	expansionEndTime = mach_absolute_time();
 	_lastCPUCycle = 0;
-	nesAPUState->isRunning = YES;
 	
-	availableSamples = nesAPUState->blipBuffer->samples_avail();
-	if (availableSamples < (nesAPUState->numPacketsToRead * 2)) {
-			
-		timingCorrection = -0.005;
+	_mixTelemetry.frames++;
+	_mixTelemetry.apuSeconds += (apuEndTime - frameEndTime) * _secondsPerTick;
+	if (_vrc6 || _namco) {
+		
+		_mixTelemetry.expansionFrames++;
+		_mixTelemetry.expansionSeconds += (expansionEndTime - apuEndTime) * _secondsPerTick;
 	}
-	else if (availableSamples > (nesAPUState->numPacketsToRead * 4)) {
+	
+	// Without synthesis there is nothing to queue, so the frame timer paces emulation on its own
+	if (!_synthesizesAudio) return 0.0;
+	
+	blipBuffer->end_frame(cycle);
+	
+	// Move the frame's PCM into the ring, dropping what doesn't fit rather than touching the consumer's side
+	if (_resampler) [self _resampleIntoRing];
+	else {
+		
+		while ((availableSamples = blipBuffer->samples_avail()) > 0) {
 			
-		timingCorrection = 0.005;
+			writableSamples = NESAudioRingBeginWrite(nesAPUState->ring,&ringRegion);
+			if (writableSamples == 0) {
+				
+				NESAudioRingRecordOverrun(nesAPUState->ring,(uint32_t)availableSamples);
+				blipBuffer->remove_samples(availableSamples);
+				break;
+			}
 			
-		// Try to catch run-away buffer overflow
-		if (availableSamples > (nesAPUState->numPacketsToRead * 6)) {
-		
-			NSLog(@"Reducing samples in audio buffer to prevent overflow.");
-			blipBuffer->remove_samples(nesAPUState->numPacketsToRead);
+			NESAudioRingCommitWrite(nesAPUState->ring,(uint32_t)blipBuffer->read_samples((blip_sample_t *)ringRegion,MIN((long)writableSamples,availableSamples)));
 		}
 	}
 	
-	return timingCorrection;
+	_mixTelemetry.mixSeconds += (mach_absolute_time() - expansionEndTime) * _secondsPerTick;
+	nesAPUState->isRunning = YES;
+	
+	// Steer the resampling ratio by how much audio is queued, so the device's consumption paces emulation
+	availableSamples = NESAudioRingFill(nesAPUState->ring);
+	NESRateControllerUpdate(&_rateController,availableSamples);
+	if (_resampler) NESResamplerSetAdjustment(_resampler,_rateController.adjustment); // Exact, so no dithering needed
+	else blipBuffer->clock_rate(NESRateControllerClockRate(&_rateController,NES_NTSC_CPU_CLOCK_RATE,(long)nesAPUState->dataFormat.mSampleRate));
+	
+	_pacingTelemetry.frames++;
+	_pacingTelemetry.fill = _rateController.smoothedFill;
+	_pacingTelemetry.adjustment = _rateController.adjustment;
+	if (_rateController.adjustment < _pacingTelemetry.smallestAdjustment) _pacingTelemetry.smallestAdjustment = _rateController.adjustment;
+	if (_rateController.adjustment > _pacingTelemetry.largestAdjustment) _pacingTelemetry.largestAdjustment = _rateController.adjustment;
+	_pacingTelemetry.timingCorrection = NESRateControllerTimingCorrection(&_rateController);
+	
+	if (_lastFrameEndTime != 0) {
+		
+		mach_timebase_info(&timebase);
+		frameInterval = (double)(((frameEndTime - _lastFrameEndTime) * timebase.numer) / timebase.denom) / 1e9;
+		_pacingTelemetry.lastFrameInterval = frameInterval;
+		_pacingTelemetry.meanFrameInterval += (frameInterval - _pacingTelemetry.meanFrameInterval) / _pacingTelemetry.frames;
+		if (frameInterval > _pacingTelemetry.longestFrameInterval) _pacingTelemetry.longestFrameInterval = frameInterval;
+	}
+	_lastFrameEndTime = frameEndTime;
+	
+	return _pacingTelemetry.timingCorrection;
 }
 
 // Number of samples in buffer
 - (long)numberOfBufferedSamples {
 	
-	return blipBuffer->samples_avail();
+	return NESAudioRingFill(nesAPUState->ring);
+}
+
+- (NESAudioRingStatistics)audioRingStatistics {
+	
+	return NESAudioRingGetStatistics(nesAPUState->ring);
 }
 
-- (int)pendingDMCReadsOnCycle:(uint_fast32_t)cycle {
+- (void)getAudioRingFillHistogram:(uint32_t *)bins {
+	
+	memcpy(bins,nesAPUState->ring->fillHistogram,sizeof(uint32_t) * NES_AUDIO_RING_HISTOGRAM_BINS);
+}
+
+- (void)resetAudioRingStatistics {
+	
+	NESAudioRingResetStatistics(nesAPUState->ring);
+}
+
+- (NESAudioPacingTelemetry)pacingTelemetry {
+	
+	return _pacingTelemetry;
+}
+
+- (void)resetPacingTelemetry {
+	
+	memset(&_pacingTelemetry,0,sizeof(NESAudioPacingTelemetry));
+	_pacingTelemetry.targetFill = _rateController.targetFill;
+	_lastFrameEndTime = 0;
+}
 
-	return nesAPU->count_dmc_reads(cycle, NULL);
+- (void)getIdleCycles:(long *)cycles {
+	
+	for (int osc = 0; osc < Nes_Apu::osc_count; osc++) cycles[osc] = nesAPU->idle_clocks(osc);
+}
+
+- (void)resetIdleCycles {
+	
+	nesAPU->clear_idle_clocks();
+}
+
+- (NESAudioMixTelemetry)mixTelemetry {
+	
+	return _mixTelemetry;
+}
+
+- (void)resetMixTelemetry {
+	
+	memset(&_mixTelemetry,0,sizeof(NESAudioMixTelemetry));
+}
+
+- (uint_fast32_t)nextDMCReadCycle {
+	
+	cpu_time_t read = nesAPU->next_dmc_read();
+	
+	return (read == Nes_Apu::no_irq) ? NO_PENDING_DMC_READ : (uint_fast32_t)read;
 }
 
 - (void)runAPUUntilCPUCycle:(uint_fast32_t)cycle {
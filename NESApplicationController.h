@@ -28,7 +28,10 @@
 @interface NESApplicationController : NSObject <NSApplicationDelegate> {
 
 	uint_fast32_t ppuCyclesInLastFrame;
+	uint_fast32_t frameSkip;
+	uint_fast32_t framesSinceRender;
 	double lastTimingCorrection;
+	NSTimeInterval nextFrameTime;
 	NES6502Interpreter *cpuInterpreter;
 	NESAPUEmulator *apuEmulator;
 	NESPPUEmulator *ppuEmulator;
@@ -52,6 +55,9 @@
 	IBOutlet NSWindow *preferencesWindow;
 	IBOutlet NSButton *runDebugButton;
 	
+	NSWindow *timingMapWindow;
+	NSImageView *timingMapView;
+	
 	BOOL debuggerIsVisible;
 	BOOL gameIsLoaded;
 	BOOL gameIsRunning;
@@ -71,6 +77,7 @@
 - (IBAction)showAndHideDebugger:(id)sender;
 - (IBAction)showPreferences:(id)sender;
 - (IBAction)toggleFullScreenMode:(id)sender;
+- (IBAction)saveTimingLog:(id)sender;
 
 - (BOOL)loadROMAtPath:(NSString *)path;
 - (BOOL)gameIsLoaded;
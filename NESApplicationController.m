@@ -29,6 +29,14 @@
 #import "NES6502Interpreter.h"
 #import "NESControllerInterface.h"
 #import "NESCartridge.h"
+#import "NESTxROMCartridge.h"
+
+// Build with NES_DOT_ACCURATE_PPU=1 to emulate the PPU dot by dot instead of by scanline
+#ifndef NES_DOT_ACCURATE_PPU
+#define NES_DOT_ACCURATE_PPU 0
+#endif
+
+#define MAXIMUM_FRAME_SKIP 9 // Renders at least one frame in ten
 
 static const char *instructionNames[256] = { "BRK", "ORA", "$02", "$03", "$04", "ORA", "ASL", "$07",
 "PHP", "ORA", "ASL", "$0B", "$0C", "ORA", "ASL", "$0F",
@@ -144,6 +152,9 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
         playOnActivate = NO;
         applicationHasLaunched = NO;
         lastTimingCorrection = 0;
+        nextFrameTime = 0;
+        frameSkip = 0;
+        framesSinceRender = 0;
     }
     
     return self;
@@ -238,12 +249,45 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 
 - (void)applicationDidFinishLaunching:(NSNotification *)notification {
 	
-    ppuEmulator = [[NESPPUEmulator alloc] initWithBuffer:[playfieldView videoBuffer]];
+	NSMenuItem *menuItem;
+	NSMenuItem *debuggerMenuItem;
+	
+    ppuEmulator = [[(NES_DOT_ACCURATE_PPU ? [NESDotPPUEmulator class] : [NESPPUEmulator class]) alloc] initWithBuffer:[playfieldView videoBuffer]];
     apuEmulator = [[NESAPUEmulator alloc] init];
     cpuInterpreter = [[NES6502Interpreter alloc] initWithPPU:ppuEmulator andAPU:apuEmulator];
     cartEmulator = [[NESCartridgeEmulator alloc] initWithPPU:ppuEmulator andCPU:cpuInterpreter];
     [apuEmulator setDMCReadObject:cpuInterpreter];
     
+    // frameSkip renders one frame in every frameSkip + 1, running the PPU logic-only for the others
+    [[NSUserDefaults standardUserDefaults] registerDefaults:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithUnsignedInt:0],@"frameSkip",[NSNumber numberWithBool:NO],@"validateLogicOnlyRendering",[NSNumber numberWithBool:NO],@"deferredRendering",[NSNumber numberWithUnsignedInt:1],@"renderWorkers",[NSNumber numberWithBool:NO],@"benchmarkPPUEngines",[NSNumber numberWithBool:NO],@"verifyBandRendering",[NSNumber numberWithBool:NO],@"compareDotPPU",[NSNumber numberWithBool:NO],@"validateMMC3IRQPrediction",[NSNumber numberWithBool:YES],@"synthesizeAudio",[NSNumber numberWithInteger:0],@"outputSampleRate",nil]];
+    frameSkip = MIN(MAX([[NSUserDefaults standardUserDefaults] integerForKey:@"frameSkip"],0),MAXIMUM_FRAME_SKIP); // A negative default would wrap and never render
+    [ppuEmulator setValidatesLogicOnlyRendering:[[NSUserDefaults standardUserDefaults] boolForKey:@"validateLogicOnlyRendering"]];
+    
+    // outputSampleRate plays at that rate (e.g. 48000 or 96000), resampled from the APU's 44.1kHz; 0 plays 44.1kHz as is
+    if (![apuEmulator setOutputSampleRate:[[NSUserDefaults standardUserDefaults] integerForKey:@"outputSampleRate"]]) NSLog(@"Unsupported outputSampleRate, playing at %dHz.",NES_APU_SYNTHESIS_RATE);
+    
+    // synthesizeAudio off runs the APU for what games can observe only, for batch runs that don't need sound
+    [apuEmulator setSynthesizesAudio:[[NSUserDefaults standardUserDefaults] boolForKey:@"synthesizeAudio"]];
+    
+    // renderWorkers above one splits deferred frames into bands rendered concurrently
+    [ppuEmulator setRenderWorkers:[[NSUserDefaults standardUserDefaults] integerForKey:@"renderWorkers"]];
+    
+    // paletteFile names a .pal file to use in place of the built-in colors
+    if ([[NSUserDefaults standardUserDefaults] stringForKey:@"paletteFile"]) [ppuEmulator loadPaletteFromFile:[[[NSUserDefaults standardUserDefaults] stringForKey:@"paletteFile"] stringByExpandingTildeInPath]];
+    
+	// Offer the PPU timing log next to the debugger menu item
+	for (menuItem in [[NSApp mainMenu] itemArray]) {
+		
+		for (debuggerMenuItem in [[menuItem submenu] itemArray]) {
+			
+			if ([debuggerMenuItem action] == @selector(showAndHideDebugger:)) {
+				
+				[[menuItem submenu] insertItem:[[[NSMenuItem alloc] initWithTitle:@"Save PPU Timing Log..." action:@selector(saveTimingLog:) keyEquivalent:@""] autorelease] atIndex:[[menuItem submenu] indexOfItem:debuggerMenuItem] + 1];
+				break;
+			}
+		}
+	}
+	
 	_fullScreenMode = [self findBestFullscreenDisplayModeForDisplay:kCGDirectMainDisplay];
     _windowedMode = CGDisplayCopyDisplayMode(kCGDirectMainDisplay);
     
@@ -288,9 +332,19 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
         // Set initial ROM pointers
         [cartridge setInitialROMPointers];
         
+        // validateMMC3IRQPrediction checks the closed-form MMC3 IRQ timing against every A12 rise the PPU performs
+        if ([cartridge isKindOfClass:[NESTxROMCartridge class]]) [(NESTxROMCartridge *)cartridge setValidatesIRQPrediction:[[NSUserDefaults standardUserDefaults] boolForKey:@"validateMMC3IRQPrediction"]];
+        
         // Configure initial PPU state
         [cartridge configureInitialPPUState];
         
+        // deferredRendering draws each frame on a background queue from a log of the frame's PPU events
+        [ppuEmulator setDeferredRendering:[[NSUserDefaults standardUserDefaults] boolForKey:@"deferredRendering"]];
+        
+        // Drop the last cartridge's sound chips and let this one's mapper register its own
+        [apuEmulator setExpansionAudio:NESNoExpansionAudio];
+        [cartridge configureExpansionAudio:apuEmulator];
+        
         // Allow CPU Interpreter to cache PRGROM pointers
         [cpuInterpreter setCartridge:cartridge];
         
@@ -338,14 +392,28 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 	}
 }
 
+// Frames are due on a fixed timeline, so timer latency isn't added to every period
+- (NSTimeInterval)_intervalUntilNextFrame {
+	
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+	
+	nextFrameTime += NES_NTSC_FRAME_PERIOD + lastTimingCorrection;
+	if ((nextFrameTime < (now - (4 * NES_NTSC_FRAME_PERIOD))) || (nextFrameTime > (now + (2 * NES_NTSC_FRAME_PERIOD)))) nextFrameTime = now + NES_NTSC_FRAME_PERIOD; // Start over after a pause or stall
+	
+	return MAX(nextFrameTime - now,0);
+}
+
 - (void)_nextFrame {
 	
 	uint_fast32_t actualCPUCyclesRun;
+	uint64_t changedScanlines[4];
+	BOOL renderFrame = (framesSinceRender >= frameSkip);
 	
-	gameTimer = [NSTimer scheduledTimerWithTimeInterval:(0.0166 + lastTimingCorrection) target:self selector:@selector(_nextFrame) userInfo:nil repeats:NO];
+	gameTimer = [NSTimer scheduledTimerWithTimeInterval:[self _intervalUntilNextFrame] target:self selector:@selector(_nextFrame) userInfo:nil repeats:NO];
 	
 	[cpuInterpreter setData:[_controllerInterface readController:0] forController:0];
 	[cpuInterpreter setData:[_controllerInterface readController:1] forController:1];// Pull latest controller data
+	[ppuEmulator setRendersOutput:renderFrame]; // Skipped frames only compute what the CPU can observe
 	
 	if ([ppuEmulator triggeredNMI]) [cpuInterpreter _performNonMaskableInterrupt]; // Invoke NMI if triggered by the PPU
 	[cpuInterpreter executeUntilCycle:[ppuEmulator cpuCyclesUntilPrimingScanline]]; // Run CPU until just past VBLANK
@@ -354,7 +422,14 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 	[ppuEmulator runPPUUntilCPUCycle:actualCPUCyclesRun];
 	[ppuEmulator resetCPUCycleCounter]; // Reset PPU's CPU cycle counter for next frame and update cartridge scanline counters (must occur before CPU cycle counter is reset)
 	[cpuInterpreter resetCPUCycleCounter]; // Reset CPU cycle counter for next frame
-	[playfieldView setNeedsDisplay:YES]; // Redraw the screen
+	
+	if (renderFrame) {
+		
+		framesSinceRender = 0;
+		[ppuEmulator takeChangedScanlines:changedScanlines];
+		[playfieldView setNeedsDisplayForScanlines:changedScanlines]; // Redraw the scanlines that changed
+	}
+	else framesSinceRender++;
 }
 
 - (IBAction)resetCPU:(id)sender {
@@ -369,6 +444,7 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 		
 		// Configure initial PPU state
 		[[cartEmulator cartridge] configureInitialPPUState];
+		[ppuEmulator setDeferredRendering:[[NSUserDefaults standardUserDefaults] boolForKey:@"deferredRendering"]];
 				
 		// Reset the CPU to prepare for execution
 		[cpuInterpreter reset];
@@ -426,6 +502,27 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 		[gameTimer invalidate];
 		gameTimer = nil;
 		[apuEmulator pause];
+		[ppuEmulator setRendersOutput:YES]; // The debugger paths always render
+		framesSinceRender = 0;
+		
+		// Compare both PPU engines on the paused screen
+		if ([[NSUserDefaults standardUserDefaults] boolForKey:@"benchmarkPPUEngines"]) {
+			
+			NSLog(@"Scanline PPU: %.1f frames per second.",[ppuEmulator benchmarkFramesPerSecondWithEngine:[NESPPUEmulator class] frames:600]);
+			NSLog(@"Dot-accurate PPU: %.1f frames per second.",[ppuEmulator benchmarkFramesPerSecondWithEngine:[NESDotPPUEmulator class] frames:600]);
+		}
+		
+		// Check band rendering against synchronous rendering with mid-frame VRAM and OAM writes, starting from the paused screen
+		if ([[NSUserDefaults standardUserDefaults] boolForKey:@"verifyBandRendering"]) {
+			
+			NSLog(@"Band rendering: %lu pixels differ from synchronous rendering.",(unsigned long)[ppuEmulator bandRenderingMismatchesWithWorkers:MAX([ppuEmulator renderWorkers],2) frames:8]);
+		}
+		
+		// Run both PPU engines frame by frame from the paused screen, comparing pixels and $2002 reads
+		if ([[NSUserDefaults standardUserDefaults] boolForKey:@"compareDotPPU"]) {
+			
+			NSLog(@"Dot-accurate PPU: %lu of 60 frames differ from the scanline PPU.",(unsigned long)[ppuEmulator mismatchedFramesWithEngine:[NESDotPPUEmulator class] frames:60]);
+		}
 		[playPauseMenuItem setTitle:@"Play"];
 	}
 }
@@ -473,7 +570,7 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 	}
 	else {
 		
-		gameTimer = [NSTimer scheduledTimerWithTimeInterval:(0.0166 + lastTimingCorrection) target:self selector:@selector(_nextFrameWithBreak) userInfo:nil repeats:NO];
+		gameTimer = [NSTimer scheduledTimerWithTimeInterval:[self _intervalUntilNextFrame] target:self selector:@selector(_nextFrameWithBreak) userInfo:nil repeats:NO];
 		
 		[cpuInterpreter setData:[_controllerInterface readController:0] forController:0];
 		[cpuInterpreter setData:[_controllerInterface readController:1] forController:1];// Pull latest controller data
@@ -536,24 +633,70 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 	}
 }
 
+// Redraws the PPU timing map from the last completed frame's events
+- (void)_updateTimingMap
+{
+	uint_fast32_t *mapBuffer = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * 341 * 262);
+	CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+	CGContextRef context;
+	CGImageRef mapImage;
+	NSImage *image;
+	
+	[ppuEmulator drawTimingMapIntoBuffer:mapBuffer];
+	context = CGBitmapContextCreate(mapBuffer, 341, 262, 8, 4 * 341, colorSpace, kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Host);
+	mapImage = CGBitmapContextCreateImage(context);
+	image = [[NSImage alloc] initWithCGImage:mapImage size:NSMakeSize(341 * 2, 262 * 2)];
+	[timingMapView setImage:image];
+	
+	[image release];
+	CGImageRelease(mapImage);
+	CGContextRelease(context);
+	CGColorSpaceRelease(colorSpace);
+	free(mapBuffer);
+}
+
+- (IBAction)saveTimingLog:(id)sender
+{
+	NSSavePanel *savePanel = [NSSavePanel savePanel];
+	
+	[savePanel setAllowedFileTypes:[NSArray arrayWithObject:@"txt"]];
+	if ([savePanel runModal] == NSFileHandlingPanelOKButton) [ppuEmulator writeTimingEventLogToFile:[[savePanel URL] path]];
+}
+
 - (IBAction)showAndHideDebugger:(id)sender
 {
 	if (debuggerIsVisible) {
 	
 		[debuggerWindow orderOut:nil];
+		[timingMapWindow orderOut:nil];
 		debuggerIsVisible = NO;
 		[ppuEmulator toggleDebugging:NO];
+		[ppuEmulator setRecordsTimingEvents:NO];
 	}
 	else {
 	
 		if ([playfieldView isInFullScreenMode]) [self toggleFullScreenMode:nil]; // Switch out of full-screen if in it
 		if (gameIsRunning) [self runUntilBreak:nil]; // Pause the game if it is running
 		
+		if (timingMapWindow == nil) {
+			
+			// The timing map shows one pixel per PPU dot, 341 across and 262 scanlines down, at double size
+			timingMapWindow = [[NSWindow alloc] initWithContentRect:NSMakeRect(0, 0, 341 * 2, 262 * 2) styleMask:(NSTitledWindowMask | NSClosableWindowMask) backing:NSBackingStoreBuffered defer:YES];
+			[timingMapWindow setTitle:@"PPU Timing"];
+			[timingMapWindow setReleasedWhenClosed:NO];
+			timingMapView = [[NSImageView alloc] initWithFrame:NSMakeRect(0, 0, 341 * 2, 262 * 2)];
+			[timingMapView setImageScaling:NSImageScaleAxesIndependently];
+			[timingMapWindow setContentView:timingMapView];
+			[timingMapView release];
+		}
+		
 		[debuggerWindow makeKeyAndOrderFront:nil];
+		[timingMapWindow orderFront:nil];
 		debuggerIsVisible = YES;
 		[self updatecpuRegisters];
 		[self updateInstructions:NO];
 		[ppuEmulator toggleDebugging:YES];
+		[ppuEmulator setRecordsTimingEvents:YES];
 		
 	}
 }
@@ -581,6 +724,7 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 		[apuEmulator endFrameOnCycle:actualCPUCyclesRun]; // End the APU frame and update timing correction
 		[ppuEmulator resetCPUCycleCounter];
 		[cpuInterpreter resetCPUCycleCounter];
+		if (debuggerIsVisible) [self _updateTimingMap];
 	}
 	
 	[apuEmulator clearBuffer];
@@ -609,6 +753,7 @@ static const char *instructionDescriptions[256] = { "Break (Implied)", "ORA Indi
 			[apuEmulator endFrameOnCycle:[cpuInterpreter cpuRegisters]->cycle]; // End the APU frame and update timing correction
 			[ppuEmulator resetCPUCycleCounter];
 			[cpuInterpreter resetCPUCycleCounter];
+			if (debuggerIsVisible) [self _updateTimingMap];
 		}
 		
 		if (debuggerIsVisible) {
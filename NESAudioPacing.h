@@ -0,0 +1,140 @@
+/*
+ *  NESAudioPacing.h
+ *
+ * Copyright (c) 2010 Auston Stewart
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef NESAUDIOPACING_H
+#define NESAUDIOPACING_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define NES_NTSC_CPU_CLOCK_RATE 1789773
+#define NES_NTSC_FRAME_PERIOD (29780.5 / NES_NTSC_CPU_CLOCK_RATE) // Seconds per frame, alternating 29780 and 29781 cycles
+
+/* NESRateController
+ * PI controller that holds the audio ring's fill level at a target latency by resampling. Its output is a fractional
+ * change to the clock rate the Blip_Buffer resamples against: positive when too much audio is queued, so each frame
+ * yields fewer samples. The fill is smoothed first, since the output callback drains it a whole buffer at a time.
+ */
+typedef struct {
+	
+	double targetFill; // Samples
+	double proportionalGain;
+	double integralGain;
+	double smoothing; // Weight of each new fill reading
+	double maximumAdjustment; // Largest change to the rate, kept well inside what is audible as pitch
+	double maximumFrameCorrection; // Largest change to the frame period
+	
+	double smoothedFill;
+	double integral;
+	double adjustment;
+	double frameCorrection; // Fraction of a frame period, the part of the output beyond the rate's limit
+	double factorResidual;
+	
+} NESRateController;
+
+typedef struct {
+	
+	uint32_t frames;
+	double fill; // Smoothed, in samples
+	double targetFill;
+	double adjustment; // Current fractional clock rate change
+	double smallestAdjustment;
+	double largestAdjustment;
+	double lastFrameInterval; // Seconds between the last two frame ends
+	double meanFrameInterval;
+	double longestFrameInterval;
+	double timingCorrection; // Seconds the frame timer was last asked to shift by
+	
+} NESAudioPacingTelemetry;
+
+static inline void NESRateControllerInitialize(NESRateController *controller, double targetFill)
+{
+	controller->targetFill = targetFill;
+	controller->proportionalGain = 0.004;
+	controller->integralGain = 0.00005;
+	controller->smoothing = 0.05;
+	controller->maximumAdjustment = 0.005;
+	controller->maximumFrameCorrection = 0.05;
+	controller->smoothedFill = targetFill;
+	controller->integral = 0;
+	controller->adjustment = 0;
+	controller->frameCorrection = 0;
+	controller->factorResidual = 0;
+}
+
+/* NESRateControllerUpdate:
+ * Called once per frame with the ring's fill; returns the new fractional clock rate adjustment. Slowing the frame timer
+ * and raising the resampling clock both yield less audio per second, so they act as one output: the rate takes it up to
+ * its limit and only the excess lengthens or shortens the frame period.
+ */
+static inline double NESRateControllerUpdate(NESRateController *controller, double fill)
+{
+	double error, output, integralLimit;
+	
+	controller->smoothedFill += controller->smoothing * (fill - controller->smoothedFill);
+	error = (controller->smoothedFill - controller->targetFill) / controller->targetFill;
+	
+	// The integral alone may never exceed both outputs together, so it can't wind up while they are saturated
+	integralLimit = (controller->maximumAdjustment + controller->maximumFrameCorrection) / controller->integralGain;
+	controller->integral += error;
+	if (controller->integral > integralLimit) controller->integral = integralLimit;
+	else if (controller->integral < -integralLimit) controller->integral = -integralLimit;
+	
+	output = (controller->proportionalGain * error) + (controller->integralGain * controller->integral);
+	
+	if (output > controller->maximumAdjustment) controller->adjustment = controller->maximumAdjustment;
+	else if (output < -controller->maximumAdjustment) controller->adjustment = -controller->maximumAdjustment;
+	else controller->adjustment = output;
+	
+	controller->frameCorrection = output - controller->adjustment;
+	if (controller->frameCorrection > controller->maximumFrameCorrection) controller->frameCorrection = controller->maximumFrameCorrection;
+	else if (controller->frameCorrection < -controller->maximumFrameCorrection) controller->frameCorrection = -controller->maximumFrameCorrection;
+	
+	return controller->adjustment;
+}
+
+/* NESRateControllerClockRate:
+ * Blip_Buffer resamples with a 16.16 fixed-point factor, too coarse (about 0.06% a step at 44.1kHz) to follow the
+ * controller directly. The exact factor is dithered across frames by carrying the rounding error forward, and the clock
+ * rate returned is one Blip_Buffer::clock_rate() maps back onto the chosen factor.
+ */
+static inline long NESRateControllerClockRate(NESRateController *controller, long nominalClockRate, long sampleRate)
+{
+	double factor = ((double)sampleRate * 65536.0) / ((double)nominalClockRate * (1.0 + controller->adjustment));
+	double chosenFactor;
+	
+	controller->factorResidual += factor;
+	chosenFactor = floor(controller->factorResidual + 0.5);
+	controller->factorResidual -= chosenFactor;
+	
+	return (long)floor((((double)sampleRate * 65536.0) / chosenFactor) + 0.5);
+}
+
+// Seconds to add to the next frame period, nonzero only after drift has exceeded what resampling may absorb
+static inline double NESRateControllerTimingCorrection(const NESRateController *controller)
+{
+	return NES_NTSC_FRAME_PERIOD * controller->frameCorrection;
+}
+
+#endif
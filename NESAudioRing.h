@@ -0,0 +1,214 @@
+/*
+ *  NESAudioRing.h
+ *
+ * Copyright (c) 2010 Auston Stewart
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef NESAUDIORING_H
+#define NESAUDIORING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libkern/OSAtomic.h>
+
+#define NES_AUDIO_RING_CACHE_LINE 64
+#define NES_AUDIO_RING_HISTOGRAM_BINS 16
+
+/* NESAudioRing
+ * Single-producer/single-consumer ring of 16-bit PCM samples. The emulation thread is the only writer of writeIndex and
+ * the audio callback the only writer of readIndex, so neither side takes a lock. The indices run freely and are masked on
+ * use, each on its own cache line alongside the counters only its side updates.
+ */
+typedef struct {
+	
+	// Producer side
+	volatile uint32_t writeIndex;
+	uint32_t overruns; // Producer calls that found the ring full
+	uint32_t droppedSamples; // Samples discarded because they didn't fit
+	volatile uint32_t flushRequests; // Flushes asked for, honored by the consumer once it acknowledges them
+	uint8_t producerPadding[NES_AUDIO_RING_CACHE_LINE - (4 * sizeof(uint32_t))];
+	
+	// Consumer side
+	volatile uint32_t readIndex;
+	uint32_t underruns; // Consumer reads that came up short
+	uint32_t silentSamples; // Samples of silence padded in for them
+	uint32_t reads;
+	uint32_t fillHistogram[NES_AUDIO_RING_HISTOGRAM_BINS]; // Fill level seen by each read, in sixteenths of capacity
+	volatile uint32_t flushAcknowledgements; // Catches up with flushRequests as the consumer discards what's queued
+	uint8_t consumerPadding[(2 * NES_AUDIO_RING_CACHE_LINE) - ((5 + NES_AUDIO_RING_HISTOGRAM_BINS) * sizeof(uint32_t))];
+	
+	uint32_t capacity;
+	uint32_t mask;
+	int16_t *samples;
+	
+} NESAudioRing;
+
+typedef struct {
+	
+	uint32_t capacity;
+	uint32_t fill;
+	uint32_t reads;
+	uint32_t underruns;
+	uint32_t silentSamples;
+	uint32_t overruns;
+	uint32_t droppedSamples;
+	
+} NESAudioRingStatistics;
+
+// Capacity is rounded up to a power of two so indices can be masked
+static inline NESAudioRing *NESAudioRingCreate(uint32_t minimumCapacity)
+{
+	NESAudioRing *ring;
+	uint32_t capacity = 1;
+	
+	while (capacity < minimumCapacity) capacity <<= 1;
+	
+	if (posix_memalign((void **)&ring,NES_AUDIO_RING_CACHE_LINE,sizeof(NESAudioRing)) != 0) return NULL;
+	memset(ring,0,sizeof(NESAudioRing));
+	ring->capacity = capacity;
+	ring->mask = capacity - 1;
+	ring->samples = (int16_t *)calloc(capacity,sizeof(int16_t));
+	
+	return ring;
+}
+
+static inline void NESAudioRingDestroy(NESAudioRing *ring)
+{
+	if (ring == NULL) return;
+	free(ring->samples);
+	free(ring);
+}
+
+// Only safe while no consumer is running, e.g. before the audio queue is started
+static inline void NESAudioRingReset(NESAudioRing *ring)
+{
+	ring->writeIndex = ring->readIndex = 0;
+	ring->flushRequests = ring->flushAcknowledgements = 0;
+	OSMemoryBarrier();
+}
+
+// Samples waiting to be read. Exact for either side, a lower (consumer) or upper (producer) bound for the other.
+static inline uint32_t NESAudioRingFill(const NESAudioRing *ring)
+{
+	return ring->writeIndex - ring->readIndex;
+}
+
+/* NESAudioRingBeginWrite:
+ * Producer only. Points region at the largest contiguous run of free samples and returns its length; the run stops at the
+ * end of the storage, so a caller with more to write commits and begins again.
+ */
+static inline uint32_t NESAudioRingBeginWrite(NESAudioRing *ring, int16_t **region)
+{
+	uint32_t writeIndex = ring->writeIndex;
+	uint32_t space = ring->capacity - (writeIndex - ring->readIndex);
+	uint32_t untilEnd = ring->capacity - (writeIndex & ring->mask);
+	
+	OSMemoryBarrier(); // Don't touch the freed samples before seeing the consumer is done with them
+	*region = ring->samples + (writeIndex & ring->mask);
+	
+	return (space < untilEnd) ? space : untilEnd;
+}
+
+static inline void NESAudioRingCommitWrite(NESAudioRing *ring, uint32_t count)
+{
+	OSMemoryBarrier(); // Publish the samples before the index that exposes them
+	ring->writeIndex += count;
+}
+
+// Producer only. Records samples that had to be thrown away for lack of space.
+static inline void NESAudioRingRecordOverrun(NESAudioRing *ring, uint32_t count)
+{
+	ring->overruns++;
+	ring->droppedSamples += count;
+}
+
+// Producer only. Each side writes only its own counter, so a request made while the last is being honored isn't lost.
+static inline void NESAudioRingRequestFlush(NESAudioRing *ring)
+{
+	ring->flushRequests++;
+}
+
+/* NESAudioRingRead:
+ * Consumer only. Copies up to count samples out and pads any shortfall with silence, returning the number of real samples.
+ */
+static inline uint32_t NESAudioRingRead(NESAudioRing *ring, int16_t *destination, uint32_t count)
+{
+	uint32_t readIndex = ring->readIndex;
+	uint32_t flushRequests = ring->flushRequests;
+	uint32_t fill, available, firstRun, bin;
+	
+	if (flushRequests != ring->flushAcknowledgements) {
+		
+		readIndex = ring->writeIndex;
+		ring->flushAcknowledgements = flushRequests;
+	}
+	
+	fill = ring->writeIndex - readIndex;
+	OSMemoryBarrier(); // Samples below the observed writeIndex are complete
+	
+	bin = (uint32_t)(((uint64_t)fill * NES_AUDIO_RING_HISTOGRAM_BINS) / ring->capacity);
+	ring->fillHistogram[(bin < NES_AUDIO_RING_HISTOGRAM_BINS) ? bin : NES_AUDIO_RING_HISTOGRAM_BINS - 1]++;
+	ring->reads++;
+	
+	available = (fill < count) ? fill : count;
+	firstRun = ring->capacity - (readIndex & ring->mask);
+	if (firstRun > available) firstRun = available;
+	memcpy(destination,ring->samples + (readIndex & ring->mask),firstRun * sizeof(int16_t));
+	memcpy(destination + firstRun,ring->samples,(available - firstRun) * sizeof(int16_t));
+	
+	if (available < count) {
+		
+		memset(destination + available,0,(count - available) * sizeof(int16_t));
+		ring->underruns++;
+		ring->silentSamples += count - available;
+	}
+	
+	OSMemoryBarrier(); // Finish copying before handing the samples back to the producer
+	ring->readIndex = readIndex + available;
+	
+	return available;
+}
+
+// Counters are cleared from outside both sides, so a count in flight may survive the reset
+static inline void NESAudioRingResetStatistics(NESAudioRing *ring)
+{
+	ring->overruns = ring->droppedSamples = 0;
+	ring->underruns = ring->silentSamples = ring->reads = 0;
+	memset(ring->fillHistogram,0,sizeof(uint32_t) * NES_AUDIO_RING_HISTOGRAM_BINS);
+}
+
+static inline NESAudioRingStatistics NESAudioRingGetStatistics(const NESAudioRing *ring)
+{
+	NESAudioRingStatistics statistics;
+	
+	statistics.capacity = ring->capacity;
+	statistics.fill = NESAudioRingFill(ring);
+	statistics.reads = ring->reads;
+	statistics.underruns = ring->underruns;
+	statistics.silentSamples = ring->silentSamples;
+	statistics.overruns = ring->overruns;
+	statistics.droppedSamples = ring->droppedSamples;
+	
+	return statistics;
+}
+
+#endif
@@ -0,0 +1,291 @@
+/*
+ *  NESAudioRingTest.c
+ *
+ * Copyright (c) 2010 Auston Stewart
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Deterministic producer/consumer test for NESAudioRing.h and NESAudioPacing.h
+ * Not part of the application target. Build and run with:
+ *
+ *	cc -O2 -o NESAudioRingTest NESAudioRingTest.c -lm && ./NESAudioRingTest
+ *
+ * The scripted cases step each side of the ring by hand through wraparound, underrun, overrun and flush. The paced runs
+ * then replay ten minutes of emulation against a simulated audio device, one event at a time in time order, with the
+ * frame timer and device clocks skewed. Every sample carries its sequence number, so the consumer can tell whether any
+ * sample that made it into the ring was lost or reordered. Exits nonzero on any failure.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "NESAudioRing.h"
+#include "NESAudioPacing.h"
+
+#define TEST_SAMPLE_RATE 44100
+#define TEST_BUFFER_LENGTH 1470 // The audioBufferLength default
+#define TEST_SECONDS 600.0
+#define TEST_CONVERGENCE_SECONDS 10.0
+
+static uint32_t failures = 0;
+
+#define CHECK(condition) do { if (!(condition)) { printf("FAILED %s:%d: %s\n",__FILE__,__LINE__,#condition); failures++; } } while (0)
+
+// Writes count samples numbered from *sequence, committing at the end of the storage as a caller must
+static uint32_t writeSequence(NESAudioRing *ring, uint32_t count, uint32_t *sequence)
+{
+	uint32_t written = 0;
+	uint32_t writable, index;
+	int16_t *region;
+	
+	while (written < count) {
+		
+		writable = NESAudioRingBeginWrite(ring,&region);
+		if (writable == 0) {
+			
+			NESAudioRingRecordOverrun(ring,count - written);
+			break;
+		}
+		
+		if (writable > (count - written)) writable = count - written;
+		for (index = 0; index < writable; index++) region[index] = (int16_t)((*sequence)++ & 0x7FFF);
+		NESAudioRingCommitWrite(ring,writable);
+		written += writable;
+	}
+	
+	return written;
+}
+
+static void testWraparound(void)
+{
+	NESAudioRing *ring = NESAudioRingCreate(5);
+	uint32_t sequence = 0;
+	int16_t output[8];
+	uint32_t index;
+	
+	CHECK(ring->capacity == 8);
+	
+	CHECK(writeSequence(ring,6,&sequence) == 6);
+	CHECK(NESAudioRingRead(ring,output,4) == 4);
+	for (index = 0; index < 4; index++) CHECK(output[index] == (int16_t)index);
+	
+	// Six more only fit as two runs: two up to the end of the storage, then four from its start
+	CHECK(writeSequence(ring,6,&sequence) == 6);
+	CHECK(NESAudioRingFill(ring) == 8);
+	CHECK(NESAudioRingRead(ring,output,8) == 8);
+	for (index = 0; index < 8; index++) CHECK(output[index] == (int16_t)(index + 4));
+	CHECK(NESAudioRingFill(ring) == 0);
+	CHECK(ring->underruns == 0);
+	
+	NESAudioRingDestroy(ring);
+}
+
+static void testUnderrun(void)
+{
+	NESAudioRing *ring = NESAudioRingCreate(8);
+	uint32_t sequence = 1;
+	int16_t output[5] = { -1, -1, -1, -1, -1 };
+	NESAudioRingStatistics statistics;
+	
+	writeSequence(ring,2,&sequence);
+	CHECK(NESAudioRingRead(ring,output,5) == 2);
+	CHECK((output[0] == 1) && (output[1] == 2));
+	CHECK((output[2] == 0) && (output[3] == 0) && (output[4] == 0));
+	
+	statistics = NESAudioRingGetStatistics(ring);
+	CHECK(statistics.underruns == 1);
+	CHECK(statistics.silentSamples == 3);
+	CHECK(statistics.reads == 1);
+	CHECK(statistics.fill == 0);
+	CHECK(ring->fillHistogram[4] == 1); // Two of eight is the fifth sixteenth
+	
+	NESAudioRingResetStatistics(ring);
+	statistics = NESAudioRingGetStatistics(ring);
+	CHECK((statistics.underruns == 0) && (statistics.silentSamples == 0) && (statistics.reads == 0));
+	
+	NESAudioRingDestroy(ring);
+}
+
+static void testOverrun(void)
+{
+	NESAudioRing *ring = NESAudioRingCreate(8);
+	uint32_t sequence = 0;
+	int16_t output[8];
+	int16_t *region;
+	uint32_t index;
+	
+	// Ten into eight keeps the first eight and drops the rest, without disturbing what's queued
+	CHECK(writeSequence(ring,10,&sequence) == 8);
+	CHECK(NESAudioRingBeginWrite(ring,&region) == 0);
+	CHECK(ring->overruns == 1);
+	CHECK(ring->droppedSamples == 2);
+	
+	CHECK(NESAudioRingRead(ring,output,8) == 8);
+	for (index = 0; index < 8; index++) CHECK(output[index] == (int16_t)index);
+	CHECK(ring->fillHistogram[NES_AUDIO_RING_HISTOGRAM_BINS - 1] == 1); // A full ring lands in the last bin
+	
+	NESAudioRingDestroy(ring);
+}
+
+static void testFlush(void)
+{
+	NESAudioRing *ring = NESAudioRingCreate(8);
+	uint32_t sequence = 0;
+	int16_t output[4];
+	
+	writeSequence(ring,6,&sequence);
+	
+	// Two requests before the consumer runs are honored by one discard
+	NESAudioRingRequestFlush(ring);
+	NESAudioRingRequestFlush(ring);
+	CHECK(NESAudioRingRead(ring,output,4) == 0);
+	CHECK(ring->flushAcknowledgements == ring->flushRequests);
+	CHECK(ring->underruns == 1);
+	CHECK(NESAudioRingFill(ring) == 0);
+	
+	// A request made after the consumer acknowledged the last one isn't lost
+	writeSequence(ring,3,&sequence);
+	NESAudioRingRequestFlush(ring);
+	writeSequence(ring,2,&sequence);
+	CHECK(NESAudioRingRead(ring,output,2) == 0);
+	
+	// With nothing pending, reads pick up where the producer is
+	writeSequence(ring,2,&sequence);
+	CHECK(NESAudioRingRead(ring,output,2) == 2);
+	CHECK((output[0] == 11) && (output[1] == 12));
+	
+	NESAudioRingReset(ring);
+	CHECK((NESAudioRingFill(ring) == 0) && (ring->flushRequests == 0) && (ring->flushAcknowledgements == 0));
+	
+	NESAudioRingDestroy(ring);
+}
+
+typedef struct {
+	
+	uint32_t frames;
+	uint32_t underruns; // After convergence
+	uint32_t convergenceUnderruns;
+	uint32_t overruns;
+	uint32_t outOfOrder;
+	double finalFill;
+	double finalAdjustment;
+	double finalFrameCorrection;
+	
+} NESPacingResult;
+
+/* runPacing
+ * Frames end on the emulator's fixed timeline of NTSC frame periods, stretched by the timer's skew and shifted by the
+ * controller's timing correction, and each yields the samples Blip_Buffer's 16.16 factor would resample its cycles into.
+ * The device drains a buffer at a time at its own skewed rate, starting once the first frame is queued.
+ */
+static NESPacingResult runPacing(double timerSkew, double deviceSkew)
+{
+	NESAudioRing *ring = NESAudioRingCreate(TEST_BUFFER_LENGTH * 6);
+	NESRateController controller;
+	NESPacingResult result;
+	int16_t output[TEST_BUFFER_LENGTH];
+	uint32_t producerSequence = 0;
+	uint32_t consumerSequence = 0;
+	uint32_t read, index, samples;
+	uint64_t resampledTime = 0; // 16.16, as Blip_Buffer's offset
+	uint64_t factor = (uint64_t)floor((((double)TEST_SAMPLE_RATE * 65536.0) / NES_NTSC_CPU_CLOCK_RATE) + 0.5);
+	double frameTime = 0;
+	double callbackTime = -1;
+	double callbackPeriod = TEST_BUFFER_LENGTH / (TEST_SAMPLE_RATE * (1.0 + deviceSkew));
+	uint32_t underrunsBefore;
+	
+	memset(&result,0,sizeof(NESPacingResult));
+	NESRateControllerInitialize(&controller,TEST_BUFFER_LENGTH * 3);
+	
+	while (frameTime < TEST_SECONDS) {
+		
+		// Run the device up to the frame's end, so the events interleave as they would in real time
+		while ((callbackTime >= 0) && (callbackTime <= frameTime)) {
+			
+			underrunsBefore = ring->underruns;
+			read = NESAudioRingRead(ring,output,TEST_BUFFER_LENGTH);
+			for (index = 0; index < read; index++) if (output[index] != (int16_t)(consumerSequence++ & 0x7FFF)) result.outOfOrder++;
+			if (ring->underruns != underrunsBefore) {
+				
+				if (callbackTime < TEST_CONVERGENCE_SECONDS) result.convergenceUnderruns++;
+				else result.underruns++;
+			}
+			callbackTime += callbackPeriod;
+		}
+		
+		resampledTime += (result.frames & 1) ? 29781 * factor : 29780 * factor;
+		samples = (uint32_t)(resampledTime >> 16);
+		resampledTime &= 0xFFFF;
+		writeSequence(ring,samples,&producerSequence);
+		if (callbackTime < 0) callbackTime = frameTime;
+		
+		NESRateControllerUpdate(&controller,NESAudioRingFill(ring));
+		factor = (uint64_t)floor((((double)TEST_SAMPLE_RATE * 65536.0) / NESRateControllerClockRate(&controller,NES_NTSC_CPU_CLOCK_RATE,TEST_SAMPLE_RATE)) + 0.5);
+		
+		frameTime += (NES_NTSC_FRAME_PERIOD * (1.0 + timerSkew)) + NESRateControllerTimingCorrection(&controller);
+		result.frames++;
+	}
+	
+	result.overruns = ring->overruns;
+	result.finalFill = controller.smoothedFill;
+	result.finalAdjustment = controller.adjustment;
+	result.finalFrameCorrection = controller.frameCorrection;
+	NESAudioRingDestroy(ring);
+	
+	return result;
+}
+
+static void testPacing(void)
+{
+	static const double timerSkews[] = { 0.0, 0.01, -0.01, 0.03, -0.03 };
+	static const double deviceSkews[] = { 0.001, -0.001 };
+	NESPacingResult result;
+	uint32_t timer, device;
+	double target = TEST_BUFFER_LENGTH * 3;
+	
+	printf("timer skew  device skew  frames  convergence underruns  underruns  overruns  final fill  rate adjustment  frame correction\n");
+	
+	for (timer = 0; timer < (sizeof(timerSkews) / sizeof(double)); timer++) {
+		
+		for (device = 0; device < (sizeof(deviceSkews) / sizeof(double)); device++) {
+			
+			result = runPacing(timerSkews[timer],deviceSkews[device]);
+			printf("%+9.1f%%  %+10.1f%%  %6u  %21u  %9u  %8u  %10.0f  %14.2f%%  %15.2f%%\n",timerSkews[timer] * 100,deviceSkews[device] * 100,result.frames,result.convergenceUnderruns,result.underruns,result.overruns,result.finalFill,result.finalAdjustment * 100,result.finalFrameCorrection * 100);
+			
+			// The ring starts empty, so the first reads come up short at any skew while the fill builds. Beyond 1%, the
+			// frame correction's slow integral takes over a minute to settle, and the fill swings past both ends meanwhile.
+			CHECK(result.outOfOrder == 0);
+			CHECK(result.overruns == 0);
+			CHECK(fabs(result.finalFill - target) < (target * 0.1));
+			if (fabs(timerSkews[timer]) <= 0.01) CHECK(result.underruns == 0);
+		}
+	}
+}
+
+int main(void)
+{
+	testWraparound();
+	testUnderrun();
+	testOverrun();
+	testFlush();
+	testPacing();
+	
+	printf("%s\n",failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
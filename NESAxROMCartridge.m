@@ -28,17 +28,10 @@
 
 - (void)writeByte:(uint8_t)byte toPRGROMwithCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle
 {		
-	uint_fast32_t bankCounter;
-	
 	// AxROM switches 32KB PRGROM banks
 	uint_fast32_t selected32KprgromBank = (byte & 0x7) * BANK_SIZE_32KB / PRGROM_BANK_SIZE;
 	
-	// Rebuild PRGROM pointers
-	for (bankCounter = 0; bankCounter < (PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter] = selected32KprgromBank + bankCounter;
-	}
-	[self rebuildPRGROMPointers];
+	[self mapPRGROMSlot:0 count:(PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE) toBank:selected32KprgromBank];
 	
 	// AxROM also changes the single-screen mirroring mode
 	if (byte & 0x10) [_ppu changeMirroringTypeTo:NESSingleScreenUpperMirroring onCycle:cycle];
@@ -28,20 +28,13 @@
 
 - (void)writeByte:(uint8_t)byte toPRGROMwithCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle
 {		
-	uint_fast32_t bankCounter;
-	
 	// CNROM switches 8KB CHRROM banks
 	uint_fast32_t selected8KBchrromBank = (byte & ((_iNesFlags->chrromSize / BANK_SIZE_8KB) - 1)) * BANK_SIZE_8KB / CHRROM_BANK_SIZE;
 	
 	// Run PPU before this CHRROM swap
 	[_ppu runPPUUntilCPUCycle:cycle];
 	
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter] = selected8KBchrromBank + bankCounter;
-	}
-	[self rebuildCHRROMPointers];
+	[self mapCHRROMSlot:0 count:(CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE) toBank:selected8KBchrromBank];
 }
 
 @end
@@ -39,6 +39,19 @@
 #define WRAM_SIZE 8192
 
 @class NESPPUEmulator;
+@class NESAPUEmulator;
+@class NESROMImage;
+
+typedef struct {
+	
+	uint_fast32_t frames;
+	uint_fast32_t prgromSwitches; // Windows of 8KB PRGROM slots mapped
+	uint_fast32_t chrromSwitches; // Windows of 1KB CHRROM slots mapped
+	uint_fast32_t slotsRemapped; // Slots that actually changed bank, the work done by the switches
+	uint_fast32_t unchangedSwitches; // Switches that left their window as it was
+	uint_fast32_t mostCHRROMSwitchesInFrame;
+	
+} NESBankSwitchStatistics;
 
 @interface NESCartridge : NSObject {
 
@@ -50,22 +63,33 @@
 	uint8_t	*_chrrom;
 	uint8_t *_wram;
 	BOOL _usesCHRRAM;
+	NESROMImage *_romImage; // Owns the mapped PRGROM and CHRROM
+	
+	NESBankSwitchStatistics _bankSwitchStatistics;
+	uint_fast32_t _chrromSwitchesThisFrame;
 	
 	NESPPUEmulator *_ppu;
 	iNESFlags *_iNesFlags;
 }
 
 - (id)initWithPrgrom:(uint8_t *)prgrom chrrom:(uint8_t *)chrrom ppu:(NESPPUEmulator *)ppu andiNesFlags:(iNESFlags *)flags;
+- (void)setROMImage:(NESROMImage *)image;
 - (uint8_t **)prgromBankPointers;
 - (uint8_t **)chrromBankPointers;
 - (uint_fast32_t *)chrromBankIndices;
 - (void)rebuildPRGROMPointers;
 - (void)rebuildCHRROMPointers;
+- (void)mapPRGROMSlot:(uint_fast32_t)slot count:(uint_fast32_t)count toBank:(uint_fast32_t)bank;
+- (void)mapCHRROMSlot:(uint_fast32_t)slot count:(uint_fast32_t)count toBank:(uint_fast32_t)bank;
+- (NESBankSwitchStatistics)bankSwitchStatistics;
+- (void)resetBankSwitchStatistics;
+- (void)frameEnded;
 - (uint8_t *)wram;
 - (iNESFlags *)iNesFlags;
 - (void)writeByte:(uint8_t)byte toWRAMwithCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle;
 - (void)writeByte:(uint8_t)byte toPRGROMwithCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle;
 - (void)configureInitialPPUState;
+- (void)configureExpansionAudio:(NESAPUEmulator *)apu; // Mappers with sound chips register them, and keep the APU to write them through
 - (void)setInitialROMPointers;
 - (BOOL)writeWRAMToDisk;
 - (void)servicedInterruptOnCycle:(uint_fast32_t)cycle;
@@ -23,6 +23,7 @@
 
 #import "NESCartridge.h"
 #import "NESPPUEmulator.h"
+#import "NESROMImage.h"
 
 @implementation NESCartridge
 
@@ -46,6 +47,72 @@
 		
 		_chrromBankPointers[bankCounter] = _chrrom + (_chrromBankIndices[bankCounter] * CHRROM_BANK_SIZE);
 	}
+	
+	[_ppu switchedCHRROMSlot:0 count:(CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE)];
+}
+
+/* mapPRGROMSlot:count:toBank:
+ * Points a window of 8KB PRGROM slots at consecutive banks, rewriting only that window's indices and pointers.
+ */
+- (void)mapPRGROMSlot:(uint_fast32_t)slot count:(uint_fast32_t)count toBank:(uint_fast32_t)bank
+{
+	uint_fast32_t lastSlot = slot + count;
+	uint_fast32_t slotsRemapped = 0;
+	
+	for (; slot < lastSlot; slot++, bank++) {
+		
+		if (_prgromBankIndices[slot] != bank) slotsRemapped++;
+		_prgromBankIndices[slot] = bank;
+		_prgromBankPointers[slot] = _prgrom + (bank * PRGROM_BANK_SIZE);
+	}
+	
+	_bankSwitchStatistics.prgromSwitches++;
+	_bankSwitchStatistics.slotsRemapped += slotsRemapped;
+	if (!slotsRemapped) _bankSwitchStatistics.unchangedSwitches++;
+}
+
+/* mapCHRROMSlot:count:toBank:
+ * Points a window of 1KB CHRROM slots at consecutive banks. The PPU is told which slots changed so it only drops the
+ * decoded tiles that referenced them; mappers should catch it up first.
+ */
+- (void)mapCHRROMSlot:(uint_fast32_t)slot count:(uint_fast32_t)count toBank:(uint_fast32_t)bank
+{
+	uint_fast32_t firstSlot = slot;
+	uint_fast32_t lastSlot = slot + count;
+	uint_fast32_t slotsRemapped = 0;
+	
+	for (; slot < lastSlot; slot++, bank++) {
+		
+		if (_chrromBankIndices[slot] != bank) slotsRemapped++;
+		_chrromBankIndices[slot] = bank;
+		_chrromBankPointers[slot] = _chrrom + (bank * CHRROM_BANK_SIZE);
+	}
+	
+	_bankSwitchStatistics.chrromSwitches++;
+	_bankSwitchStatistics.slotsRemapped += slotsRemapped;
+	_chrromSwitchesThisFrame++;
+	
+	if (slotsRemapped) [_ppu switchedCHRROMSlot:firstSlot count:count];
+	else _bankSwitchStatistics.unchangedSwitches++;
+}
+
+- (NESBankSwitchStatistics)bankSwitchStatistics
+{
+	return _bankSwitchStatistics;
+}
+
+- (void)resetBankSwitchStatistics
+{
+	memset(&_bankSwitchStatistics,0,sizeof(NESBankSwitchStatistics));
+	_chrromSwitchesThisFrame = 0;
+}
+
+// Called by the CPU as each frame's cycle counter is reset, closing that frame's bank switch counts
+- (void)frameEnded
+{
+	_bankSwitchStatistics.frames++;
+	if (_chrromSwitchesThisFrame > _bankSwitchStatistics.mostCHRROMSwitchesInFrame) _bankSwitchStatistics.mostCHRROMSwitchesInFrame = _chrromSwitchesThisFrame;
+	_chrromSwitchesThisFrame = 0;
 }
 
 - (id)initWithPrgrom:(uint8_t *)prgrom chrrom:(uint8_t *)chrrom ppu:(NESPPUEmulator *)ppu andiNesFlags:(iNESFlags *)flags;
@@ -57,6 +124,7 @@
 	_prgrom = prgrom;
 	_chrrom = chrrom;
 	_ppu = ppu; // Non-retained reference to the PPU
+	_romImage = nil;
 	_iNesFlags = flags;
 	_prgromBankPointers = (uint8_t **)malloc(sizeof(uint8_t *)*(PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE));
 	_chrromBankPointers = (uint8_t **)malloc(sizeof(uint8_t *)*(CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
@@ -95,8 +163,8 @@
 	free(_chrromBankPointers);
 	free(_prgromBankIndices);
 	free(_chrromBankIndices);
-	free(_prgrom);
-	free(_chrrom);
+	if (_usesCHRRAM) free(_chrrom); // CHRROM and PRGROM belong to the ROM image
+	[_romImage checkIn];
 	free(_wram);
 	[_iNesFlags->pathToFile release];
 	free(_iNesFlags);
@@ -104,6 +172,13 @@
 	[super dealloc];
 }
 
+// Takes over the caller's checkout of the image the ROM pointers were taken from
+- (void)setROMImage:(NESROMImage *)image
+{
+	[_romImage checkIn];
+	_romImage = image;
+}
+
 - (uint8_t *)wram
 {
 	return _wram;
@@ -141,11 +216,19 @@
 
 - (void)configureInitialPPUState
 {
-	if (_iNesFlags->usesVerticalMirroring) [_ppu setMirroringType:NESVerticalMirroring];
+	if (_iNesFlags->usesFourScreenVRAMLayout) [_ppu setMirroringType:NESFourScreenMirroring];
+	else if (_iNesFlags->usesVerticalMirroring) [_ppu setMirroringType:NESVerticalMirroring];
 	else [_ppu setMirroringType:NESHorizontalMirroring];
 	// FIXME: I'm not properly handling single-nametable mirroring here
 	
-	[_ppu cacheCHRROM:_chrrom length:_iNesFlags->chrromSize bankIndices:_chrromBankIndices isWritable:_usesCHRRAM];
+	if (_usesCHRRAM || (_romImage == nil)) [_ppu cacheCHRROM:_chrrom length:_iNesFlags->chrromSize bankIndices:_chrromBankIndices isWritable:_usesCHRRAM];
+	else [_ppu cacheCHRROM:_chrrom length:_iNesFlags->chrromSize bankIndices:_chrromBankIndices decodedTiles:[_romImage decodedTilesForCHRROM:_chrrom length:_iNesFlags->chrromSize]];
+}
+
+// No sound chips on the board
+- (void)configureExpansionAudio:(NESAPUEmulator *)apu
+{
+	
 }
 
 - (void)setInitialROMPointers
@@ -23,6 +23,7 @@
 
 #import "NESCartridgeEmulator.h"
 #import "NESPPUEmulator.h"
+#import "NESROMImage.h"
 #import "NESUxROMCartridge.h"
 #import "NESCNROMCartridge.h"
 #import "NESAxROMCartridge.h"
@@ -189,23 +190,21 @@ static const char *mapperDescriptions[256] = { "No mapper", "Nintendo MMC1", "UN
 
 - (NSError *)_loadiNESFileAtPath:(NSString *)path
 {
-	// uint_fast8_t bank;
-	NSData *rom;
-	// NSData *savedSram;
 	NSError *propagatedError = nil;
-	NSFileHandle *fileHandle = [NSFileHandle fileHandleForReadingAtPath:path];
+	NESROMImage *image = [NESROMImage checkOutImageAtPath:path error:&propagatedError];
+	const uint8_t *romBytes;
+	size_t romOffset;
 	
-	if (fileHandle == nil) {
-		
-		return [NSError errorWithDomain:@"NESFileErrorDomain" code:1 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"File could not be opened.",NSLocalizedDescriptionKey,@"Macifom was unable to open the file selected.",NSLocalizedRecoverySuggestionErrorKey,path,NSFilePathErrorKey,nil]];
-	}
+	if (image == nil) return propagatedError;
 	
-	NSData *header = [fileHandle readDataOfLength:16]; // Attempt to load 16 byte iNES Header
+	romBytes = [image bytes];
+	NSData *header = [NSData dataWithBytesNoCopy:(void *)romBytes length:MIN([image length],16) freeWhenDone:NO]; // Attempt to load 16 byte iNES Header
 	
 	// File format validation, must be iNES
 	// Should check if the file is 4 chars long, need to figure out fourth char in header format
-	if ((*((const char *)[header bytes]) != 'N') || (*((const char *)[header bytes]+1) != 'E') || (*((const char *)[header bytes]+2) != 'S')) {
+	if (([header length] < 3) || (*((const char *)[header bytes]) != 'N') || (*((const char *)[header bytes]+1) != 'E') || (*((const char *)[header bytes]+2) != 'S')) {
 	
+		[image checkIn];
 		return [NSError errorWithDomain:@"NESFileErrorDomain" code:2 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"File is not in iNES format.",NSLocalizedDescriptionKey,@"Macifom was unable to parse the selected file as it does not appear to be in iNES format.",NSLocalizedRecoverySuggestionErrorKey,path,NSFilePathErrorKey,nil]];
 	}
 	
@@ -221,60 +220,47 @@ static const char *mapperDescriptions[256] = { "No mapper", "Nintendo MMC1", "UN
 	// Load ROM Options
 	if (nil != (propagatedError = [self _loadiNESROMOptions:header])) {
 	
+		[image checkIn];
 		return propagatedError;
 	}
+	romOffset = 16;
 	
 	// Recent research has shown that trainers are exceedingly rare, we'll just read if present
+	if (_lastHeader->hasTrainer) romOffset += 512;
+	
+	// The header, and trainer if flagged, must be present in full before anything is copied out of the mapping
+	if ([image length] < romOffset) {
+		
+		[image checkIn];
+		return [NSError errorWithDomain:@"NESFileErrorDomain" code:4 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"iNES file is corrupt.",NSLocalizedDescriptionKey,@"Macifom was unable to parse the selected file as the iNES header is corrupt.",NSLocalizedRecoverySuggestionErrorKey,path,NSFilePathErrorKey,nil]];
+	}
+	
 	if (_lastHeader->hasTrainer) {
 	
 		if (_trainer == NULL) _trainer = (uint8_t *)malloc(sizeof(uint8_t)*512);
-		NSData *trainer = [fileHandle readDataOfLength:512];
-		[trainer getBytes:_trainer];
+		memcpy(_trainer,romBytes + 16,512);
 	}
 	
-	// Extract PRGROM Banks
-	_prgrom = (uint8_t *)malloc(sizeof(uint8_t) * _lastHeader->numberOf16kbPRGROMBanks * BANK_SIZE_16KB);
-	rom = [fileHandle readDataOfLength:(_lastHeader->numberOf16kbPRGROMBanks * BANK_SIZE_16KB)];
-	if ([rom length] != (_lastHeader->numberOf16kbPRGROMBanks * BANK_SIZE_16KB)) {
+	// PRGROM and CHRROM banks are used in place, straight from the read-only mapping
+	_lastHeader->prgromSize = _lastHeader->numberOf16kbPRGROMBanks * BANK_SIZE_16KB;
+	_lastHeader->chrromSize = _lastHeader->numberOf8kbCHRROMBanks * BANK_SIZE_8KB;
+	if ((romOffset + _lastHeader->prgromSize + _lastHeader->chrromSize) > [image length]) {
 		
-		free(_prgrom);
+		[image checkIn];
 		_prgrom = NULL;
-		return [NSError errorWithDomain:@"NESFileErrorDomain" code:3 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"ROM data could not be extracted.",NSLocalizedDescriptionKey,@"Macifom was unable to extract the ROM data from the selected file. This is likely due to file corruption or inaccurate header information.",NSLocalizedRecoverySuggestionErrorKey,path,NSFilePathErrorKey,nil]];
-	}
-	else {
-	
-		_lastHeader->prgromSize = [rom length];
-		[rom getBytes:_prgrom];
-	}
-	 
-	// Extract CHRROM Banks
-	if (_lastHeader->numberOf8kbCHRROMBanks) {
-		
-		_chrrom = (uint8_t *)malloc(sizeof(uint8_t) * _lastHeader->numberOf8kbCHRROMBanks * BANK_SIZE_8KB);
-		rom = [fileHandle readDataOfLength:(_lastHeader->numberOf8kbCHRROMBanks * BANK_SIZE_8KB)];
-		if ([rom length] != (_lastHeader->numberOf8kbCHRROMBanks * BANK_SIZE_8KB)) {
-		
-			free(_chrrom);
-			_chrrom = NULL;
-			return [NSError errorWithDomain:@"NESFileErrorDomain" code:3 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"ROM data could not be extracted.",NSLocalizedDescriptionKey,@"Macifom was unable to extract the ROM data from the selected file. This is likely due to file corruption or inaccurate header information.",NSLocalizedRecoverySuggestionErrorKey,path,NSFilePathErrorKey,nil]];
-		}
-		else {
-		
-			_lastHeader->chrromSize = [rom length];
-			[rom getBytes:_chrrom];
-		}
-	}
-	else {
-	
-		_lastHeader->chrromSize = 0;
 		_chrrom = NULL;
+		return [NSError errorWithDomain:@"NESFileErrorDomain" code:3 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"ROM data could not be extracted.",NSLocalizedDescriptionKey,@"Macifom was unable to extract the ROM data from the selected file. This is likely due to file corruption or inaccurate header information.",NSLocalizedRecoverySuggestionErrorKey,path,NSFilePathErrorKey,nil]];
 	}
 	
-	// Close ROM file
-	[fileHandle closeFile];
+	_prgrom = (uint8_t *)romBytes + romOffset;
+	_chrrom = _lastHeader->chrromSize ? (uint8_t *)romBytes + romOffset + _lastHeader->prgromSize : NULL; // The cartridge allocates CHRRAM when absent
 		
 	// Load appropriate cartridge class for mapper number
 	propagatedError = [self _createCartridgeInstance];
+	
+	// The cartridge keeps the image checked out for as long as it points into it
+	if (propagatedError == nil) [_cartridge setROMImage:image];
+	else [image checkIn];
 
 	return propagatedError;
 }
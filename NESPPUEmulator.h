@@ -22,6 +22,7 @@
  */
 
 #import <Foundation/Foundation.h>
+#import <dispatch/dispatch.h>
 
 #define CYCLES_OF_VBLANK 6820
 #define CYCLES_BEFORE_RENDERING_SHORT 7160
@@ -33,16 +34,144 @@
 
 typedef uint8_t (*RegisterReadMethod)(id, SEL, uint_fast32_t);
 typedef void (*RegisterWriteMethod)(id, SEL, uint8_t, uint_fast32_t);
-typedef uint16_t (*NametableMirroringMethod)(uint16_t);
 
 typedef enum {
 
 	NESHorizontalMirroring = 0,
 	NESVerticalMirroring = 1,
 	NESSingleScreenLowerMirroring = 2,
-	NESSingleScreenUpperMirroring = 3
+	NESSingleScreenUpperMirroring = 3,
+	NESFourScreenMirroring = 4
 } NESMirroringType;
 
+typedef struct {
+	
+	uint8_t *tile; // 8x8 decoded pixels in the tile cache
+	uint8_t upperColorBits;
+	
+} NESBackgroundTile;
+
+typedef struct {
+	
+	uint_fast32_t tilesUpdated; // Descriptors refreshed in place by $2007 writes
+	uint_fast32_t rowsResolved; // Dirty rows of 32 descriptors rebuilt before rendering
+	uint_fast32_t fullInvalidations; // Nametable page remaps, pattern table changes or every background bank switched
+	uint_fast32_t bankSwitchInvalidations; // Rows dropped because they hold tiles from a switched CHR bank
+	uint_fast32_t fullRebuilds; // CHR (re)attached, e.g. a cartridge load or CHR-RAM moved to new pages, dropping everything
+	
+} NESBackgroundTileStatistics;
+
+typedef struct {
+	
+	uint_fast32_t hits;
+	uint_fast32_t misses;
+	
+} NESScanlineMemoStatistics;
+
+typedef struct {
+	
+	uint8_t registers[8]; // VRAM address, fine horizontal scroll, both control registers and the sprite count
+	uint8_t palettes[32];
+	uint8_t preloadedTiles[16];
+	uint32_t chrramGeneration;
+	uint32_t tiles[31]; // Tile cache offset of each tile the line crosses, a multiple of 64, ORed with its upper color bits
+	uint32_t sprites[8]; // Each in-range sprite's row, lower plane in the low byte, then upper plane, attributes and X
+	
+} NESScanlineMemoKey;
+
+typedef enum {
+	
+	NESPPUTimingRegisterWrite = 0,
+	NESPPUTimingOAMDMA = 1,
+	NESPPUTimingMapperIRQ = 2,
+	NESPPUTimingSprite0Hit = 3
+} NESPPUTimingEventType;
+
+typedef struct {
+	
+	uint16_t scanline; // 0-239 visible, 240 post-render, 241-260 VBLANK, 261 priming
+	uint16_t dot;
+	uint8_t type;
+	uint8_t address; // Register for writes
+	uint8_t value;
+	uint8_t reserved;
+	
+} NESPPUTimingEvent;
+
+typedef enum {
+	
+	NESPPURegisterWriteEvent = 0,
+	NESPPURegisterReadEvent = 1,
+	NESPPUOAMDMAEvent = 2,
+	NESPPUNameTablePageEvent = 3,
+	NESPPUCHRBankEvent = 4,
+	NESPPUFrameEndEvent = 5
+} NESPPUEventType;
+
+typedef struct {
+	
+	uint_fast32_t cycle; // CPU cycle passed by the caller
+	uint_fast32_t ppuCPUCycle; // CPU cycle the PPU had caught up to when the event took effect
+	uint_fast32_t argument; // CHR bank, nametable page or offset of OAM DMA data
+	uint16_t address; // PPU register, logical nametable or CHR slot
+	uint8_t type;
+	uint8_t value;
+	
+} NESPPUEvent;
+
+typedef struct {
+	
+	uint8_t nameAndAttributeTables[4096];
+	uint8_t sprRAM[256];
+	uint8_t palettes[32];
+	uint8_t playfieldBuffer[16];
+	uint_fast8_t spritesOnCurrentScanline[8];
+	uint_fast32_t chrromBankIndices[8];
+	uint_fast32_t nameTablePages[4]; // Internal page index or offset into CHR-ROM
+	uint8_t nameTablePageFlags[4]; // Bit 0 set if writable, bit 1 set if internal
+	uint_fast32_t spriteTileCacheIndex;
+	uint_fast32_t backgroundTileCacheIndex;
+	uint16_t VRAMAddress;
+	uint16_t temporaryVRAMAddress;
+	uint8_t scanline;
+	uint8_t controlRegister1;
+	uint8_t controlRegister2;
+	uint8_t fineHorizontalScroll;
+	uint8_t colorIntensity;
+	uint_fast8_t numberOfSpritesOnScanline;
+	BOOL tallSprites;
+	BOOL monochrome;
+	BOOL clipBackground;
+	BOOL clipSprites;
+	BOOL backgroundEnabled;
+	BOOL spritesEnabled;
+	BOOL shortenPrimingScanline;
+	
+} NESPPUBandSnapshot;
+
+typedef struct {
+	
+	uint_fast32_t frames;
+	uint_fast32_t bands;
+	uint64_t renderNanoseconds;
+	
+} NESPPUBandStatistics;
+
+typedef struct {
+	
+	NESPPUEvent *events;
+	uint_fast32_t count;
+	uint_fast32_t capacity;
+	uint8_t *data;
+	uint_fast32_t dataLength;
+	uint_fast32_t dataCapacity;
+	NESPPUBandSnapshot *bands;
+	uint_fast32_t bandCount;
+	uint_fast32_t bandCapacity;
+	BOOL rendersOutput;
+	
+} NESPPUEventLog;
+
 typedef struct {
 	
 	uint8_t controlRegister1;
@@ -52,6 +181,24 @@ typedef struct {
 	
 } PPUState;
 
+typedef enum {
+	
+	NESPPUControlChangedHook = 0,
+	NESPPUA12RiseHook,
+	NESPPUScanlineStartHook,
+	NESPPUFrameEndHook,
+	NESPPUNumberOfHooks
+} NESPPUHookType;
+
+typedef void (*NESPPUHookFunction)(void *context, const PPUState *state);
+
+typedef struct {
+	
+	NESPPUHookFunction function;
+	void *context;
+	
+} NESPPUHook;
+
 @interface NESPPUEmulator : NSObject {
 
 	uint8_t _ppuControlRegister1;
@@ -76,7 +223,14 @@ typedef struct {
 	uint_fast32_t *_chrromBankIndices;
 	BOOL *_chrramWriteHistory;
 	uint8_t *_chrrom;
-	uint8_t ****_tileCache;
+	uint8_t *_tileCache;
+	BOOL _ownsTileCache; // NO when the decoded tiles are shared with other PPUs
+	
+	NESBackgroundTile *_backgroundTiles;
+	uint32_t _dirtyBackgroundTileRows[4];
+	uint8_t _backgroundTileRowBanks[4][32];
+	uint_fast32_t _resolvedBackgroundBanks[4];
+	NESBackgroundTileStatistics _backgroundTileStatistics;
 	
 	uint_fast32_t _sprite0HitCycle;
 	uint_fast32_t _lastCPUCycle;
@@ -91,9 +245,8 @@ typedef struct {
 	uint8_t _addressIncrement;
 	uint8_t _colorIntensity;
 	
-	uint16_t _nameAndAttributeTablesMask;
-	uint16_t *_nameAndAttributeTablesMasks;
-	NametableMirroringMethod _nameTableMirroring;
+	uint8_t *_nameTablePages[4];
+	BOOL _nameTablePageIsWritable[4];
 	RegisterWriteMethod *_registerWriteMethods;
 	RegisterReadMethod *_registerReadMethods;
 	
@@ -114,13 +267,55 @@ typedef struct {
 	BOOL _usingCHRRAM;
 	BOOL _frameEnded;
 	BOOL _shortenPrimingScanline;
+	BOOL _rendersOutput;
+	BOOL _validatesLogicOnlyRendering;
+	
+	uint32_t _logicOnlyScanlineHash;
+	uint_fast32_t _logicOnlyValidationMismatches;
+	
+	uint_fast32_t _chrromSize;
+	NESPPUEmulator *_deferredRenderer;
+	NESPPUEventLog *_deferredLogs;
+	NESPPUEventLog *_recordingLog;
+	NESPPUEventLog *_replayingLog;
+	uint_fast32_t _deferredCHRROMBankIndices[8];
+	uint_fast32_t *_deferredVideoBuffer;
+	dispatch_queue_t _deferredRenderQueue;
+	dispatch_group_t _deferredRenderGroup;
+	BOOL _deferredRendering;
+	
+	uint_fast32_t _renderWorkers;
+	NESPPUEmulator **_bandRenderers;
+	uint_fast32_t *_bandCHRROMBankIndices;
+	BOOL _bandStateChanged;
+	NESPPUBandStatistics _bandStatistics;
 	
-	NSInvocation *_stateObservingInvocation;
-	PPUState *_observerState;
+	NESScanlineMemoKey *_scanlineKeys;
+	uint64_t _memoizedScanlines[4];
+	uint64_t _changedScanlines[4];
+	uint_fast32_t _chrramGeneration;
+	NESScanlineMemoStatistics _scanlineMemoStatistics;
+	BOOL _memoizesScanlines;
+	
+	uint_fast32_t *_colorTables;
+	uint16_t *_colorTables16;
+	const uint_fast32_t *_colorTable;
+	
+	NESPPUTimingEvent *_timingEvents;
+	NESPPUTimingEvent *_completedTimingEvents;
+	uint_fast32_t _numberOfTimingEvents;
+	uint_fast32_t _numberOfCompletedTimingEvents;
+	BOOL _recordsTimingEvents;
+	
+	NESPPUHook _hooks[NESPPUNumberOfHooks];
+	PPUState _hookState;
+	uint_fast32_t _a12RiseDot;
 }
 
 - (id)initWithBuffer:(uint_fast32_t *)buffer;
++ (uint8_t *)newTileCacheForCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size;
 - (void)cacheCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size bankIndices:(uint_fast32_t *)indices isWritable:(BOOL)isWritable;
+- (void)cacheCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size bankIndices:(uint_fast32_t *)indices decodedTiles:(uint8_t *)tiles;
 - (void)toggleDebugging:(BOOL)flag;
 - (void)runPPU:(uint_fast32_t)cycles;
 - (BOOL)runPPUUntilCPUCycle:(uint_fast32_t)cycle;
@@ -144,9 +339,66 @@ typedef struct {
 - (void)writeByte:(uint8_t)byte toPPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle;
 - (void)setMirroringType:(NESMirroringType)type;
 - (void)changeMirroringTypeTo:(NESMirroringType)type onCycle:(uint_fast32_t)cycle;
+- (uint8_t *)nameTableMemoryPage:(uint_fast8_t)page;
+- (void)setNameTable:(uint_fast8_t)nameTable toPage:(uint8_t *)page isWritable:(BOOL)writable;
 - (uint_fast32_t)cpuCyclesUntilVblank;
 - (uint_fast32_t)cpuCyclesUntilPrimingScanline;
 - (BOOL)shortenPrimingScanline;
-- (void)observeStateForTarget:(id)target andSelector:(SEL)selector;
+- (void)setHook:(NESPPUHookType)type function:(NESPPUHookFunction)function context:(void *)context;
+- (NESBackgroundTileStatistics)backgroundTileStatistics;
+- (void)resetBackgroundTileStatistics;
+- (void)switchedCHRROMSlot:(uint_fast32_t)slot count:(uint_fast32_t)count;
+- (void)setRendersOutput:(BOOL)flag;
+- (BOOL)rendersOutput;
+- (void)setValidatesLogicOnlyRendering:(BOOL)flag;
+- (uint_fast32_t)logicOnlyValidationMismatches;
+- (uint32_t)observableStateHash;
+- (BOOL)setDeferredRendering:(BOOL)flag;
+- (BOOL)deferredRendering;
+- (void)setRenderWorkers:(uint_fast32_t)workers;
+- (uint_fast32_t)renderWorkers;
+- (NESPPUBandStatistics)bandStatistics;
+- (void)resetBandStatistics;
+- (void)setMemoizesScanlines:(BOOL)flag;
+- (BOOL)memoizesScanlines;
+- (NESScanlineMemoStatistics)scanlineMemoStatistics;
+- (void)resetScanlineMemoStatistics;
+- (void)takeChangedScanlines:(uint64_t *)changedScanlines;
+- (double)benchmarkFramesPerSecondWithEngine:(Class)engine frames:(uint_fast32_t)frames;
+- (uint_fast32_t)bandRenderingMismatchesWithWorkers:(uint_fast32_t)workers frames:(uint_fast32_t)frames;
+- (uint_fast32_t)mismatchedFramesWithEngine:(Class)engine frames:(uint_fast32_t)frames;
+- (BOOL)loadPaletteFromFile:(NSString *)path;
+- (void)resetPalette;
+- (const uint_fast32_t *)colorTableForMask:(uint8_t)mask;
+- (const uint16_t *)colorTable16ForMask:(uint8_t)mask;
+- (void)setRecordsTimingEvents:(BOOL)flag;
+- (BOOL)recordsTimingEvents;
+- (void)recordMapperIRQOnCycle:(uint_fast32_t)cycle;
+- (const NESPPUTimingEvent *)completedTimingEvents:(uint_fast32_t *)count;
+- (void)drawTimingMapIntoBuffer:(uint_fast32_t *)buffer;
+- (NSString *)timingEventLogDescription;
+- (BOOL)writeTimingEventLogToFile:(NSString *)path;
+
+@end
+
+// Steps the PPU one dot at a time with the hardware's shift registers and fetch timing
+@interface NESDotPPUEmulator : NESPPUEmulator
+{
+	uint16_t _patternLowShifter;
+	uint16_t _patternHighShifter;
+	uint16_t _attributeLowShifter;
+	uint16_t _attributeHighShifter;
+	uint8_t _nextTileIndex;
+	uint8_t _nextTileAttribute;
+	uint8_t _nextTileLowPlane;
+	uint8_t _nextTileHighPlane;
+	
+	uint_fast32_t _lineSpriteLowPlanes[8];
+	uint_fast32_t _lineSpriteHighPlanes[8];
+	uint8_t _lineSpriteHorizontalOffsets[8];
+	uint8_t _lineSpriteAttributes[8];
+	uint_fast8_t _numberOfLineSprites;
+	BOOL _sprite0OnLine;
+}
 
 @end
@@ -23,7 +23,13 @@
 
 #import "NESPPUEmulator.h"
 #import "NESCartridge.h"
+#import <mach/mach_time.h>
 
+// One frame can't hold more register writes than this at one per CPU cycle
+#define MAXIMUM_TIMING_EVENTS 30000
+#define TIMING_MAP_WIDTH 341
+#define TIMING_MAP_HEIGHT 262
+#define TILE_CACHE_BANK_SIZE ((CHRROM_BANK_SIZE / 16) * 64) // 64 decoded tiles of 8x8 pixels per 1KB bank
 #define NMI_DELAY 6 // The earliest NMI can occur is two CPU cycles after it is triggered - see http://nesdev.parodius.com/bbs/viewtopic.php?t=1892
 // FIXME: This delay isn't correct, per Blargg:
 /* Based on recent testing, the earliest the NMI can occur is two CPU clocks after the VBL flag is set. 
@@ -42,6 +48,24 @@ static const uint_fast32_t colorPalette[64] = { 0xFF757575, 0xFF271B8F, 0xFF0000
 												0xFFFFFFFF, 0xFFABE7FF, 0xFFC7D7FF, 0xFFD7CBFF, 0xFFFFC7FF, 0xFFFFC7DB, 0xFFFFBFB3, 0xFFFFDBAB,
 												0xFFFFE7A3, 0xFFE3FFA3, 0xFFABF3BF, 0xFFB3FFCF, 0xFF9FFFF3, 0xFF000000, 0xFF000000, 0xFF000000 };
 
+// Bit-reversed bytes, used to turn MSB-first pattern table rows into pixel-ordered sprite rows
+static const uint8_t reversedBits[256] = { 0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0,
+											0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8, 0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8,
+											0x04, 0x84, 0x44, 0xC4, 0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
+											0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC, 0x3C, 0xBC, 0x7C, 0xFC,
+											0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2, 0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2,
+											0x0A, 0x8A, 0x4A, 0xCA, 0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+											0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6, 0x36, 0xB6, 0x76, 0xF6,
+											0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE, 0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE,
+											0x01, 0x81, 0x41, 0xC1, 0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+											0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9, 0x39, 0xB9, 0x79, 0xF9,
+											0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5, 0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5,
+											0x0D, 0x8D, 0x4D, 0xCD, 0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+											0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3, 0x33, 0xB3, 0x73, 0xF3,
+											0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB, 0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB,
+											0x07, 0x87, 0x47, 0xC7, 0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
+											0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF };
+
 // Checked 1/3
 static inline void incrementVRAMAddressHorizontally(uint16_t *vramAddress) {
 
@@ -90,6 +114,278 @@ static inline uint8_t upperColorBitsFromAttributeByte(uint8_t attributeByte, uin
 	return ((attributeByte >> ((nametableIndex & 0x2) | ((nametableIndex >> 4) & 0x4))) & 0x3) << 2;
 }
 
+/* buildColorTables
+ * Expands a palette into the sixteen tables PPUMASK can select: the three emphasis bits times greyscale, indexed by
+ * ((mask >> 5) * 2) | greyscale. A 64-color palette has emphasis applied by dimming each channel that isn't emphasized
+ * whenever any emphasis bit is set; a 512-color palette already carries an entry per emphasis combination.
+ * Each table is emitted as ARGB8888 and as xRGB1555.
+ */
+static void buildColorTables(const uint_fast32_t *baseColors, uint_fast32_t numberOfColors, uint_fast32_t *tables, uint16_t *tables16) {
+	
+	uint_fast32_t emphasis, greyscale, colorIndex, sourceColor, channel, component;
+	uint_fast32_t color;
+	uint_fast32_t *table;
+	
+	for (emphasis = 0; emphasis < 8; emphasis++) {
+		
+		for (greyscale = 0; greyscale < 2; greyscale++) {
+			
+			table = tables + ((emphasis * 2 + greyscale) * 64);
+			
+			for (colorIndex = 0; colorIndex < 64; colorIndex++) {
+				
+				// Greyscale keeps only the luminance column
+				sourceColor = greyscale ? (colorIndex & 0x30) : colorIndex;
+				
+				if (numberOfColors == 512) color = baseColors[(emphasis * 64) + sourceColor];
+				else {
+					
+					color = baseColors[sourceColor];
+					
+					if (emphasis) {
+						
+						// Channel 0 is red (emphasis bit 0), then green and blue
+						for (channel = 0; channel < 3; channel++) {
+							
+							if (emphasis & (1 << channel)) continue; // Only the channels not emphasized are dimmed
+							component = (color >> (16 - (channel * 8))) & 0xFF;
+							color = (color & ~(0xFFUL << (16 - (channel * 8)))) | (((component * 209) / 256) << (16 - (channel * 8)));
+						}
+					}
+				}
+				
+				table[colorIndex] = color | 0xFF000000;
+				tables16[(emphasis * 2 + greyscale) * 64 + colorIndex] = (uint16_t)((((color >> 19) & 0x1F) << 10) | (((color >> 11) & 0x1F) << 5) | ((color >> 3) & 0x1F));
+			}
+		}
+	}
+}
+
+static inline void setLineMaskBit(uint64_t *lineMask, uint_fast32_t pixel) {
+	
+	lineMask[pixel >> 6] |= (uint64_t)1 << (pixel & 63);
+}
+
+// Sets the color of every pixel in pixelBits (a 64-pixel word of a scanline) from the sprite line buffer
+static inline void composeSpritePixels(uint_fast32_t *scanlineBuffer, const uint8_t *spriteLine, const uint8_t *spritePalette, const uint_fast32_t *colorTable, uint64_t pixelBits, uint_fast32_t firstPixel) {
+	
+	uint_fast32_t pixel;
+	
+	while (pixelBits) {
+		
+		pixel = firstPixel + __builtin_ctzll(pixelBits);
+		scanlineBuffer[pixel] = colorTable[spritePalette[spriteLine[pixel]]];
+		pixelBits &= pixelBits - 1;
+	}
+}
+
+/* fetchSpriteRow
+ * Reads the row of a sprite's pattern that falls on the given scanline as two bit planes, leftmost pixel in bit 0.
+ * Pattern rows keep the leftmost pixel in the high bit, so only unflipped sprites are reversed.
+ */
+static inline void fetchSpriteRow(const uint8_t *sprite, uint_fast8_t scanline, BOOL tallSprites, uint_fast32_t spriteTileCacheIndex, const uint_fast32_t *chrromBankIndices, const uint8_t *chrrom, uint_fast32_t *lowerPlane, uint_fast32_t *upperPlane) {
+	
+	// FIXME: If it turns out that sprites on scanline 0 have Y coords of 0xFF then I'll need to add back (uint8_t) to make sure the addition overflows.
+	uint_fast8_t verticalOffset = scanline - (sprite[0] + 1);
+	uint_fast8_t tileIndex;
+	uint_fast32_t bankIndex;
+	uint_fast32_t chrromOffset;
+	
+	if (sprite[2] & 0x80) verticalOffset = (tallSprites ? 15 : 7) - verticalOffset;
+	tileIndex = tallSprites ? ((sprite[1] & 0xFE) + (verticalOffset / 8)) : sprite[1];
+	bankIndex = chrromBankIndices[(tallSprites ? ((sprite[1] & 0x1) ? (BANK_SIZE_4KB / CHRROM_BANK_SIZE) : 0) : spriteTileCacheIndex) + (tileIndex / (CHRROM_BANK_SIZE / 16))];
+	chrromOffset = (bankIndex * CHRROM_BANK_SIZE) + ((tileIndex & ((CHRROM_BANK_SIZE / 16) - 1)) * 16) + (verticalOffset & 0x7);
+	
+	if (sprite[2] & 0x40) {
+		
+		*lowerPlane = chrrom[chrromOffset];
+		*upperPlane = chrrom[chrromOffset + 8];
+	}
+	else {
+		
+		*lowerPlane = reversedBits[chrrom[chrromOffset]];
+		*upperPlane = reversedBits[chrrom[chrromOffset + 8]];
+	}
+}
+
+// Positions a sprite's opaque pixels within the scanline mask, spilling into the next word when needed. Returns the first word.
+static inline uint_fast32_t positionSpriteRow(uint_fast32_t opaquePixels, uint_fast32_t horizontalOffset, BOOL clipSprites, uint64_t *rowMask) {
+	
+	uint_fast32_t maskWord = horizontalOffset >> 6;
+	uint_fast32_t pixelShift = horizontalOffset & 63;
+	
+	rowMask[0] = (uint64_t)opaquePixels << pixelShift;
+	rowMask[1] = ((pixelShift > 56) && (maskWord < 3)) ? (uint64_t)opaquePixels >> (64 - pixelShift) : 0;
+	if (clipSprites && (maskWord == 0)) rowMask[0] &= ~(uint64_t)0xFF;
+	
+	return maskWord;
+}
+
+// Sprite 0 hits on the first pixel opaque in both the sprite and the background, excluding pixel 255
+static inline BOOL findSprite0Hit(const uint64_t *rowMask, uint_fast32_t maskWord, const uint64_t *bgOpacityMask, uint_fast32_t *hitPixel) {
+	
+	uint64_t hitPixels = rowMask[0] & bgOpacityMask[maskWord];
+	
+	if (maskWord == 3) hitPixels &= ~((uint64_t)1 << 63);
+	
+	if (!hitPixels && rowMask[1]) {
+		
+		hitPixels = rowMask[1] & bgOpacityMask[++maskWord];
+		if (maskWord == 3) hitPixels &= ~((uint64_t)1 << 63);
+	}
+	
+	if (!hitPixels) return NO;
+	
+	*hitPixel = (maskWord * 64) + __builtin_ctzll(hitPixels);
+	return YES;
+}
+
+// FNV-1a over the state a scanline can change, used to check logic-only scanlines against rendered ones
+static inline uint32_t hashScanlineSideEffects(uint16_t vramAddress, BOOL sprite0Hit, uint_fast32_t sprite0HitCycle) {
+	
+	uint_fast32_t values[3] = { vramAddress, sprite0Hit, sprite0Hit ? sprite0HitCycle : 0 };
+	uint32_t hash = 2166136261U;
+	uint_fast32_t index;
+	
+	for (index = 0; index < 3; index++) {
+		
+		hash ^= (uint32_t)values[index];
+		hash *= 16777619U;
+	}
+	
+	return hash;
+}
+
+static inline uint32_t hashBytes(uint32_t hash, const uint8_t *bytes, uint_fast32_t length) {
+	
+	uint_fast32_t index;
+	
+	for (index = 0; index < length; index++) {
+		
+		hash ^= bytes[index];
+		hash *= 16777619U;
+	}
+	
+	return hash;
+}
+
+// Converts a PPU cycle counted from VINT to the conventional scanline and dot
+static inline void timingPositionForPPUCycle(uint_fast32_t cycle, BOOL shortenPrimingScanline, uint16_t *scanline, uint16_t *dot) {
+	
+	uint_fast32_t renderingStart = shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL;
+	
+	if (cycle < CYCLES_OF_VBLANK) {
+		
+		*scanline = 241 + (cycle / CYCLES_IN_SCANLINE_NORMAL);
+		*dot = cycle % CYCLES_IN_SCANLINE_NORMAL;
+	}
+	else if (cycle < renderingStart) {
+		
+		*scanline = 261;
+		*dot = cycle - CYCLES_OF_VBLANK;
+	}
+	else {
+		
+		*scanline = (cycle - renderingStart) / CYCLES_IN_SCANLINE_NORMAL;
+		*dot = (cycle - renderingStart) % CYCLES_IN_SCANLINE_NORMAL;
+		if (*scanline > 240) *scanline = 240;
+	}
+}
+
+static inline void callPPUHook(const NESPPUHook *hook, PPUState *state, uint8_t controlRegister1, uint8_t controlRegister2, uint8_t statusRegister, uint_fast32_t cycle) {
+	
+	if (hook->function == NULL) return;
+	
+	state->controlRegister1 = controlRegister1;
+	state->controlRegister2 = controlRegister2;
+	state->statusRegister = statusRegister;
+	state->cycle = cycle;
+	hook->function(hook->context, state);
+}
+
+/* a12RiseDotForSpriteFetches
+ * Finds the first dot of the sprite and prefetch fetches (257-340) on which PPU A12 goes from low to high, or 0 if it
+ * stays put. Slots without a sprite fetch tile $FF, which for 8x16 sprites lands in the $1000 table.
+ */
+static inline uint_fast32_t a12RiseDotForSpriteFetches(uint8_t controlRegister1, const uint8_t *sprRAM, const uint_fast8_t *lineSprites, uint_fast8_t numberOfSprites) {
+	
+	BOOL backgroundHigh = (controlRegister1 & 0x10) ? YES : NO;
+	BOOL high = backgroundHigh;
+	BOOL slotHigh;
+	uint_fast8_t slot;
+	
+	for (slot = 0; slot < 8; slot++) {
+		
+		if (controlRegister1 & 0x20) slotHigh = (slot < numberOfSprites) ? (sprRAM[lineSprites[slot] + 1] & 0x1) : YES;
+		else slotHigh = (controlRegister1 & 0x8) ? YES : NO;
+		
+		if (slotHigh && !high) return 260 + (slot * 8);
+		high = slotHigh;
+	}
+	
+	// The next line's background fetches start on dot 321
+	return (backgroundHigh && !high) ? 324 : 0;
+}
+
+static inline NESPPUEvent *appendEventToLog(NESPPUEventLog *log) {
+	
+	if (log->count == log->capacity) {
+		
+		log->capacity *= 2;
+		log->events = (NESPPUEvent *)realloc(log->events,sizeof(NESPPUEvent) * log->capacity);
+	}
+	
+	return log->events + log->count++;
+}
+
+static inline uint_fast32_t appendDataToLog(NESPPUEventLog *log, const uint8_t *bytes, uint_fast32_t length) {
+	
+	uint_fast32_t offset = log->dataLength;
+	
+	while ((log->dataLength + length) > log->dataCapacity) {
+		
+		log->dataCapacity *= 2;
+		log->data = (uint8_t *)realloc(log->data,sizeof(uint8_t) * log->dataCapacity);
+	}
+	
+	memcpy(log->data + offset,bytes,length);
+	log->dataLength += length;
+	
+	return offset;
+}
+
+static inline void initializeEventLog(NESPPUEventLog *log) {
+	
+	log->capacity = 1024;
+	log->events = (NESPPUEvent *)malloc(sizeof(NESPPUEvent) * log->capacity);
+	log->count = 0;
+	log->dataCapacity = 2048;
+	log->data = (uint8_t *)malloc(sizeof(uint8_t) * log->dataCapacity);
+	log->dataLength = 0;
+	log->bandCapacity = 8;
+	log->bands = (NESPPUBandSnapshot *)malloc(sizeof(NESPPUBandSnapshot) * log->bandCapacity);
+	log->bandCount = 0;
+	log->rendersOutput = YES;
+}
+
+static inline void freeEventLog(NESPPUEventLog *log) {
+	
+	free(log->events);
+	free(log->data);
+	free(log->bands);
+}
+
+static inline NESPPUBandSnapshot *appendBandToLog(NESPPUEventLog *log) {
+	
+	if (log->bandCount == log->bandCapacity) {
+		
+		log->bandCapacity *= 2;
+		log->bands = (NESPPUBandSnapshot *)realloc(log->bands,sizeof(NESPPUBandSnapshot) * log->bandCapacity);
+	}
+	
+	return log->bands + log->bandCount++;
+}
+
 static inline void backupPalettesForRendering(uint8_t *originalPalette, uint8_t *backupPalette) {
 
 	memcpy(backupPalette,originalPalette,sizeof(uint8_t)*32);
@@ -101,7 +397,7 @@ static inline void restoreBackupPalettes(uint8_t *originalPalette, uint8_t *back
 	memcpy(originalPalette,backupPalette,sizeof(uint8_t)*32);
 }
 
-static inline void generateTileCacheForCHRROMSegment(uint8_t ***tileCache, uint8_t *chrromSegment)
+static inline void generateTileCacheForCHRROMSegment(uint8_t *tileCache, uint8_t *chrromSegment)
 {
 	uint_fast16_t tile;
 	uint_fast8_t line;
@@ -117,32 +413,40 @@ static inline void generateTileCacheForCHRROMSegment(uint8_t ***tileCache, uint8
 				
 				indexingPixel = 7 - pixel;
 				pixelMask = 1 << indexingPixel;
-				tileCache[tile][line][pixel] = ((chrromSegment[(tile << 4) | line] & pixelMask) >> indexingPixel) | (((chrromSegment[(tile << 4) | (line + 8)] & pixelMask) >> indexingPixel) << 1);
+				tileCache[(tile * 64) + (line * 8) + pixel] = ((chrromSegment[(tile << 4) | line] & pixelMask) >> indexingPixel) | (((chrromSegment[(tile << 4) | (line + 8)] & pixelMask) >> indexingPixel) << 1);
 			}
 		}
 	}
 }
 
-static uint16_t applyHorizontalMirroring(uint16_t vramAddress) {
-
-	return (vramAddress & 0x03FF) | ((vramAddress & 0x0800) >> 1);
-}
-
-static uint16_t applyVerticalMirroring(uint16_t vramAddress) {
+static inline void invalidateBackgroundTiles(uint32_t *dirtyRows) {
 	
-	return vramAddress & 0x07FF;
+	dirtyRows[0] = dirtyRows[1] = dirtyRows[2] = dirtyRows[3] = 0xFFFFFFFF;
 }
 
-static uint16_t applySingleScreenLowerMirroring(uint16_t vramAddress) {
+// Points a descriptor at its decoded tile in the banks last resolved, and records the tile's bank in its row's mask
+static inline void resolveBackgroundTile(NESBackgroundTile *backgroundTiles, uint8_t **nameTablePages, uint8_t *tileCache, const uint_fast32_t *resolvedBanks, uint8_t (*rowBanks)[32], uint_fast16_t logicalIndex) {
 	
-	return vramAddress & 0x03FF;
+	uint8_t *nameTable = nameTablePages[logicalIndex >> 10];
+	uint_fast16_t nameTableOffset = logicalIndex & 0x3FF;
+	uint_fast8_t tileIndex = nameTable[nameTableOffset];
+	NESBackgroundTile *descriptor = backgroundTiles + logicalIndex;
+	
+	descriptor->tile = tileCache + (resolvedBanks[tileIndex / (CHRROM_BANK_SIZE / 16)] * TILE_CACHE_BANK_SIZE) + ((tileIndex & ((CHRROM_BANK_SIZE / 16) - 1)) * 64);
+	descriptor->upperColorBits = upperColorBitsFromAttributeByte(nameTable[attributeTableIndexForNametableIndex(nameTableOffset)], nameTableOffset);
+	rowBanks[logicalIndex >> 10][nameTableOffset >> 5] |= 1 << (tileIndex / (CHRROM_BANK_SIZE / 16));
 }
 
-static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
+// Forgets what the video buffer holds, marking every scanline as changed
+static inline void invalidateScanlineMemo(uint64_t *memoizedScanlines, uint64_t *changedScanlines) {
 	
-	return (vramAddress & 0x03FF) | 0x0400;
+	memoizedScanlines[0] = memoizedScanlines[1] = memoizedScanlines[2] = memoizedScanlines[3] = 0;
+	changedScanlines[0] = changedScanlines[1] = changedScanlines[2] = changedScanlines[3] = ~0ULL;
 }
 
+// Nametable memory pages (1KB each) mapped to the four logical nametables for each mirroring type
+static const uint_fast8_t nameTablePagesForMirroringType[5][4] = { { 0, 0, 1, 1 }, { 0, 1, 0, 1 }, { 0, 0, 0, 0 }, { 1, 1, 1, 1 }, { 0, 1, 2, 3 } };
+
 @implementation NESPPUEmulator
 
 - (void)printAttributeTableIndices
@@ -169,8 +473,20 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	NSLog(@"Invalid PPU Write Access");
 }
 
+- (void)_releaseTileCache
+{
+	// Band renderers draw from this PPU's tiles, so they have to go first
+	if (_deferredRendering) [self setDeferredRendering:NO];
+	if (_ownsTileCache) free(_tileCache);
+	_tileCache = NULL;
+	_ownsTileCache = NO;
+}
+
 - (void)resetPPUstatus
 {
+	// The renderer's state can't follow a reset, callers re-enable deferred rendering once the cartridge is configured
+	if (_deferredRendering) [self setDeferredRendering:NO];
+	
 	_sprite0HitCycle = 0;
 	_sprite0Hit = NO;
 	_triggeredNMI = NO;
@@ -189,17 +505,20 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	_firstWriteOccurred = NO;
 	_backgroundEnabled = 0;
 	_spritesEnabled = 0;
+	_monochrome = NO;
+	_colorIntensity = 0;
+	_colorTable = _colorTables;
 	_clipSprites = YES;
 	_clipBackground = YES;
 	_oddFrame = NO;
 	_NMIOnVBlank = NO;
-	_nameAndAttributeTablesMask = 0;	
 	_usingCHRRAM = NO;
 	_8x16Sprites = NO;
 	_frameEnded = NO;
 	
-	if (_stateObservingInvocation != nil) [_stateObservingInvocation release];
-	_stateObservingInvocation = nil;
+	// Mappers register their hooks again once their ROM pointers are set
+	memset(_hooks,0,sizeof(NESPPUHook)*NESPPUNumberOfHooks);
+	_a12RiseDot = 0;
 	
 	// FIXME: I'm not sure what the default for these should actually be
 	_spriteTileCacheIndex = 0;
@@ -208,13 +527,35 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	memset(_playfieldBuffer,0,sizeof(uint8_t)*16);
 	memset(_sprRAM,0,sizeof(uint8_t)*256);
 	memset(_palettes,0,sizeof(uint8_t)*32);
-	memset(_nameAndAttributeTables,0,sizeof(uint8_t)*2048);
+	memset(_nameAndAttributeTables,0,sizeof(uint8_t)*4096);
 	
-	if (_tileCache != NULL) {
+	[self _releaseTileCache];
 	
-		// FIXME: Invoke method to free tile cache
-		_tileCache = NULL;
-	}
+	// Force descriptors to be rebuilt against the current banks once rendering begins
+	invalidateBackgroundTiles(_dirtyBackgroundTileRows);
+	memset(_resolvedBackgroundBanks,0xFF,sizeof(uint_fast32_t)*4);
+	[self resetBackgroundTileStatistics];
+}
+
+- (void)dealloc
+{
+	if (_deferredRendering) [self setDeferredRendering:NO];
+	free(_playfieldBuffer);
+	free(_sprRAM);
+	free(_palettes);
+	free(_nameAndAttributeTables);
+	[self _releaseTileCache];
+	free(_chrramWriteHistory);
+	free(_backgroundTiles);
+	free(_scanlineKeys);
+	free(_colorTables);
+	free(_colorTables16);
+	free(_timingEvents);
+	free(_completedTimingEvents);
+	free(_registerReadMethods);
+	free(_registerWriteMethods);
+	
+	[super dealloc];
 }
 
 - (id)initWithBuffer:(uint_fast32_t *)buffer;
@@ -222,18 +563,32 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	[super init];
 	
 	_ppuDebugging = NO;
+	_rendersOutput = YES;
+	_deferredRendering = NO;
+	_renderWorkers = 1;
+	_bandRenderers = NULL;
+	_memoizesScanlines = YES;
+	_scanlineKeys = (NESScanlineMemoKey *)malloc(sizeof(NESScanlineMemoKey)*240);
+	invalidateScanlineMemo(_memoizedScanlines,_changedScanlines);
+	_validatesLogicOnlyRendering = NO;
+	_logicOnlyValidationMismatches = 0;
 	_videoBuffer = buffer;
 	_playfieldBuffer = (uint8_t *)malloc(sizeof(uint8_t)*16);
 	_sprRAM = (uint8_t *)malloc(sizeof(uint8_t)*256);
 	_palettes = (uint8_t *)malloc(sizeof(uint8_t)*32);
 	_backgroundPalette = _palettes;
 	_spritePalette = (_palettes + 0x10);
-	_nameAndAttributeTables = (uint8_t *)malloc(sizeof(uint8_t)*2048);
+	// 2KB of internal VRAM plus the 2KB a four-screen cartridge supplies
+	_nameAndAttributeTables = (uint8_t *)malloc(sizeof(uint8_t)*4096);
 	_tileCache = NULL;
-	_observerState = (PPUState *)malloc(sizeof(PPUState));
-	_stateObservingInvocation = nil;
+	_ownsTileCache = NO;
+	_backgroundTiles = (NESBackgroundTile *)malloc(sizeof(NESBackgroundTile)*4096);
+	_colorTables = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * 16 * 64);
+	_colorTables16 = (uint16_t *)malloc(sizeof(uint16_t) * 16 * 64);
+	buildColorTables(colorPalette, 64, _colorTables, _colorTables16);
 	
 	[self resetPPUstatus];
+	[self setMirroringType:NESHorizontalMirroring];
 	
 	_registerReadMethods = (RegisterReadMethod *)malloc(sizeof(uint8_t (*)(id, SEL, uint_fast32_t))*8);
 	_registerWriteMethods = (RegisterWriteMethod *)malloc(sizeof(void (*)(id, SEL, uint8_t, uint_fast32_t))*8);
@@ -273,182 +628,1311 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	// if (_ppuDebugging) NSLog(@"In changeMirroringType method. Switching to mirroring mode %d on PPU scanline %d cycle %d.",type,_cyclesSinceVINT / 341,_cyclesSinceVINT % 341);
 }
 
-// Checked 1/4
+- (uint8_t *)nameTableMemoryPage:(uint_fast8_t)page
+{
+	return _nameAndAttributeTables + (page * 1024);
+}
+
+/* setNameTable:toPage:isWritable:
+ * Maps one of the four logical nametables to a 1KB page, either internal VRAM (see nameTableMemoryPage:) or memory
+ * supplied by the cartridge such as CHR-ROM. Writes through read-only pages are ignored.
+ */
+- (void)setNameTable:(uint_fast8_t)nameTable toPage:(uint8_t *)page isWritable:(BOOL)writable
+{
+	BOOL internalPage = (page >= _nameAndAttributeTables) && (page < (_nameAndAttributeTables + 4096));
+	
+	// Internal pages are logged by index since the renderer has its own nametable memory, other pages must be in CHR-ROM
+	if (_deferredRendering) [self _logEvent:NESPPUNameTablePageEvent address:nameTable value:(writable ? 0x1 : 0) | (internalPage ? 0x2 : 0) argument:(internalPage ? (page - _nameAndAttributeTables) / 1024 : page - _chrrom) onCycle:_lastCPUCycle];
+	
+	_nameTablePageIsWritable[nameTable] = writable;
+	
+	if (_nameTablePages[nameTable] != page) {
+	
+		_nameTablePages[nameTable] = page;
+		_dirtyBackgroundTileRows[nameTable] = 0xFFFFFFFF;
+		_backgroundTileStatistics.fullInvalidations++;
+	}
+}
+
 - (void)setMirroringType:(NESMirroringType)type
 {
-	// NSLog(@"In setMirroringType method.");
+	uint_fast8_t nameTable;
+	
+	if (type > NESFourScreenMirroring) {
+		
+		NSLog(@"Warning: Setting unknown mirroring type!");
+		return;
+	}
+	
+	for (nameTable = 0; nameTable < 4; nameTable++) [self setNameTable:nameTable toPage:_nameAndAttributeTables + (nameTablePagesForMirroringType[type][nameTable] * 1024) isWritable:YES];
+}
+
+/* newTileCacheForCHRROM:length:
+ * Decodes every 1KB bank of the given CHRROM into a new tile cache, 64 bytes per tile. The caller frees it, so one
+ * decoding can be handed to any number of PPUs through cacheCHRROM:length:bankIndices:decodedTiles:.
+ */
++ (uint8_t *)newTileCacheForCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size
+{
+	uint8_t *tileCache = (uint8_t *)malloc(sizeof(uint8_t) * TILE_CACHE_BANK_SIZE * (size / CHRROM_BANK_SIZE));
+	uint_fast32_t bankIndex;
+	
+	for (bankIndex = 0; bankIndex < (size / CHRROM_BANK_SIZE); bankIndex++) {
+		
+		generateTileCacheForCHRROMSegment(tileCache + (bankIndex * TILE_CACHE_BANK_SIZE),chrrom + (bankIndex * CHRROM_BANK_SIZE));
+	}
+	
+	return tileCache;
+}
+
+- (void)_attachCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size bankIndices:(uint_fast32_t *)indices
+{
+	invalidateBackgroundTiles(_dirtyBackgroundTileRows);
+	memset(_resolvedBackgroundBanks,0xFF,sizeof(uint_fast32_t)*4);
+	
+	_chrrom = chrrom;
+	_chrromSize = size;
+	_chrromBankIndices = indices;
+	invalidateScanlineMemo(_memoizedScanlines,_changedScanlines);
+	_backgroundTileStatistics.fullRebuilds++;
+}
+
+- (void)cacheCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size bankIndices:(uint_fast32_t *)indices isWritable:(BOOL)isWritable
+{
+	uint_fast32_t bankIndex;
+	
+	// Decoded tiles for all banks are kept in one allocation, 64 bytes per tile
+	[self _releaseTileCache];
+	_tileCache = [NESPPUEmulator newTileCacheForCHRROM:chrrom length:size];
+	_ownsTileCache = YES;
+	
+	[self _attachCHRROM:chrrom length:size bankIndices:indices];
+	
+	_usingCHRRAM = isWritable;
+	if (isWritable) {
+		
+		free(_chrramWriteHistory);
+		_chrramWriteHistory = (BOOL *)malloc(sizeof(BOOL) * (size / CHRROM_BANK_SIZE));
+		
+		for (bankIndex = 0; bankIndex < (size / CHRROM_BANK_SIZE); bankIndex++) {
+				
+			_chrramWriteHistory[bankIndex] = NO;
+		}
+	}
+}
+
+/* cacheCHRROM:length:bankIndices:decodedTiles:
+ * Renders read-only CHRROM from tiles decoded elsewhere, which must outlive this PPU's use of them.
+ */
+- (void)cacheCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size bankIndices:(uint_fast32_t *)indices decodedTiles:(uint8_t *)tiles
+{
+	[self _releaseTileCache];
+	_tileCache = tiles;
+	_ownsTileCache = NO;
+	
+	[self _attachCHRROM:chrrom length:size bankIndices:indices];
+	_usingCHRRAM = NO;
+}
+
+- (void)_resolveBackgroundTileRow:(uint_fast16_t)row ofNameTable:(uint_fast8_t)nameTable
+{
+	uint_fast16_t logicalIndex = (nameTable << 10) | (row << 5);
+	uint_fast16_t lastIndex = logicalIndex + 32;
+	
+	_backgroundTileRowBanks[nameTable][row] = 0;
+	for (; logicalIndex < lastIndex; logicalIndex++) resolveBackgroundTile(_backgroundTiles, _nameTablePages, _tileCache, _resolvedBackgroundBanks, _backgroundTileRowBanks, logicalIndex);
+	
+	_dirtyBackgroundTileRows[nameTable] &= ~((uint32_t)1 << row);
+	_backgroundTileStatistics.rowsResolved++;
+}
+
+/* _prepareBackgroundTilesForVRAMAddress:
+ * Makes sure the descriptors for the tile row at the given address are current in both horizontally adjacent nametables,
+ * which covers every tile fetched for one scanline. A change in the banks behind the selected pattern table (CHR switch
+ * or $2000 write) drops only the rows holding tiles from the changed 1KB banks, each row keeping a mask of the banks
+ * its tiles come from; only the rows actually rendered afterwards are rebuilt.
+ */
+- (void)_prepareBackgroundTilesForVRAMAddress:(uint16_t)vramAddress
+{
+	uint_fast8_t nameTable = (vramAddress >> 10) & 0x3;
+	uint_fast16_t row = (vramAddress >> 5) & 0x1F;
+	uint_fast32_t *backgroundBanks = _chrromBankIndices + _backgroundTileCacheIndex;
+	uint_fast8_t changedBanks = (backgroundBanks[0] != _resolvedBackgroundBanks[0]) | ((backgroundBanks[1] != _resolvedBackgroundBanks[1]) << 1) | ((backgroundBanks[2] != _resolvedBackgroundBanks[2]) << 2) | ((backgroundBanks[3] != _resolvedBackgroundBanks[3]) << 3);
+	uint_fast8_t staleNameTable;
+	uint_fast16_t staleRow;
+	
+	if (changedBanks == 0xF) {
+	
+		invalidateBackgroundTiles(_dirtyBackgroundTileRows);
+		memcpy(_resolvedBackgroundBanks,backgroundBanks,sizeof(uint_fast32_t)*4);
+		_backgroundTileStatistics.fullInvalidations++;
+	}
+	else if (changedBanks) {
+		
+		for (staleNameTable = 0; staleNameTable < 4; staleNameTable++) {
+			
+			for (staleRow = 0; staleRow < 32; staleRow++) {
+				
+				if ((_backgroundTileRowBanks[staleNameTable][staleRow] & changedBanks) && !(_dirtyBackgroundTileRows[staleNameTable] & ((uint32_t)1 << staleRow))) {
+					
+					_dirtyBackgroundTileRows[staleNameTable] |= (uint32_t)1 << staleRow;
+					_backgroundTileStatistics.bankSwitchInvalidations++;
+				}
+			}
+		}
+		
+		memcpy(_resolvedBackgroundBanks,backgroundBanks,sizeof(uint_fast32_t)*4);
+	}
+	
+	if (_dirtyBackgroundTileRows[nameTable] & ((uint32_t)1 << row)) [self _resolveBackgroundTileRow:row ofNameTable:nameTable];
+	if (_dirtyBackgroundTileRows[nameTable ^ 0x1] & ((uint32_t)1 << row)) [self _resolveBackgroundTileRow:row ofNameTable:nameTable ^ 0x1];
+}
+
+/* _updateBackgroundTilesForNameTableAddress:
+ * Refreshes the descriptors affected by a write to the given nametable address in every logical nametable that
+ * maps the same page. Attribute writes also recolor the 4x4 block of tiles they cover. Dirty rows are left for later.
+ */
+- (void)_updateBackgroundTilesForNameTableAddress:(uint16_t)address
+{
+	uint_fast8_t nameTable;
+	uint8_t *page = _nameTablePages[(address >> 10) & 0x3];
+	uint_fast16_t offset = address & 0x3FF;
+	uint_fast16_t row, column, firstRow, firstColumn;
 	
-	switch (type) {
+	for (nameTable = 0; nameTable < 4; nameTable++) {
+	
+		if (_nameTablePages[nameTable] != page) continue;
+		
+		if (!(_dirtyBackgroundTileRows[nameTable] & ((uint32_t)1 << (offset >> 5)))) {
+		
+			resolveBackgroundTile(_backgroundTiles, _nameTablePages, _tileCache, _resolvedBackgroundBanks, _backgroundTileRowBanks, (nameTable << 10) | offset);
+			_backgroundTileStatistics.tilesUpdated++;
+		}
+		
+		if (offset >= 0x3C0) {
+		
+			firstRow = ((offset - 0x3C0) >> 3) * 4;
+			firstColumn = ((offset - 0x3C0) & 0x7) * 4;
 			
-		case NESHorizontalMirroring:
-			_nameTableMirroring = (uint16_t (*)(uint16_t))applyHorizontalMirroring;
-			// NSLog(@"Setting Horizontal Mirroring Mode.");
-			break;
-		case NESVerticalMirroring:
-			_nameTableMirroring = (uint16_t (*)(uint16_t))applyVerticalMirroring;
-			// NSLog(@"Setting Vertical Mirroring Mode.");
-			break;
-		case NESSingleScreenLowerMirroring:
-			_nameTableMirroring = (uint16_t (*)(uint16_t))applySingleScreenLowerMirroring;
-			// NSLog(@"Setting Single Screen Lower Mirroring Mode.");
-			break;
-		case NESSingleScreenUpperMirroring:
-			_nameTableMirroring = (uint16_t (*)(uint16_t))applySingleScreenUpperMirroring;
-			// NSLog(@"Setting Single Screen Upper Mirroring Mode.");
-			break;
-		default:
-			NSLog(@"Warning: Setting unknown mirroring type!");
-			break;
+			for (row = firstRow; row < firstRow + 4; row++) {
+			
+				if (_dirtyBackgroundTileRows[nameTable] & ((uint32_t)1 << row)) continue;
+				
+				for (column = firstColumn; column < firstColumn + 4; column++) resolveBackgroundTile(_backgroundTiles, _nameTablePages, _tileCache, _resolvedBackgroundBanks, _backgroundTileRowBanks, (nameTable << 10) | (row << 5) | column);
+				_backgroundTileStatistics.tilesUpdated += 4;
+			}
+		}
+	}
+}
+
+- (NESBackgroundTileStatistics)backgroundTileStatistics
+{
+	return _backgroundTileStatistics;
+}
+
+- (void)resetBackgroundTileStatistics
+{
+	memset(&_backgroundTileStatistics,0,sizeof(NESBackgroundTileStatistics));
+}
+
+- (void)_preloadTilesForScanline
+{
+	NESBackgroundTile *backgroundTile;
+	uint8_t *tileRow;
+	uint8_t pixelCounter;
+	uint8_t tileLowerColorBits;
+	
+	[self _prepareBackgroundTilesForVRAMAddress:_VRAMAddress];
+	
+	// Fetch first tile in the scanline
+	backgroundTile = _backgroundTiles + (_VRAMAddress & 0x0FFF);
+	tileRow = backgroundTile->tile + (((_VRAMAddress & 0x7000) / 4096) * 8);
+	
+	for (pixelCounter = 0; pixelCounter < 8; pixelCounter++) {
+		
+		tileLowerColorBits = tileRow[pixelCounter];
+		_playfieldBuffer[pixelCounter] = tileLowerColorBits ? (tileLowerColorBits | backgroundTile->upperColorBits) : 0;
+	}
+	
+	// Increment the VRAM address one tile to the right
+	incrementVRAMAddressHorizontally(&_VRAMAddress); 
+	
+	// Fetch the second tile in the scanline
+	backgroundTile = _backgroundTiles + (_VRAMAddress & 0x0FFF);
+	tileRow = backgroundTile->tile + (((_VRAMAddress & 0x7000) / 4096) * 8);
+	
+	for (pixelCounter = 0; pixelCounter < 8; pixelCounter++) {
+		
+		tileLowerColorBits = tileRow[pixelCounter];
+		_playfieldBuffer[pixelCounter + 8] = tileLowerColorBits ? (tileLowerColorBits | backgroundTile->upperColorBits) : 0;
+	}
+	
+	// Increment the VRAM address one tile to the right
+	incrementVRAMAddressHorizontally(&_VRAMAddress); 	
+}
+
+- (void)_findInRangeSprites:(uint_fast8_t)scanline
+{
+	uint_fast32_t sprRAMIndex;
+	
+	_numberOfSpritesOnScanline = 0;
+	
+	for (sprRAMIndex = 0; sprRAMIndex < 256; sprRAMIndex += 4) {
+	
+		// FIXME: If it turns out that sprites on scanline 0 have Y coords of 0xFF then I'll need to add back (uint8_t) to make sure the addition overflows.
+		if ((scanline >= (_sprRAM[sprRAMIndex] + 1)) && ((scanline - (_sprRAM[sprRAMIndex] + 1)) < (_8x16Sprites ? 16 : 8))) {
+		
+			if (_numberOfSpritesOnScanline == 8) {
+				
+				// Set flag on 9th in range object found
+				_ppuStatusRegister |= 0x20;
+				break;
+			}
+			_spritesOnCurrentScanline[_numberOfSpritesOnScanline++] = sprRAMIndex;
+		}
+	}
+}
+
+// Builds the background opacity mask for the coming scanline without drawing or moving the VRAM address
+- (void)_backgroundOpacityForScanline:(uint64_t *)bgOpacityMask
+{
+	uint16_t vramAddress = _VRAMAddress;
+	uint_fast8_t verticalTileOffset = (vramAddress & 0x7000) / 4096;
+	uint_fast32_t scanlinePixel = 0;
+	uint_fast32_t pixelCounter;
+	uint_fast32_t tileCounter;
+	uint8_t *tileRow;
+	
+	[self _prepareBackgroundTilesForVRAMAddress:vramAddress];
+	
+	for (pixelCounter = _fineHorizontalScroll; pixelCounter < 16; pixelCounter++, scanlinePixel++) {
+		
+		if ((_playfieldBuffer[pixelCounter] & 0x3) && !(_clipBackground && (scanlinePixel < 8))) setLineMaskBit(bgOpacityMask,scanlinePixel);
+	}
+	
+	for (tileCounter = 0; tileCounter < 31; tileCounter++) {
+		
+		tileRow = _backgroundTiles[vramAddress & 0x0FFF].tile + (verticalTileOffset * 8);
+		
+		for (pixelCounter = 0; (pixelCounter < 8) && (scanlinePixel < 256); pixelCounter++, scanlinePixel++) {
+			
+			if (tileRow[pixelCounter]) setLineMaskBit(bgOpacityMask,scanlinePixel);
+		}
+		
+		incrementVRAMAddressHorizontally(&vramAddress);
+	}
+}
+
+/* _simulateScanline:
+ * Logic-only replacement for drawing a scanline: produces no pixels, only the effects the CPU can observe.
+ * The background is only decoded when sprite 0 is on the line and could still hit.
+ */
+- (void)_simulateScanline:(uint_fast8_t)scanline
+{
+	uint64_t bgOpacityMask[4] = { 0, 0, 0, 0 };
+	uint64_t spriteRowMask[2];
+	uint_fast32_t spriteLowerPlane, spriteUpperPlane;
+	uint_fast32_t maskWord, hitPixel, tileCounter;
+	
+	if (!(_backgroundEnabled || _spritesEnabled)) return;
+	
+	if (_backgroundEnabled && _spritesEnabled && !_sprite0Hit && _numberOfSpritesOnScanline && (_spritesOnCurrentScanline[0] == 0)) {
+		
+		fetchSpriteRow(_sprRAM, scanline, _8x16Sprites, _spriteTileCacheIndex, _chrromBankIndices, _chrrom, &spriteLowerPlane, &spriteUpperPlane);
+		
+		if (spriteLowerPlane | spriteUpperPlane) {
+			
+			[self _backgroundOpacityForScanline:bgOpacityMask];
+			maskWord = positionSpriteRow(spriteLowerPlane | spriteUpperPlane, _sprRAM[3], _clipSprites, spriteRowMask);
+			
+			if (findSprite0Hit(spriteRowMask, maskWord, bgOpacityMask, &hitPixel)) {
+				
+				_sprite0Hit = YES;
+				_sprite0HitCycle = hitPixel;
+			}
+		}
+	}
+	
+	// Simulate the remaining 31 tile fetches
+	for (tileCounter = 0; tileCounter < 31; tileCounter++) incrementVRAMAddressHorizontally(&_VRAMAddress);
+}
+
+// Runs the logic-only path for a scanline that is about to be rendered, then restores the state it changed
+- (void)_predictLogicOnlyScanline:(uint_fast8_t)scanline
+{
+	uint16_t vramAddress = _VRAMAddress;
+	BOOL sprite0Hit = _sprite0Hit;
+	uint_fast32_t sprite0HitCycle = _sprite0HitCycle;
+	
+	[self _simulateScanline:scanline];
+	_logicOnlyScanlineHash = hashScanlineSideEffects(_VRAMAddress, _sprite0Hit, _sprite0HitCycle);
+	
+	_VRAMAddress = vramAddress;
+	_sprite0Hit = sprite0Hit;
+	_sprite0HitCycle = sprite0HitCycle;
+}
+
+- (void)_checkLogicOnlyPredictionForScanline:(uint_fast8_t)scanline
+{
+	if (_logicOnlyScanlineHash != hashScanlineSideEffects(_VRAMAddress, _sprite0Hit, _sprite0HitCycle)) {
+		
+		_logicOnlyValidationMismatches++;
+		NSLog(@"Logic-only rendering diverged on scanline %d: VRAM address 0x%4.4x, sprite 0 hit %@ on pixel %lu.",scanline,_VRAMAddress,(_sprite0Hit ? @"YES" : @"NO"),(unsigned long)_sprite0HitCycle);
+	}
+}
+
+/* _matchScanlineInputs:
+ * Gathers everything the scanline renderer reads for this line: scroll, control registers, palettes, the preloaded
+ * tiles, the descriptors of the tiles the line will cross and the rows of in-range sprites. A line whose inputs match
+ * the pixels already in the video buffer doesn't need drawing. Otherwise the new inputs are remembered for next frame.
+ * The whole tuple is compared rather than a hash of it, so a collision can't leave a stale line on screen.
+ */
+- (BOOL)_matchScanlineInputs:(uint_fast8_t)scanline
+{
+	NESScanlineMemoKey key;
+	uint16_t vramAddress = _VRAMAddress;
+	uint_fast32_t tileCounter, spriteCounter;
+	uint_fast32_t spriteLowerPlane, spriteUpperPlane;
+	const uint8_t *sprite;
+	NESBackgroundTile *backgroundTile;
+	
+	// Unused tile and sprite slots must compare equal too
+	memset(&key, 0, sizeof(NESScanlineMemoKey));
+	key.registers[0] = _VRAMAddress & 0xFF;
+	key.registers[1] = _VRAMAddress >> 8;
+	key.registers[2] = _fineHorizontalScroll;
+	key.registers[3] = _ppuControlRegister1;
+	key.registers[4] = _ppuControlRegister2;
+	key.registers[5] = _numberOfSpritesOnScanline;
+	memcpy(key.palettes, _palettes, 32);
+	
+	if (_backgroundEnabled) {
+		
+		[self _prepareBackgroundTilesForVRAMAddress:_VRAMAddress];
+		memcpy(key.preloadedTiles, _playfieldBuffer, 16);
+		key.chrramGeneration = (uint32_t)_chrramGeneration;
+		
+		for (tileCounter = 0; tileCounter < 31; tileCounter++) {
+			
+			backgroundTile = _backgroundTiles + (vramAddress & 0x0FFF);
+			key.tiles[tileCounter] = (uint32_t)(backgroundTile->tile - _tileCache) | backgroundTile->upperColorBits;
+			incrementVRAMAddressHorizontally(&vramAddress);
+		}
+	}
+	
+	if (_spritesEnabled) {
+		
+		for (spriteCounter = 0; spriteCounter < _numberOfSpritesOnScanline; spriteCounter++) {
+			
+			sprite = _sprRAM + _spritesOnCurrentScanline[spriteCounter];
+			fetchSpriteRow(sprite, scanline, _8x16Sprites, _spriteTileCacheIndex, _chrromBankIndices, _chrrom, &spriteLowerPlane, &spriteUpperPlane);
+			key.sprites[spriteCounter] = (uint32_t)spriteLowerPlane | ((uint32_t)spriteUpperPlane << 8) | ((uint32_t)sprite[2] << 16) | ((uint32_t)sprite[3] << 24);
+		}
+	}
+	
+	if ((_memoizedScanlines[scanline / 64] & (1ULL << (scanline % 64))) && !memcmp(&key, _scanlineKeys + scanline, sizeof(NESScanlineMemoKey))) {
+		
+		_scanlineMemoStatistics.hits++;
+		return YES;
+	}
+	
+	_scanlineKeys[scanline] = key;
+	_memoizedScanlines[scanline / 64] |= 1ULL << (scanline % 64);
+	_changedScanlines[scanline / 64] |= 1ULL << (scanline % 64);
+	_scanlineMemoStatistics.misses++;
+	
+	return NO;
+}
+
+- (void)setMemoizesScanlines:(BOOL)flag
+{
+	_memoizesScanlines = flag;
+	invalidateScanlineMemo(_memoizedScanlines,_changedScanlines);
+}
+
+- (BOOL)memoizesScanlines
+{
+	return _memoizesScanlines;
+}
+
+- (NESScanlineMemoStatistics)scanlineMemoStatistics
+{
+	return _scanlineMemoStatistics;
+}
+
+- (void)resetScanlineMemoStatistics
+{
+	_scanlineMemoStatistics.hits = 0;
+	_scanlineMemoStatistics.misses = 0;
+}
+
+/* takeChangedScanlines:
+ * Copies out a 256-bit mask of the scanlines that have been redrawn since the last call and clears it, so the
+ * presentation layer only needs to update those rows.
+ */
+- (void)takeChangedScanlines:(uint64_t *)changedScanlines
+{
+	uint_fast32_t maskWord;
+	
+	for (maskWord = 0; maskWord < 4; maskWord++) {
+		
+		changedScanlines[maskWord] = _changedScanlines[maskWord];
+		_changedScanlines[maskWord] = 0;
+	}
+}
+
+- (void)setRendersOutput:(BOOL)flag
+{
+	_rendersOutput = flag;
+	if (_deferredRendering) _recordingLog->rendersOutput = flag;
+}
+
+- (BOOL)rendersOutput
+{
+	return _rendersOutput;
+}
+
+- (void)setValidatesLogicOnlyRendering:(BOOL)flag
+{
+	_validatesLogicOnlyRendering = flag;
+	_logicOnlyValidationMismatches = 0;
+}
+
+- (uint_fast32_t)logicOnlyValidationMismatches
+{
+	return _logicOnlyValidationMismatches;
+}
+
+- (void)_logEvent:(NESPPUEventType)type address:(uint16_t)address value:(uint8_t)value argument:(uint_fast32_t)argument onCycle:(uint_fast32_t)cycle
+{
+	NESPPUEvent *event = appendEventToLog(_recordingLog);
+	
+	event->cycle = cycle;
+	event->ppuCPUCycle = _lastCPUCycle;
+	event->argument = argument;
+	event->address = address;
+	event->type = type;
+	event->value = value;
+	
+	// Band renderers load a snapshot and replay nothing, so anything that changes what they draw starts a new band: every
+	// register write, $2007 reads (they move the VRAM address), OAM DMA and mapper remaps. Status polling doesn't.
+	if ((type != NESPPUFrameEndEvent) && ((type != NESPPURegisterReadEvent) || ((address & 0x7) == 0x7))) _bandStateChanged = YES;
+
+
+/* switchedCHRROMSlot:count:
+ * Mappers report each window of 1KB CHR slots they remap, right after catching the PPU up, so a deferred frame's log
+ * records only the slots that changed, stamped with the cycle the PPU had reached.
+ */
+- (void)switchedCHRROMSlot:(uint_fast32_t)slot count:(uint_fast32_t)count
+{
+	uint_fast32_t lastSlot = slot + count;
+	
+	if (!_deferredRendering) return;
+	
+	for (; slot < lastSlot; slot++) [self _logEvent:NESPPUCHRBankEvent address:slot value:0 argument:_chrromBankIndices[slot] onCycle:_lastCPUCycle];
+}
+
+// Copies everything that affects rendering into another PPU, mapping internal nametable pages onto its own memory
+- (void)_copyStateToPPU:(NESPPUEmulator *)ppu
+{
+	uint_fast8_t nameTable;
+	
+	memcpy(ppu->_sprRAM,_sprRAM,sizeof(uint8_t)*256);
+	memcpy(ppu->_palettes,_palettes,sizeof(uint8_t)*32);
+	memcpy(ppu->_nameAndAttributeTables,_nameAndAttributeTables,sizeof(uint8_t)*4096);
+	memcpy(ppu->_playfieldBuffer,_playfieldBuffer,sizeof(uint8_t)*16);
+	memcpy(ppu->_spritesOnCurrentScanline,_spritesOnCurrentScanline,sizeof(uint_fast8_t)*8);
+	
+	for (nameTable = 0; nameTable < 4; nameTable++) {
+		
+		if ((_nameTablePages[nameTable] >= _nameAndAttributeTables) && (_nameTablePages[nameTable] < (_nameAndAttributeTables + 4096))) [ppu setNameTable:nameTable toPage:ppu->_nameAndAttributeTables + (_nameTablePages[nameTable] - _nameAndAttributeTables) isWritable:_nameTablePageIsWritable[nameTable]];
+		else [ppu setNameTable:nameTable toPage:_nameTablePages[nameTable] isWritable:_nameTablePageIsWritable[nameTable]];
+	}
+	
+	ppu->_ppuControlRegister1 = _ppuControlRegister1;
+	ppu->_ppuControlRegister2 = _ppuControlRegister2;
+	ppu->_ppuStatusRegister = _ppuStatusRegister;
+	ppu->_bufferedVRAMRead = _bufferedVRAMRead;
+	ppu->_numberOfSpritesOnScanline = _numberOfSpritesOnScanline;
+	ppu->_sprRAMAddress = _sprRAMAddress;
+	ppu->_spriteTileCacheIndex = _spriteTileCacheIndex;
+	ppu->_backgroundTileCacheIndex = _backgroundTileCacheIndex;
+	ppu->_sprite0HitCycle = _sprite0HitCycle;
+	ppu->_lastCPUCycle = _lastCPUCycle;
+	ppu->_cyclesSinceVINT = _cyclesSinceVINT;
+	ppu->_lastCycleOverage = _lastCycleOverage;
+	ppu->_VRAMAddress = _VRAMAddress;
+	ppu->_temporaryVRAMAddress = _temporaryVRAMAddress;
+	ppu->_fineHorizontalScroll = _fineHorizontalScroll;
+	ppu->_addressIncrement = _addressIncrement;
+	ppu->_colorIntensity = _colorIntensity;
+	memcpy(ppu->_colorTables,_colorTables,sizeof(uint_fast32_t) * 16 * 64);
+	memcpy(ppu->_colorTables16,_colorTables16,sizeof(uint16_t) * 16 * 64);
+	ppu->_sprite0Hit = _sprite0Hit;
+	ppu->_triggeredNMI = _triggeredNMI;
+	ppu->_NMIOnVBlank = _NMIOnVBlank;
+	ppu->_8x16Sprites = _8x16Sprites;
+	ppu->_monochrome = _monochrome;
+	ppu->_colorTable = ppu->_colorTables + (_colorTable - _colorTables);
+	ppu->_clipBackground = _clipBackground;
+	ppu->_clipSprites = _clipSprites;
+	ppu->_backgroundEnabled = _backgroundEnabled;
+	ppu->_spritesEnabled = _spritesEnabled;
+	ppu->_firstWriteOccurred = _firstWriteOccurred;
+	ppu->_oddFrame = _oddFrame;
+	ppu->_frameEnded = _frameEnded;
+	ppu->_shortenPrimingScanline = _shortenPrimingScanline;
+	
+	invalidateBackgroundTiles(ppu->_dirtyBackgroundTileRows);
+}
+
+/* setDeferredRendering:
+ * In deferred mode this PPU runs logic-only, so everything the CPU observes ($2002, sprite 0 hit, VRAM address)
+ * stays exact, and records each PPU-affecting event into a per-frame log. At the end of each frame the log is
+ * replayed on a second PPU instance on a background queue, which draws pixels while the CPU emulates the next
+ * frame. Finished frames are published to the video buffer one frame late. CHR-RAM carts stay synchronous, as the
+ * renderer would have to share pattern memory the CPU is still writing. Returns NO if the mode was refused.
+ */
+- (BOOL)setDeferredRendering:(BOOL)flag
+{
+	uint_fast32_t worker;
+	
+	if (flag == _deferredRendering) return YES;
+	
+	if (flag) {
+		
+		if (_usingCHRRAM || (_tileCache == NULL)) {
+			
+			NSLog(@"Deferred rendering requires CHR-ROM, rendering synchronously.");
+			return NO;
+		}
+		
+		_deferredVideoBuffer = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * 256 * 240);
+		memcpy(_deferredVideoBuffer,_videoBuffer,sizeof(uint_fast32_t) * 256 * 240);
+		memcpy(_deferredCHRROMBankIndices,_chrromBankIndices,sizeof(uint_fast32_t) * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
+		
+		if (_renderWorkers > 1) {
+			
+			// Band renderers start from snapshots, so they don't need this PPU's current state
+			_bandRenderers = (NESPPUEmulator **)malloc(sizeof(NESPPUEmulator *) * _renderWorkers);
+			_bandCHRROMBankIndices = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE) * _renderWorkers);
+			
+			for (worker = 0; worker < _renderWorkers; worker++) {
+			
+				memcpy(_bandCHRROMBankIndices + (worker * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE)),_chrromBankIndices,sizeof(uint_fast32_t) * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
+				_bandRenderers[worker] = [[NESPPUEmulator alloc] initWithBuffer:_deferredVideoBuffer];
+				[_bandRenderers[worker] cacheCHRROM:_chrrom length:_chrromSize bankIndices:_bandCHRROMBankIndices + (worker * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE)) decodedTiles:_tileCache];
+				[_bandRenderers[worker] setMemoizesScanlines:NO]; // Workers share the video buffer, so none knows what a line holds
+				memcpy(_bandRenderers[worker]->_colorTables,_colorTables,sizeof(uint_fast32_t) * 16 * 64);
+			}
+		}
+		else {
+		
+			_deferredRenderer = [[NESPPUEmulator alloc] initWithBuffer:_deferredVideoBuffer];
+			[_deferredRenderer cacheCHRROM:_chrrom length:_chrromSize bankIndices:_deferredCHRROMBankIndices decodedTiles:_tileCache];
+			[self _copyStateToPPU:_deferredRenderer];
+		}
+		
+		_deferredLogs = (NESPPUEventLog *)malloc(sizeof(NESPPUEventLog) * 2);
+		initializeEventLog(_deferredLogs);
+		initializeEventLog(_deferredLogs + 1);
+		_recordingLog = _deferredLogs;
+		_recordingLog->rendersOutput = _rendersOutput;
+		_replayingLog = NULL;
+		_bandStateChanged = YES;
+		invalidateScanlineMemo(_memoizedScanlines,_changedScanlines);
+		
+		_deferredRenderQueue = dispatch_queue_create("com.macifom.ppu.deferredrendering",NULL);
+		_deferredRenderGroup = dispatch_group_create();
+		_deferredRendering = YES;
+	}
+	else {
+		
+		_deferredRendering = NO;
+		dispatch_group_wait(_deferredRenderGroup,DISPATCH_TIME_FOREVER);
+		dispatch_release(_deferredRenderGroup);
+		dispatch_release(_deferredRenderQueue);
+		
+		freeEventLog(_deferredLogs);
+		freeEventLog(_deferredLogs + 1);
+		free(_deferredLogs);
+		_deferredLogs = _recordingLog = _replayingLog = NULL;
+		
+		if (_bandRenderers != NULL) {
+			
+			for (worker = 0; worker < _renderWorkers; worker++) [_bandRenderers[worker] release];
+			free(_bandRenderers);
+			free(_bandCHRROMBankIndices);
+			_bandRenderers = NULL;
+			_bandCHRROMBankIndices = NULL;
+		}
+		
+		[_deferredRenderer release];
+		_deferredRenderer = nil;
+		free(_deferredVideoBuffer);
+		_deferredVideoBuffer = NULL;
+		invalidateScanlineMemo(_memoizedScanlines,_changedScanlines);
+	}
+	
+	return YES;
+}
+
+- (BOOL)deferredRendering
+{
+	return _deferredRendering;
+}
+
+/* setRenderWorkers:
+ * With more than one worker, deferred frames are split into horizontal bands that render concurrently. The CPU-side
+ * PPU snapshots its state at the first scanline following any logged event, so band boundaries follow mid-frame
+ * register changes, and at fixed intervals so the work divides evenly between the workers. Each worker owns a PPU
+ * instance that loads a band's snapshot and runs the normal scanline renderer to the start of the next band.
+ */
+- (void)setRenderWorkers:(uint_fast32_t)workers
+{
+	BOOL deferredRendering = _deferredRendering;
+	
+	if (workers < 1) workers = 1;
+	if (workers == _renderWorkers) return;
+	
+	// Renderers are built for the worker count, so rebuild them if deferred rendering is running
+	if (deferredRendering) [self setDeferredRendering:NO];
+	_renderWorkers = workers;
+	if (deferredRendering) [self setDeferredRendering:YES];
+}
+
+- (uint_fast32_t)renderWorkers
+{
+	return _renderWorkers;
+}
+
+- (NESPPUBandStatistics)bandStatistics
+{
+	return _bandStatistics;
+}
+
+- (void)resetBandStatistics
+{
+	_bandStatistics.frames = 0;
+	_bandStatistics.bands = 0;
+	_bandStatistics.renderNanoseconds = 0;
+}
+
+- (void)_captureBandSnapshotForScanline:(uint_fast8_t)scanline
+{
+	NESPPUBandSnapshot *band;
+	uint_fast8_t nameTable;
+	BOOL internalPage;
+	
+	if (!_recordingLog->rendersOutput) return;
+	if (!_bandStateChanged && (scanline != 0) && (scanline % ((240 + _renderWorkers - 1) / _renderWorkers))) return;
+	
+	_bandStateChanged = NO;
+	band = appendBandToLog(_recordingLog);
+	
+	memcpy(band->nameAndAttributeTables,_nameAndAttributeTables,sizeof(uint8_t)*4096);
+	memcpy(band->sprRAM,_sprRAM,sizeof(uint8_t)*256);
+	memcpy(band->palettes,_palettes,sizeof(uint8_t)*32);
+	memcpy(band->playfieldBuffer,_playfieldBuffer,sizeof(uint8_t)*16);
+	memcpy(band->spritesOnCurrentScanline,_spritesOnCurrentScanline,sizeof(uint_fast8_t)*8);
+	memcpy(band->chrromBankIndices,_chrromBankIndices,sizeof(uint_fast32_t)*(CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
+	
+	for (nameTable = 0; nameTable < 4; nameTable++) {
+		
+		internalPage = (_nameTablePages[nameTable] >= _nameAndAttributeTables) && (_nameTablePages[nameTable] < (_nameAndAttributeTables + 4096));
+		band->nameTablePages[nameTable] = internalPage ? (_nameTablePages[nameTable] - _nameAndAttributeTables) / 1024 : _nameTablePages[nameTable] - _chrrom;
+		band->nameTablePageFlags[nameTable] = (_nameTablePageIsWritable[nameTable] ? 0x1 : 0) | (internalPage ? 0x2 : 0);
+	}
+	
+	band->spriteTileCacheIndex = _spriteTileCacheIndex;
+	band->backgroundTileCacheIndex = _backgroundTileCacheIndex;
+	band->VRAMAddress = _VRAMAddress;
+	band->temporaryVRAMAddress = _temporaryVRAMAddress;
+	band->scanline = scanline;
+	band->controlRegister1 = _ppuControlRegister1;
+	band->controlRegister2 = _ppuControlRegister2;
+	band->fineHorizontalScroll = _fineHorizontalScroll;
+	band->colorIntensity = _colorIntensity;
+	band->numberOfSpritesOnScanline = _numberOfSpritesOnScanline;
+	band->tallSprites = _8x16Sprites;
+	band->monochrome = _monochrome;
+	band->clipBackground = _clipBackground;
+	band->clipSprites = _clipSprites;
+	band->backgroundEnabled = _backgroundEnabled;
+	band->spritesEnabled = _spritesEnabled;
+	band->shortenPrimingScanline = _shortenPrimingScanline;
+}
+
+// Loads a band snapshot and renders from its first scanline up to (not including) the given scanline
+- (void)_renderBand:(NESPPUBandSnapshot *)band untilScanline:(uint_fast32_t)endingScanline withCHRROM:(uint8_t *)chrrom
+{
+	uint_fast8_t nameTable;
+	uint_fast32_t firstCycle = band->shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL;
+	
+	memcpy(_nameAndAttributeTables,band->nameAndAttributeTables,sizeof(uint8_t)*4096);
+	memcpy(_sprRAM,band->sprRAM,sizeof(uint8_t)*256);
+	memcpy(_palettes,band->palettes,sizeof(uint8_t)*32);
+	memcpy(_playfieldBuffer,band->playfieldBuffer,sizeof(uint8_t)*16);
+	memcpy(_spritesOnCurrentScanline,band->spritesOnCurrentScanline,sizeof(uint_fast8_t)*8);
+	memcpy(_chrromBankIndices,band->chrromBankIndices,sizeof(uint_fast32_t)*(CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
+	
+	for (nameTable = 0; nameTable < 4; nameTable++) {
+		
+		[self setNameTable:nameTable toPage:((band->nameTablePageFlags[nameTable] & 0x2) ? [self nameTableMemoryPage:band->nameTablePages[nameTable]] : chrrom + band->nameTablePages[nameTable]) isWritable:band->nameTablePageFlags[nameTable] & 0x1];
+	}
+	
+	// Nametable contents were replaced wholesale
+	invalidateBackgroundTiles(_dirtyBackgroundTileRows);
+	_backgroundTileStatistics.fullInvalidations++;
+	
+	_spriteTileCacheIndex = band->spriteTileCacheIndex;
+	_backgroundTileCacheIndex = band->backgroundTileCacheIndex;
+	_VRAMAddress = band->VRAMAddress;
+	_temporaryVRAMAddress = band->temporaryVRAMAddress;
+	_ppuControlRegister1 = band->controlRegister1;
+	_ppuControlRegister2 = band->controlRegister2;
+	_fineHorizontalScroll = band->fineHorizontalScroll;
+	_colorIntensity = band->colorIntensity;
+	_numberOfSpritesOnScanline = band->numberOfSpritesOnScanline;
+	_8x16Sprites = band->tallSprites;
+	_monochrome = band->monochrome;
+	_colorTable = _colorTables + ((((_colorIntensity >> 5) * 2) | _monochrome) * 64);
+	_clipBackground = band->clipBackground;
+	_clipSprites = band->clipSprites;
+	_backgroundEnabled = band->backgroundEnabled;
+	_spritesEnabled = band->spritesEnabled;
+	_shortenPrimingScanline = band->shortenPrimingScanline;
+	_sprite0Hit = NO;
+	
+	_cyclesSinceVINT = firstCycle + (band->scanline * CYCLES_IN_SCANLINE_NORMAL);
+	[self _drawScanlinesStoppingOnCycle:firstCycle + (endingScanline * CYCLES_IN_SCANLINE_NORMAL)];
+}
+
+// Runs on a global queue, one iteration per worker, each rendering a contiguous run of bands
+- (void)_renderBandsForWorker:(uint_fast32_t)worker
+{
+	NESPPUEventLog *log = _replayingLog;
+	uint_fast32_t band = (worker * log->bandCount) / _renderWorkers;
+	uint_fast32_t lastBand = ((worker + 1) * log->bandCount) / _renderWorkers;
+	
+	for (; band < lastBand; band++) {
+		
+		[_bandRenderers[worker] _renderBand:log->bands + band untilScanline:((band + 1) < log->bandCount ? log->bands[band + 1].scanline : 240) withCHRROM:_chrrom];
+	}
+}
+
+static void renderBandsForWorker(void *context, size_t worker) {
+	
+	[(NESPPUEmulator *)context _renderBandsForWorker:worker];
+}
+
+// Runs on the render queue
+- (void)_replayDeferredLog
+{
+	NESPPUEventLog *log = _replayingLog;
+	NESPPUEvent *event = log->events;
+	NESPPUEvent *lastEvent = log->events + log->count;
+	uint64_t startTime;
+	mach_timebase_info_data_t timebase;
+	
+	if (_bandRenderers != NULL) {
+		
+		if (!log->rendersOutput || !log->bandCount) return;
+		
+		startTime = mach_absolute_time();
+		dispatch_apply_f(_renderWorkers,dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0),self,renderBandsForWorker);
+		mach_timebase_info(&timebase);
+		
+		_bandStatistics.frames++;
+		_bandStatistics.bands += log->bandCount;
+		_bandStatistics.renderNanoseconds += ((mach_absolute_time() - startTime) * timebase.numer) / timebase.denom;
+		return;
+	}
+	
+	[_deferredRenderer setRendersOutput:log->rendersOutput];
+	
+	for (; event < lastEvent; event++) {
+		
+		// Bring the renderer to where this PPU was when the event took effect
+		[_deferredRenderer runPPUUntilCPUCycle:event->ppuCPUCycle];
+		
+		switch (event->type) {
+				
+			case NESPPURegisterWriteEvent:
+				[_deferredRenderer writeByte:event->value toPPUFromCPUAddress:event->address onCycle:event->cycle];
+				break;
+			case NESPPURegisterReadEvent:
+				[_deferredRenderer readByteFromCPUAddress:event->address onCycle:event->cycle];
+				break;
+			case NESPPUOAMDMAEvent:
+				[_deferredRenderer DMAtransferToSPRRAM:log->data + event->argument onCycle:event->cycle];
+				break;
+			case NESPPUNameTablePageEvent:
+				[_deferredRenderer setNameTable:event->address toPage:((event->value & 0x2) ? [_deferredRenderer nameTableMemoryPage:event->argument] : _chrrom + event->argument) isWritable:event->value & 0x1];
+				break;
+			case NESPPUCHRBankEvent:
+				_deferredCHRROMBankIndices[event->address] = event->argument;
+				break;
+			case NESPPUFrameEndEvent:
+				[_deferredRenderer resetCPUCycleCounter];
+				break;
+		}
+	}
+}
+
+static void renderDeferredFrame(void *context) {
+	
+	[(NESPPUEmulator *)context _replayDeferredLog];
+}
+
+// Publishes the last rendered frame and hands the frame just recorded to the render queue
+- (void)_submitDeferredFrame
+{
+	uint64_t changedScanlines[4];
+	uint_fast32_t maskWord;
+	
+	dispatch_group_wait(_deferredRenderGroup,DISPATCH_TIME_FOREVER);
+	
+	if ((_replayingLog != NULL) && _replayingLog->rendersOutput) {
+		
+		memcpy(_videoBuffer,_deferredVideoBuffer,sizeof(uint_fast32_t) * 256 * 240);
+		
+		if (_deferredRenderer != nil) {
+			
+			[_deferredRenderer takeChangedScanlines:changedScanlines];
+			for (maskWord = 0; maskWord < 4; maskWord++) _changedScanlines[maskWord] |= changedScanlines[maskWord];
+		}
+		else _changedScanlines[0] = _changedScanlines[1] = _changedScanlines[2] = _changedScanlines[3] = ~0ULL;
+	}
+	
+	_replayingLog = _recordingLog;
+	_recordingLog = (_recordingLog == _deferredLogs) ? (_deferredLogs + 1) : _deferredLogs;
+	_recordingLog->count = 0;
+	_recordingLog->dataLength = 0;
+	_recordingLog->bandCount = 0;
+	_recordingLog->rendersOutput = _rendersOutput;
+	
+	dispatch_group_async_f(_deferredRenderGroup,_deferredRenderQueue,self,renderDeferredFrame);
+}
+
+- (void)_recordTimingEvent:(NESPPUTimingEventType)type onScanline:(uint16_t)scanline dot:(uint16_t)dot address:(uint8_t)address value:(uint8_t)value
+{
+	NESPPUTimingEvent *event;
+	
+	if (_numberOfTimingEvents == MAXIMUM_TIMING_EVENTS) return;
+	
+	event = _timingEvents + _numberOfTimingEvents++;
+	event->scanline = scanline;
+	event->dot = dot;
+	event->type = type;
+	event->address = address;
+	event->value = value;
+	event->reserved = 0;
+}
+
+// Events from the CPU side are placed where the PPU will be on that CPU cycle, without running it there
+- (void)_recordTimingEvent:(NESPPUTimingEventType)type onCycle:(uint_fast32_t)cycle address:(uint8_t)address value:(uint8_t)value
+{
+	uint16_t scanline, dot;
+	
+	timingPositionForPPUCycle(_cyclesSinceVINT + ((cycle > _lastCPUCycle) ? (cycle - _lastCPUCycle) * 3 : 0), _shortenPrimingScanline, &scanline, &dot);
+	[self _recordTimingEvent:type onScanline:scanline dot:dot address:address value:value];
+}
+
+/* setRecordsTimingEvents:
+ * Records every $2000-$2007 write, OAM DMA, mapper IRQ and sprite 0 hit with its scanline and dot. Each frame's events
+ * become available through completedTimingEvents: once the frame ends. When off, each site costs one branch.
+ */
+- (void)setRecordsTimingEvents:(BOOL)flag
+{
+	if (flag && (_timingEvents == NULL)) {
+		
+		_timingEvents = (NESPPUTimingEvent *)malloc(sizeof(NESPPUTimingEvent) * MAXIMUM_TIMING_EVENTS);
+		_completedTimingEvents = (NESPPUTimingEvent *)malloc(sizeof(NESPPUTimingEvent) * MAXIMUM_TIMING_EVENTS);
+	}
+	
+	_numberOfTimingEvents = 0;
+	_numberOfCompletedTimingEvents = 0;
+	_recordsTimingEvents = flag;
+}
+
+- (BOOL)recordsTimingEvents
+{
+	return _recordsTimingEvents;
+}
+
+- (void)recordMapperIRQOnCycle:(uint_fast32_t)cycle
+{
+	if (_recordsTimingEvents) [self _recordTimingEvent:NESPPUTimingMapperIRQ onCycle:cycle address:0 value:0];
+}
+
+- (const NESPPUTimingEvent *)completedTimingEvents:(uint_fast32_t *)count
+{
+	*count = _numberOfCompletedTimingEvents;
+	
+	return _completedTimingEvents;
+}
+
+/* drawTimingMapIntoBuffer:
+ * Draws the last completed frame's events into a 341x262 ARGB buffer, one pixel per dot with scanline 0 at the top.
+ * Visible dots, HBLANK, VBLANK and the priming scanline are shaded differently, register writes are colored by register.
+ */
+- (void)drawTimingMapIntoBuffer:(uint_fast32_t *)buffer
+{
+	static const uint_fast32_t registerColors[8] = { 0xFFFF4040, 0xFFFF9F40, 0xFFFFFF40, 0xFF40FF40, 0xFF40FFFF, 0xFF4080FF, 0xFFA040FF, 0xFFFF40FF };
+	uint_fast32_t scanline, dot, eventIndex;
+	const NESPPUTimingEvent *event;
+	
+	for (scanline = 0; scanline < TIMING_MAP_HEIGHT; scanline++) {
+		
+		for (dot = 0; dot < TIMING_MAP_WIDTH; dot++) {
+			
+			if (scanline == 261) buffer[(scanline * TIMING_MAP_WIDTH) + dot] = 0xFF301818;
+			else if (scanline >= 240) buffer[(scanline * TIMING_MAP_WIDTH) + dot] = 0xFF181830;
+			else if ((dot >= 1) && (dot <= 256)) buffer[(scanline * TIMING_MAP_WIDTH) + dot] = 0xFF303030;
+			else buffer[(scanline * TIMING_MAP_WIDTH) + dot] = 0xFF202020;
+		}
+	}
+	
+	for (eventIndex = 0; eventIndex < _numberOfCompletedTimingEvents; eventIndex++) {
+		
+		event = _completedTimingEvents + eventIndex;
+		
+		switch (event->type) {
+				
+			case NESPPUTimingRegisterWrite:
+				buffer[(event->scanline * TIMING_MAP_WIDTH) + event->dot] = registerColors[event->address & 0x7];
+				break;
+			case NESPPUTimingOAMDMA:
+				buffer[(event->scanline * TIMING_MAP_WIDTH) + event->dot] = 0xFFFFFFFF;
+				break;
+			case NESPPUTimingMapperIRQ:
+				buffer[(event->scanline * TIMING_MAP_WIDTH) + event->dot] = 0xFFFFD700;
+				break;
+			case NESPPUTimingSprite0Hit:
+				buffer[(event->scanline * TIMING_MAP_WIDTH) + event->dot] = 0xFF00FF80;
+				break;
+		}
+	}
+}
+
+// One event per line in a fixed format, so logs from two builds can be compared with diff
+- (NSString *)timingEventLogDescription
+{
+	static NSString * const eventNames[4] = { @"write", @"oamdma", @"irq", @"sprite0" };
+	NSMutableString *description = [NSMutableString string];
+	uint_fast32_t eventIndex;
+	const NESPPUTimingEvent *event;
+	
+	for (eventIndex = 0; eventIndex < _numberOfCompletedTimingEvents; eventIndex++) {
+		
+		event = _completedTimingEvents + eventIndex;
+		
+		if (event->type == NESPPUTimingRegisterWrite) [description appendFormat:@"%3d %3d %@ $%4.4x $%2.2x\n",event->scanline,event->dot,eventNames[event->type],0x2000 | event->address,event->value];
+		else [description appendFormat:@"%3d %3d %@\n",event->scanline,event->dot,eventNames[event->type]];
+	}
+	
+	return description;
+}
+
+- (BOOL)writeTimingEventLogToFile:(NSString *)path
+{
+	return [[self timingEventLogDescription] writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+}
+
+/* benchmarkFramesPerSecondWithEngine:frames:
+ * Times a scratch PPU of the given class rendering the given number of frames from this PPU's current state, with no
+ * CPU attached, so both engines can be compared on the screen a game is actually showing.
+ */
+- (double)benchmarkFramesPerSecondWithEngine:(Class)engine frames:(uint_fast32_t)frames
+{
+	uint_fast32_t *buffer = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * 256 * 240);
+	uint_fast32_t bankIndices[CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE];
+	uint_fast32_t frame;
+	uint64_t startTime, elapsedTime;
+	mach_timebase_info_data_t timebase;
+	NESPPUEmulator *ppu;
+	
+	memcpy(bankIndices,_chrromBankIndices,sizeof(uint_fast32_t) * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
+	ppu = [[engine alloc] initWithBuffer:buffer];
+	if (_usingCHRRAM) [ppu cacheCHRROM:_chrrom length:_chrromSize bankIndices:bankIndices isWritable:YES];
+	else [ppu cacheCHRROM:_chrrom length:_chrromSize bankIndices:bankIndices decodedTiles:_tileCache];
+	[self _copyStateToPPU:ppu];
+	[ppu resetCPUCycleCounter];
+	
+	startTime = mach_absolute_time();
+	
+	for (frame = 0; frame < frames; frame++) {
+		
+		[ppu runPPUUntilCPUCycle:[ppu cpuCyclesUntilVblank]];
+		[ppu resetCPUCycleCounter];
+	}
+	
+	elapsedTime = mach_absolute_time() - startTime;
+	mach_timebase_info(&timebase);
+	
+	[ppu release];
+	free(buffer);
+	
+	return (double)frames / (((double)elapsedTime * timebase.numer / timebase.denom) / 1000000000.0);
+}
+
+// Scripts the same mid-frame writes on a scratch PPU, each on its own scanline so a missed band split shows up in the pixels
+static void writeBandTestFrame(NESPPUEmulator *ppu, uint_fast32_t frame, uint8_t *oamPage)
+{
+	uint_fast32_t sprite;
+	
+	for (sprite = 0; sprite < 64; sprite++) {
+		
+		oamPage[sprite * 4] = 160 + ((sprite & 0x7) * 8);
+		oamPage[(sprite * 4) + 1] = sprite + frame;
+		oamPage[(sprite * 4) + 2] = sprite & 0x3;
+		oamPage[(sprite * 4) + 3] = (sprite * 4) + frame;
 	}
+	
+	[ppu writeByte:0x1E toPPUFromCPUAddress:0x2001 onCycle:1];
+	[ppu writeByte:0x3F toPPUFromCPUAddress:0x2006 onCycle:(CYCLES_BEFORE_RENDERING_NORMAL + (40 * CYCLES_IN_SCANLINE_NORMAL)) / 3];
+	[ppu writeByte:0x00 toPPUFromCPUAddress:0x2006 onCycle:((CYCLES_BEFORE_RENDERING_NORMAL + (40 * CYCLES_IN_SCANLINE_NORMAL)) / 3) + 4];
+	[ppu writeByte:(frame * 7) & 0x3F toPPUFromCPUAddress:0x2007 onCycle:(CYCLES_BEFORE_RENDERING_NORMAL + (72 * CYCLES_IN_SCANLINE_NORMAL)) / 3];
+	[ppu writeByte:0x00 toPPUFromCPUAddress:0x2003 onCycle:(CYCLES_BEFORE_RENDERING_NORMAL + (100 * CYCLES_IN_SCANLINE_NORMAL)) / 3];
+	[ppu writeByte:120 toPPUFromCPUAddress:0x2004 onCycle:((CYCLES_BEFORE_RENDERING_NORMAL + (100 * CYCLES_IN_SCANLINE_NORMAL)) / 3) + 4];
+	[ppu DMAtransferToSPRRAM:oamPage onCycle:(CYCLES_BEFORE_RENDERING_NORMAL + (150 * CYCLES_IN_SCANLINE_NORMAL)) / 3];
+	[ppu runPPUUntilCPUCycle:[ppu cpuCyclesUntilVblank]];
+	[ppu resetCPUCycleCounter];
 }
 
-- (void)cacheCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size bankIndices:(uint_fast32_t *)indices isWritable:(BOOL)isWritable
+/* bandRenderingMismatchesWithWorkers:frames:
+ * Renders frames from this PPU's current state on two scratch PPUs, one synchronous and one splitting deferred frames
+ * into bands, with a $2007 write, $2003/$2004 writes and an OAM DMA scripted mid-frame on both, and returns how many
+ * pixels differ. Deferred frames are published a frame late, so each is compared with the synchronous frame before.
+ */
+- (uint_fast32_t)bandRenderingMismatchesWithWorkers:(uint_fast32_t)workers frames:(uint_fast32_t)frames
 {
-	uint_fast32_t bankIndex, tileIndex, lineIndex;
-	_tileCache = (uint8_t ****)malloc(sizeof(uint8_t***) * (size / CHRROM_BANK_SIZE));
+	uint_fast32_t *buffer = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * 256 * 240);
+	uint_fast32_t *bandBuffer = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * 256 * 240);
+	uint_fast32_t *previousFrame = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * 256 * 240);
+	uint_fast32_t bankIndices[CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE];
+	uint_fast32_t bandBankIndices[CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE];
+	uint_fast32_t frame, pixel;
+	uint_fast32_t mismatches = 0;
+	uint8_t oamPage[256];
+	NESPPUEmulator *ppu, *bandPPU;
+	
+	if (_usingCHRRAM || (_tileCache == NULL)) {
+		
+		NSLog(@"Band rendering requires CHR-ROM, nothing to compare.");
+		free(buffer);
+		free(bandBuffer);
+		free(previousFrame);
+		return 0;
+	}
 	
-	for (bankIndex = 0; bankIndex < (size / CHRROM_BANK_SIZE); bankIndex++) {
+	memcpy(bankIndices,_chrromBankIndices,sizeof(uint_fast32_t) * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
+	memcpy(bandBankIndices,_chrromBankIndices,sizeof(uint_fast32_t) * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
+	ppu = [[NESPPUEmulator alloc] initWithBuffer:buffer];
+	bandPPU = [[NESPPUEmulator alloc] initWithBuffer:bandBuffer];
+	[ppu cacheCHRROM:_chrrom length:_chrromSize bankIndices:bankIndices decodedTiles:_tileCache];
+	[bandPPU cacheCHRROM:_chrrom length:_chrromSize bankIndices:bandBankIndices decodedTiles:_tileCache];
+	[self _copyStateToPPU:ppu];
+	[self _copyStateToPPU:bandPPU];
+	[ppu resetCPUCycleCounter];
+	[bandPPU resetCPUCycleCounter];
+	[bandPPU setRenderWorkers:workers];
+	[bandPPU setDeferredRendering:YES];
+	
+	for (frame = 0; frame < frames; frame++) {
 		
-		// 16 bytes per 8x8 tile
-		_tileCache[bankIndex] = (uint8_t ***)malloc(sizeof(uint8_t**) * (CHRROM_BANK_SIZE / 16));
+		writeBandTestFrame(ppu, frame, oamPage);
+		writeBandTestFrame(bandPPU, frame, oamPage);
 		
-		for (tileIndex = 0; tileIndex < (CHRROM_BANK_SIZE / 16); tileIndex++) {
-			
-			_tileCache[bankIndex][tileIndex] = (uint8_t **)malloc(sizeof(uint8_t *) * 8);
+		if (frame) {
 			
-			for (lineIndex = 0; lineIndex < 8; lineIndex++) {
-				
-				_tileCache[bankIndex][tileIndex][lineIndex] = (uint8_t *)malloc(sizeof(uint8_t) * 8);
-			}
+			for (pixel = 0; pixel < (256 * 240); pixel++) if (bandBuffer[pixel] != previousFrame[pixel]) mismatches++;
 		}
 		
-		generateTileCacheForCHRROMSegment(_tileCache[bankIndex],chrrom + (bankIndex * CHRROM_BANK_SIZE));
+		memcpy(previousFrame,buffer,sizeof(uint_fast32_t) * 256 * 240);
 	}
 	
-	_chrrom = chrrom;
-	_chrromBankIndices = indices;
+	[bandPPU setDeferredRendering:NO];
+	[bandPPU release];
+	[ppu release];
+	free(buffer);
+	free(bandBuffer);
+	free(previousFrame);
 	
-	if (isWritable) {
+	return mismatches;
+}
+
+// Polls $2002 mid-line every eight scanlines, keeping the flags each read returned, then runs the frame to its end
+static void pollStatusThroughFrame(NESPPUEmulator *ppu, uint8_t *statusReads)
+{
+	uint_fast32_t poll;
+	
+	for (poll = 0; poll < 30; poll++) statusReads[poll] = [ppu readByteFromCPUAddress:0x2002 onCycle:(CYCLES_BEFORE_RENDERING_NORMAL + (poll * 8 * CYCLES_IN_SCANLINE_NORMAL) + 128) / 3] & 0xE0;
+	[ppu runPPUUntilCPUCycle:[ppu cpuCyclesUntilVblank]];
+	[ppu resetCPUCycleCounter];
+}
+
+/* mismatchedFramesWithEngine:frames:
+ * Runs a scratch scanline PPU and a scratch PPU of the given class side by side from this PPU's current state, polling
+ * $2002 through each frame, and logs every frame whose pixels or status reads differ. Returns how many frames differed.
+ */
+- (uint_fast32_t)mismatchedFramesWithEngine:(Class)engine frames:(uint_fast32_t)frames
+{
+	uint_fast32_t *buffers[2];
+	uint_fast32_t bankIndices[2][CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE];
+	uint8_t statusReads[2][30];
+	uint_fast32_t frame, pixel, poll, differingPixels, differingReads;
+	uint_fast32_t mismatchedFrames = 0;
+	NESPPUEmulator *ppus[2];
+	uint_fast32_t ppuIndex;
+	
+	for (ppuIndex = 0; ppuIndex < 2; ppuIndex++) {
 		
-		_usingCHRRAM = YES;
-		_chrramWriteHistory = (BOOL *)malloc(sizeof(BOOL) * (size / CHRROM_BANK_SIZE));
+		buffers[ppuIndex] = (uint_fast32_t *)malloc(sizeof(uint_fast32_t) * 256 * 240);
+		memcpy(bankIndices[ppuIndex],_chrromBankIndices,sizeof(uint_fast32_t) * (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE));
+		ppus[ppuIndex] = [[(ppuIndex ? engine : [NESPPUEmulator class]) alloc] initWithBuffer:buffers[ppuIndex]];
+		if (_usingCHRRAM) [ppus[ppuIndex] cacheCHRROM:_chrrom length:_chrromSize bankIndices:bankIndices[ppuIndex] isWritable:YES];
+		else [ppus[ppuIndex] cacheCHRROM:_chrrom length:_chrromSize bankIndices:bankIndices[ppuIndex] decodedTiles:_tileCache];
+		[self _copyStateToPPU:ppus[ppuIndex]];
+		[ppus[ppuIndex] resetCPUCycleCounter];
+	}
+	
+	for (frame = 0; frame < frames; frame++) {
 		
-		for (bankIndex = 0; bankIndex < (size / CHRROM_BANK_SIZE); bankIndex++) {
-				
-			_chrramWriteHistory[bankIndex] = NO;
+		pollStatusThroughFrame(ppus[0], statusReads[0]);
+		pollStatusThroughFrame(ppus[1], statusReads[1]);
+		
+		differingPixels = differingReads = 0;
+		for (pixel = 0; pixel < (256 * 240); pixel++) if (buffers[0][pixel] != buffers[1][pixel]) differingPixels++;
+		for (poll = 0; poll < 30; poll++) if (statusReads[0][poll] != statusReads[1][poll]) differingReads++;
+		
+		if (differingPixels || differingReads) {
+			
+			mismatchedFrames++;
+			NSLog(@"Frame %lu: %lu pixels and %lu of 30 $2002 reads differ.",(unsigned long)frame,(unsigned long)differingPixels,(unsigned long)differingReads);
 		}
 	}
+	
+	for (ppuIndex = 0; ppuIndex < 2; ppuIndex++) {
+		
+		[ppus[ppuIndex] release];
+		free(buffers[ppuIndex]);
+	}
+	
+	return mismatchedFrames;
 }
 
-- (void)_notifyStateObserver
+- (void)_setColorTablesFromColors:(const uint_fast32_t *)colors count:(uint_fast32_t)count
 {
-	_observerState->controlRegister1 = _ppuControlRegister1;
-	_observerState->controlRegister2 = _ppuControlRegister2;
-	_observerState->statusRegister = _ppuStatusRegister;
-	_observerState->cycle = _cyclesSinceVINT;
-
-	[_stateObservingInvocation invoke];
+	BOOL deferredRendering = _deferredRendering;
+	
+	// Renderers copy the tables when they're created
+	if (deferredRendering) [self setDeferredRendering:NO];
+	
+	buildColorTables(colors, count, _colorTables, _colorTables16);
+	invalidateScanlineMemo(_memoizedScanlines,_changedScanlines);
+	
+	if (deferredRendering) [self setDeferredRendering:YES];
 }
 
-- (void)_preloadTilesForScanline
+/* loadPaletteFromFile:
+ * Loads a .pal file of 64 RGB triplets, or 512 with one set of 64 per emphasis combination.
+ */
+- (BOOL)loadPaletteFromFile:(NSString *)path
 {
-	uint8_t tileIndex;
-	uint_fast32_t bankIndex;
-	uint8_t verticalTileOffset;
-	uint8_t pixelCounter;
-	uint8_t	tileAttributes;
-	uint8_t tileUpperColorBits;
-	uint16_t nameTableOffset;
-	uint8_t tileLowerColorBits;
-	
-	// Fetch first tile in the scanline
-	// Fetch the attribute byte
-	nameTableOffset = _nameTableMirroring(_VRAMAddress);
-	tileIndex = _nameAndAttributeTables[nameTableOffset];
-	bankIndex = _chrromBankIndices[_backgroundTileCacheIndex + (tileIndex / (CHRROM_BANK_SIZE / 16))];
-	tileIndex &= ((CHRROM_BANK_SIZE / 16) - 1);
-	tileAttributes = _nameAndAttributeTables[attributeTableIndexForNametableIndex(nameTableOffset)];
-	tileUpperColorBits = upperColorBitsFromAttributeByte(tileAttributes, nameTableOffset);
-	verticalTileOffset = (_VRAMAddress & 0x7000) / 4096;
+	NSData *paletteData = [NSData dataWithContentsOfFile:path];
+	const uint8_t *bytes = (const uint8_t *)[paletteData bytes];
+	uint_fast32_t colors[512];
+	uint_fast32_t numberOfColors, colorIndex;
 	
-	for (pixelCounter = 0; pixelCounter < 8; pixelCounter++) {
+	if ((paletteData == nil) || (([paletteData length] != (64 * 3)) && ([paletteData length] != (512 * 3)))) {
 		
-		tileLowerColorBits = _tileCache[bankIndex][tileIndex][verticalTileOffset][pixelCounter];
-		_playfieldBuffer[pixelCounter] = tileLowerColorBits ? (tileLowerColorBits | tileUpperColorBits) : 0;
+		NSLog(@"Unable to load palette from %@, expected 192 or 1536 bytes.",path);
+		return NO;
 	}
 	
-	// Increment the VRAM address one tile to the right
-	incrementVRAMAddressHorizontally(&_VRAMAddress); 
-	
-	// Fetch the second tile in the scanline
-	// Fetch the attribute byte
-	nameTableOffset = _nameTableMirroring(_VRAMAddress);
-	tileIndex = _nameAndAttributeTables[nameTableOffset];
-	bankIndex = _chrromBankIndices[_backgroundTileCacheIndex + (tileIndex / (CHRROM_BANK_SIZE / 16))];
-	tileIndex &= ((CHRROM_BANK_SIZE / 16) - 1);
-	tileAttributes = _nameAndAttributeTables[attributeTableIndexForNametableIndex(nameTableOffset)];
-	tileUpperColorBits = upperColorBitsFromAttributeByte(tileAttributes, nameTableOffset);
+	numberOfColors = [paletteData length] / 3;
 	
-	for (pixelCounter = 0; pixelCounter < 8; pixelCounter++) {
+	for (colorIndex = 0; colorIndex < numberOfColors; colorIndex++) {
 		
-		tileLowerColorBits = _tileCache[bankIndex][tileIndex][verticalTileOffset][pixelCounter];
-		_playfieldBuffer[pixelCounter + 8] = tileLowerColorBits ? (tileLowerColorBits | tileUpperColorBits) : 0;
+		colors[colorIndex] = 0xFF000000 | (bytes[colorIndex * 3] << 16) | (bytes[(colorIndex * 3) + 1] << 8) | bytes[(colorIndex * 3) + 2];
 	}
 	
-	// Increment the VRAM address one tile to the right
-	incrementVRAMAddressHorizontally(&_VRAMAddress); 	
+	[self _setColorTablesFromColors:colors count:numberOfColors];
+	
+	return YES;
 }
 
-- (void)_findInRangeSprites:(uint_fast8_t)scanline
+- (void)resetPalette
 {
-	uint_fast32_t sprRAMIndex;
-	
-	_numberOfSpritesOnScanline = 0;
+	[self _setColorTablesFromColors:colorPalette count:64];
+}
+
+- (const uint_fast32_t *)colorTableForMask:(uint8_t)mask
+{
+	return _colorTables + ((((mask >> 5) * 2) | (mask & 0x1)) * 64);
+}
+
+- (const uint16_t *)colorTable16ForMask:(uint8_t)mask
+{
+	return _colorTables16 + ((((mask >> 5) * 2) | (mask & 0x1)) * 64);
+}
+
+/* observableStateHash
+ * Hashes everything a game can observe from the PPU (registers, scroll, OAM, palettes, nametables and pending
+ * sprite 0 hit) but not the pixels, so runs with and without frameskip can be compared frame by frame.
+ */
+- (uint32_t)observableStateHash
+{
+	uint8_t registers[12] = { _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, _fineHorizontalScroll, _VRAMAddress & 0xFF, _VRAMAddress >> 8, _temporaryVRAMAddress & 0xFF, _temporaryVRAMAddress >> 8, _bufferedVRAMRead, _sprRAMAddress, _sprite0Hit, _sprite0Hit ? _sprite0HitCycle : 0 };
+	uint32_t hash = hashBytes(2166136261U, registers, 12);
+	uint_fast8_t nameTable;
 	
-	for (sprRAMIndex = 0; sprRAMIndex < 256; sprRAMIndex += 4) {
+	hash = hashBytes(hash, _sprRAM, 256);
+	hash = hashBytes(hash, _palettes, 32);
+	for (nameTable = 0; nameTable < 4; nameTable++) hash = hashBytes(hash, _nameTablePages[nameTable], 1024);
 	
-		// FIXME: If it turns out that sprites on scanline 0 have Y coords of 0xFF then I'll need to add back (uint8_t) to make sure the addition overflows.
-		if ((scanline >= (_sprRAM[sprRAMIndex] + 1)) && ((scanline - (_sprRAM[sprRAMIndex] + 1)) < (_8x16Sprites ? 16 : 8))) {
+	return hash;
+}
+
+// Raises the status flag for a pending sprite 0 hit once the given run of dots reaches it, for both engines
+- (void)_reportSprite0HitOnScanline:(uint_fast32_t)scanline fromCycle:(uint_fast32_t)startingCycle toCycle:(uint_fast32_t)endingCycle
+{
+	if ((startingCycle <= _sprite0HitCycle) && (endingCycle > _sprite0HitCycle)) {
 		
-			if (_numberOfSpritesOnScanline == 8) {
-				
-				// Set flag on 9th in range object found
-				_ppuStatusRegister |= 0x20;
-				break;
-			}
-			_spritesOnCurrentScanline[_numberOfSpritesOnScanline++] = sprRAMIndex;
-		}
+		_ppuStatusRegister |= 0x40;
+		_sprite0Hit = NO; // Reset internal sprite 0 hit flag
+		if (_recordsTimingEvents) [self _recordTimingEvent:NESPPUTimingSprite0Hit onScanline:scanline dot:_sprite0HitCycle + 1 address:0 value:0];
 	}
 }
 
 - (void)_drawScanlinesStoppingOnCycle:(uint_fast32_t)endingCycle
 {
 	uint_fast32_t bankIndex;
-	uint_fast8_t tileIndex;
 	uint_fast8_t tileCounter;
 	uint_fast8_t currentScanline;
 	uint_fast8_t scanlinePixelCounter;
 	uint_fast8_t verticalTileOffset;
 	uint_fast8_t pixelCounter;
-	int spritePixelIndex;
-	int spritePixelIncrement;
-	int spriteCounter;
-	uint_fast8_t tileAttributes;
-	uint_fast8_t tileUpperColorBits;
+	uint_fast8_t spriteCounter;
 	uint_fast8_t tileLowerColorBits;
-	uint_fast16_t nameTableOffset;
+	NESBackgroundTile *backgroundTile;
+	uint8_t *tileRow;
 	uint_fast8_t sprRAMIndex;
-	uint_fast8_t spriteVerticalOffset;
-	uint_fast8_t spriteHorizontalOffset;
-	uint_fast32_t spriteVideoBufferOffset;
-	uint_fast8_t spritePixelsToDraw;
-	uint_fast8_t spriteLowerColorBits;
+	uint_fast8_t spriteAttributes;
+	uint_fast32_t spriteHorizontalOffset;
+	uint_fast32_t spriteLowerPlane;
+	uint_fast32_t spriteUpperPlane;
 	uint_fast8_t spriteUpperColorBits;
-	uint_fast32_t spritePriorityMask;
-	uint_fast32_t bgOpacityMask;
-	uint_fast32_t pixelMask;
-	uint_fast32_t pixelLockArray[256];
-	uint_fast8_t bgOpacityBuffer[256];
+	uint_fast32_t maskWord;
+	uint_fast32_t pixel;
+	uint64_t spriteRowMask[2];
+	uint64_t newSpritePixels;
+	uint64_t bgOpacityMask[4];
+	uint64_t spriteOpacityMask[4];
+	uint64_t spriteBehindMask[4];
+	uint8_t spriteLineBuffer[256];
+	const uint_fast32_t *colorTable;
 	uint_fast32_t cyclesPastPrimingScanline, scanlineStartingCycle, scanlineEndingCycle;
 	
 	// NSLog(@"In drawScanlines method. Drawing from %d to %d.",start,stop);
@@ -460,8 +1944,9 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 			
 			if (_chrramWriteHistory[bankIndex]) {
 			
-				generateTileCacheForCHRROMSegment(_tileCache[bankIndex],_chrrom + (_chrromBankIndices[bankIndex] * CHRROM_BANK_SIZE));
+				generateTileCacheForCHRROMSegment(_tileCache + (bankIndex * TILE_CACHE_BANK_SIZE),_chrrom + (_chrromBankIndices[bankIndex] * CHRROM_BANK_SIZE));
 				_chrramWriteHistory[bankIndex] = NO;
+				_chrramGeneration++;
 			}
 		}
 	}
@@ -478,12 +1963,36 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 			
 		// Determine ending cycle for scanline (will only increment registers if greater than 255)
 		scanlineEndingCycle = (_cyclesSinceVINT + (CYCLES_IN_SCANLINE_NORMAL - scanlineStartingCycle)) <= endingCycle ? CYCLES_IN_SCANLINE_NORMAL : endingCycle - _cyclesSinceVINT + scanlineStartingCycle;
-			
+		
 		if (scanlineStartingCycle == 0) {
+			
+			_a12RiseDot = 0;
+			callPPUHook(_hooks + NESPPUScanlineStartHook, &_hookState, _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, _cyclesSinceVINT);
+		}
+			
+		if ((scanlineStartingCycle == 0) && ((!_rendersOutput && !_validatesLogicOnlyRendering) || _deferredRendering)) {
+			
+			if (_bandRenderers != NULL) [self _captureBandSnapshotForScanline:currentScanline];
+			[self _simulateScanline:currentScanline];
+		}
+		else if ((scanlineStartingCycle == 0) && _memoizesScanlines && [self _matchScanlineInputs:currentScanline]) {
+			
+			// The video buffer already holds this line's pixels
+			[self _simulateScanline:currentScanline];
+		}
+		else if (scanlineStartingCycle == 0) {
 				
 			// Set video buffer index
 			_videoBufferIndex = currentScanline * 256;
 			
+			// Emphasis and greyscale only change with PPUMASK, so the color table is chosen once per line
+			colorTable = _colorTable;
+			
+			if (_validatesLogicOnlyRendering) [self _predictLogicOnlyScanline:currentScanline];
+			
+			// Clear the background opacity mask, one bit per pixel
+			bgOpacityMask[0] = bgOpacityMask[1] = bgOpacityMask[2] = bgOpacityMask[3] = 0;
+			
 			if (_backgroundEnabled) {
 				
 				// Initialize Scanline Pixel Counter
@@ -491,40 +2000,40 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 			
 				// Get Vertical Tile Offset
 				verticalTileOffset = (_VRAMAddress & 0x7000) / 4096;
+				
+				// Bring this row's tile descriptors up to date
+				[self _prepareBackgroundTilesForVRAMAddress:_VRAMAddress];
 		
 				// Draw first two cached tiles
-				// FIXME: It might be faster to do the colorPalette indexing elsewhere and then memcpy here
+				// FIXME: It might be faster to do the colorTable indexing elsewhere and then memcpy here
 				for (pixelCounter = _fineHorizontalScroll; pixelCounter < 16; pixelCounter++) {
 			
 					// Fill first 8 pixels with black if background clipping is enabled
 					if (_clipBackground && (scanlinePixelCounter < 8)) {
 						
 						_videoBuffer[_videoBufferIndex++] = 0;
-						bgOpacityBuffer[scanlinePixelCounter++] = 0;
+						scanlinePixelCounter++;
 					}
 					else {
 						
-						_videoBuffer[_videoBufferIndex++] = colorPalette[_backgroundPalette[_playfieldBuffer[pixelCounter]]];
-						bgOpacityBuffer[scanlinePixelCounter++] = _playfieldBuffer[pixelCounter] & 0x3;
+						_videoBuffer[_videoBufferIndex++] = colorTable[_backgroundPalette[_playfieldBuffer[pixelCounter]]];
+						if (_playfieldBuffer[pixelCounter] & 0x3) setLineMaskBit(bgOpacityMask,scanlinePixelCounter);
+						scanlinePixelCounter++;
 					}
 				}
 		
 				for (tileCounter = 0; tileCounter < 30; tileCounter++) {
 			
-					nameTableOffset = _nameTableMirroring(_VRAMAddress);
-					tileIndex = _nameAndAttributeTables[nameTableOffset];
-					bankIndex = _chrromBankIndices[_backgroundTileCacheIndex + (tileIndex / (CHRROM_BANK_SIZE / 16))];
-					tileIndex &= ((CHRROM_BANK_SIZE / 16) - 1);
-					tileAttributes = _nameAndAttributeTables[attributeTableIndexForNametableIndex(nameTableOffset)];
-					tileUpperColorBits = upperColorBitsFromAttributeByte(tileAttributes, nameTableOffset);
-					// NSLog(@"Loading Tile Cache. VRAMAddress: 0x%4.4x NameTableOffset: %d TileIndex: %d VerticalTileOffset: %d",_VRAMAddress,nameTableOffset,tileIndex,verticalTileOffset);
+					backgroundTile = _backgroundTiles + (_VRAMAddress & 0x0FFF);
+					tileRow = backgroundTile->tile + (verticalTileOffset * 8);
 			
 					for (pixelCounter = 0; pixelCounter < 8; pixelCounter++) {
 	
-						tileLowerColorBits = _tileCache[bankIndex][tileIndex][verticalTileOffset][pixelCounter];
+						tileLowerColorBits = tileRow[pixelCounter];
 						// Profiling shows that this trinary doesn't affect performance compared to an optimized palette
-						_videoBuffer[_videoBufferIndex++] = colorPalette[_backgroundPalette[tileLowerColorBits ? (tileLowerColorBits | tileUpperColorBits) : 0]];
-						bgOpacityBuffer[scanlinePixelCounter++] = tileLowerColorBits;
+						_videoBuffer[_videoBufferIndex++] = colorTable[_backgroundPalette[tileLowerColorBits ? (tileLowerColorBits | backgroundTile->upperColorBits) : 0]];
+						if (tileLowerColorBits) setLineMaskBit(bgOpacityMask,scanlinePixelCounter);
+						scanlinePixelCounter++;
 					
 						// if (_videoBufferIndex > 65535) NSLog(@"Video buffer has overrun!");
 					}
@@ -534,18 +2043,15 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 				}
 			
 				// Draw the 33rd title if necessary
-				nameTableOffset = _nameTableMirroring(_VRAMAddress);
-				tileIndex = _nameAndAttributeTables[nameTableOffset];
-				bankIndex = _chrromBankIndices[_backgroundTileCacheIndex + (tileIndex / (CHRROM_BANK_SIZE / 16))];
-				tileIndex &= ((CHRROM_BANK_SIZE / 16) - 1);
-				tileAttributes = _nameAndAttributeTables[attributeTableIndexForNametableIndex(nameTableOffset)];
-				tileUpperColorBits = upperColorBitsFromAttributeByte(tileAttributes, nameTableOffset);
+				backgroundTile = _backgroundTiles + (_VRAMAddress & 0x0FFF);
+				tileRow = backgroundTile->tile + (verticalTileOffset * 8);
 			
 				for (pixelCounter = 0; pixelCounter < _fineHorizontalScroll; pixelCounter++) {
 			
-					tileLowerColorBits = _tileCache[bankIndex][tileIndex][verticalTileOffset][pixelCounter];
-					_videoBuffer[_videoBufferIndex++] = colorPalette[_backgroundPalette[tileLowerColorBits ? (tileLowerColorBits | tileUpperColorBits) : 0]];
-					bgOpacityBuffer[scanlinePixelCounter++] = tileLowerColorBits;
+					tileLowerColorBits = tileRow[pixelCounter];
+					_videoBuffer[_videoBufferIndex++] = colorTable[_backgroundPalette[tileLowerColorBits ? (tileLowerColorBits | backgroundTile->upperColorBits) : 0]];
+					if (tileLowerColorBits) setLineMaskBit(bgOpacityMask,scanlinePixelCounter);
+					scanlinePixelCounter++;
 				}
 				
 				// Increment the VRAM address one tile to the right
@@ -559,82 +2065,64 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 					for (tileCounter = 0; tileCounter < 31; tileCounter++) incrementVRAMAddressHorizontally(&_VRAMAddress);
 				}
 				
-				bzero(bgOpacityBuffer,sizeof(uint_fast8_t)*256);
 				bzero(_videoBuffer + _videoBufferIndex,sizeof(uint_fast32_t)*256);
 				_videoBufferIndex += 256;
 			}
 			
 			if (_spritesEnabled) {
 				
-				// Clear the pixel locks and draw sprites
-				bzero(pixelLockArray,sizeof(uint_fast32_t)*256);
-			
+				// Render in-range sprites front to back into the sprite line buffer, tracking claimed pixels in a 256-bit occupancy mask
+				spriteOpacityMask[0] = spriteOpacityMask[1] = spriteOpacityMask[2] = spriteOpacityMask[3] = 0;
+				spriteBehindMask[0] = spriteBehindMask[1] = spriteBehindMask[2] = spriteBehindMask[3] = 0;
+				
 				for (spriteCounter = 0; spriteCounter < _numberOfSpritesOnScanline; spriteCounter++) {
 			
 					sprRAMIndex = _spritesOnCurrentScanline[spriteCounter];
-					spriteVerticalOffset = (_sprRAM[sprRAMIndex + 2] & 0x80 ? (_8x16Sprites ? 15 : 7) - (((_videoBufferIndex / 256) - 1) - (_sprRAM[sprRAMIndex] + 1)) : ((_videoBufferIndex / 256) - 1) - (_sprRAM[sprRAMIndex] + 1));
-					// FIXME: If it turns out that sprites on scanline 0 have Y coords of 0xFF then I'll need to add back (uint8_t) to make sure the addition overflows.
-					tileIndex = _8x16Sprites ? ((_sprRAM[sprRAMIndex + 1] & 0xFE) + (spriteVerticalOffset / 8)) : _sprRAM[sprRAMIndex + 1];
-					bankIndex = _chrromBankIndices[(_8x16Sprites ? ((_sprRAM[sprRAMIndex + 1] & 0x1) ? (BANK_SIZE_4KB / CHRROM_BANK_SIZE) : 0) : _spriteTileCacheIndex) + (tileIndex / (CHRROM_BANK_SIZE / 16))];
-					tileIndex &= ((CHRROM_BANK_SIZE / 16) - 1);
-					spriteVerticalOffset &= 0x7;
+					spriteAttributes = _sprRAM[sprRAMIndex + 2];
+					fetchSpriteRow(_sprRAM + sprRAMIndex, currentScanline, _8x16Sprites, _spriteTileCacheIndex, _chrromBankIndices, _chrrom, &spriteLowerPlane, &spriteUpperPlane);
+					
+					if (!(spriteLowerPlane | spriteUpperPlane)) continue;
+					
 					spriteHorizontalOffset = _sprRAM[sprRAMIndex + 3];
-					spriteVideoBufferOffset = _videoBufferIndex - 256 + spriteHorizontalOffset;
-					spritePixelsToDraw = spriteHorizontalOffset < 249 ? 8 : 256 - spriteHorizontalOffset;
-					spriteUpperColorBits = (_sprRAM[sprRAMIndex + 2] & 0x3) * 4;
-					spritePriorityMask = 0xFFFFFFFF * ((_sprRAM[sprRAMIndex + 2] & 0x20) / 32);
-				
-					// Check for horizontal flip
-					if (_sprRAM[sprRAMIndex + 2] & 0x40) {
-				
-						spritePixelIncrement = -1;
-						spritePixelIndex = 7;
-					}
-					else {
+					maskWord = positionSpriteRow(spriteLowerPlane | spriteUpperPlane, spriteHorizontalOffset, _clipSprites, spriteRowMask);
 					
-						spritePixelIncrement = 1;
-						spritePixelIndex = 0;
+					if ((sprRAMIndex == 0) && !_sprite0Hit && findSprite0Hit(spriteRowMask, maskWord, bgOpacityMask, &pixel)) {
+					
+						_sprite0Hit = YES;
+						_sprite0HitCycle = pixel;
 					}
-								
-					// Draw Sprite Pixels
-					for (pixelCounter = 0; pixelCounter < spritePixelsToDraw; pixelCounter++) {
 					
-						spriteLowerColorBits = _tileCache[bankIndex][tileIndex][spriteVerticalOffset][spritePixelIndex];
-						
-						if (spriteLowerColorBits && ((spriteHorizontalOffset + pixelCounter > 7) || !_clipSprites)) {
+					spriteUpperColorBits = (spriteAttributes & 0x3) * 4;
 					
-							// Check for sprite 0 hit
-							if ((sprRAMIndex == 0) && bgOpacityBuffer[spriteHorizontalOffset + pixelCounter] && (spriteHorizontalOffset + pixelCounter != 255)) {
-								
-								if (!_sprite0Hit) {
-									
-									_sprite0Hit = YES;
-									_sprite0HitCycle = spriteHorizontalOffset + pixelCounter;
-									// NSLog(@"Sprite 0 hit on pixel %d of scanline %d.",spriteHorizontalOffset + pixelCounter,currentScanline);
-								}
-							}
-							
-							bgOpacityMask = (bgOpacityBuffer[spriteHorizontalOffset + pixelCounter] ? 0xFFFFFFFF : 0x00000000);
-							pixelMask = (spritePriorityMask & bgOpacityMask) | pixelLockArray[spriteHorizontalOffset + pixelCounter];
-							_videoBuffer[spriteVideoBufferOffset + pixelCounter] &= pixelMask;
-							_videoBuffer[spriteVideoBufferOffset + pixelCounter] |= colorPalette[_spritePalette[spriteLowerColorBits | spriteUpperColorBits]] & ~pixelMask;
-							pixelLockArray[spriteHorizontalOffset + pixelCounter] = 0xFFFFFFFF;
-						}
+					for (pixelCounter = 0; pixelCounter < 2; pixelCounter++) {
 					
-						spritePixelIndex += spritePixelIncrement;
+						// Lower-indexed sprites have already claimed their pixels
+						newSpritePixels = spriteRowMask[pixelCounter] & ~spriteOpacityMask[maskWord + pixelCounter];
+						if (!newSpritePixels) continue;
+						
+						spriteOpacityMask[maskWord + pixelCounter] |= newSpritePixels;
+						if (spriteAttributes & 0x20) spriteBehindMask[maskWord + pixelCounter] |= newSpritePixels;
+						
+						while (newSpritePixels) {
+						
+							pixel = ((maskWord + pixelCounter) * 64) + __builtin_ctzll(newSpritePixels);
+							spriteLineBuffer[pixel] = ((spriteLowerPlane >> (pixel - spriteHorizontalOffset)) & 0x1) | (((spriteUpperPlane >> (pixel - spriteHorizontalOffset)) & 0x1) << 1) | spriteUpperColorBits;
+							newSpritePixels &= newSpritePixels - 1;
+						}
 					}
 				}
-			}
-		}
-
-		if (_sprite0Hit) {
-			
-			if ((scanlineStartingCycle <= _sprite0HitCycle) && (scanlineEndingCycle > _sprite0HitCycle)) {
 				
-				_ppuStatusRegister |= 0x40;
-				_sprite0Hit = NO; // Reset internal sprite 0 hit flag
+				// Merge with the background: sprite pixels win unless they are behind an opaque background pixel
+				for (maskWord = 0; maskWord < 4; maskWord++) {
+					
+					composeSpritePixels(_videoBuffer + (_videoBufferIndex - 256), spriteLineBuffer, _spritePalette, colorTable, spriteOpacityMask[maskWord] & ~(spriteBehindMask[maskWord] & bgOpacityMask[maskWord]), maskWord * 64);
+				}
 			}
+			
+			if (_validatesLogicOnlyRendering) [self _checkLogicOnlyPredictionForScanline:currentScanline];
 		}
+
+		if (_sprite0Hit) [self _reportSprite0HitOnScanline:currentScanline fromCycle:scanlineStartingCycle toCycle:scanlineEndingCycle];
 		
 		if (_backgroundEnabled || _spritesEnabled) {
 
@@ -654,6 +2142,12 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 				// On cycle 257, reset horizontal components of VRAM address
 				_VRAMAddress &= 0xFBE0; // clear bit 10 and horizontal scroll
 				_VRAMAddress |= _temporaryVRAMAddress & 0x041F; // OR in those bits from the temporary address
+				if (_hooks[NESPPUA12RiseHook].function != NULL) _a12RiseDot = a12RiseDotForSpriteFetches(_ppuControlRegister1, _sprRAM, _spritesOnCurrentScanline, _numberOfSpritesOnScanline);
+			}
+			
+			if (_a12RiseDot && (scanlineStartingCycle <= _a12RiseDot) && (scanlineEndingCycle > _a12RiseDot)) {
+				
+				callPPUHook(_hooks + NESPPUA12RiseHook, &_hookState, _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, _cyclesSinceVINT - scanlineStartingCycle + _a12RiseDot);
 			}
 			
 			if ((scanlineStartingCycle <= 319) && (scanlineEndingCycle > 319)) {
@@ -676,11 +2170,26 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 
 - (void)resetCPUCycleCounter {
 
+	NESPPUTimingEvent *completedTimingEvents;
+	
+	if (_recordsTimingEvents) {
+		
+		completedTimingEvents = _completedTimingEvents;
+		_completedTimingEvents = _timingEvents;
+		_timingEvents = completedTimingEvents;
+		_numberOfCompletedTimingEvents = _numberOfTimingEvents;
+		_numberOfTimingEvents = 0;
+	}
+	
+	if (_deferredRendering) [self _logEvent:NESPPUFrameEndEvent address:0 value:0 argument:0 onCycle:_lastCPUCycle];
+	
 	_frameEnded = NO;
 	_lastCPUCycle = 0;
 	_lastCycleOverage = _cyclesSinceVINT;
 	// NSLog(@"PPU will start on cycle %d this frame.",_lastCycleOverage);
-	[self _notifyStateObserver];
+	callPPUHook(_hooks + NESPPUFrameEndHook, &_hookState, _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, _cyclesSinceVINT);
+	
+	if (_deferredRendering) [self _submitDeferredFrame];
 }
 
 - (BOOL)triggeredNMI {
@@ -702,6 +2211,7 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 		if ((scanlineStartingCycle <= 257) && (scanlineEndingCycle > 257)) {
 
 			[self _findInRangeSprites:0];
+			_a12RiseDot = (_hooks[NESPPUA12RiseHook].function != NULL) ? a12RiseDotForSpriteFetches(_ppuControlRegister1, _sprRAM, _spritesOnCurrentScanline, _numberOfSpritesOnScanline) : 0;
 			// FIXME: Should vertical reset occur as well?
 			// FIXME: Should Horizontal reset occur at all?
 			// _VRAMAddress &= 0xFBE0; // clear bit 10 and horizontal scroll
@@ -715,6 +2225,11 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 			_VRAMAddress = _temporaryVRAMAddress;
 		}
 		
+		if (_a12RiseDot && (scanlineStartingCycle <= _a12RiseDot) && (scanlineEndingCycle > _a12RiseDot)) {
+			
+			callPPUHook(_hooks + NESPPUA12RiseHook, &_hookState, _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, CYCLES_OF_VBLANK + _a12RiseDot);
+		}
+		
 		if ((scanlineStartingCycle <= 319) && (scanlineEndingCycle > 319)) {
 			
 			// First two tile accesses occur on cycles 319 and 327, respectively
@@ -808,7 +2323,11 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	else if (effectiveAddress >= 0x2000) {
 		
 		// Name or attribute table write
-		_nameAndAttributeTables[_nameTableMirroring(effectiveAddress)] = byte;
+		if (_nameTablePageIsWritable[(effectiveAddress >> 10) & 0x3]) {
+			
+			_nameTablePages[(effectiveAddress >> 10) & 0x3][effectiveAddress & 0x3FF] = byte;
+			[self _updateBackgroundTilesForNameTableAddress:effectiveAddress];
+		}
 	}
 	else {
 	
@@ -822,12 +2341,20 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 
 - (uint8_t)readByteFromCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle
 {	
-	return _registerReadMethods[address & 0x7](self,@selector(_invalidPPURegisterAccessOnCycle:),cycle);
+	uint8_t value = _registerReadMethods[address & 0x7](self,@selector(_invalidPPURegisterAccessOnCycle:),cycle);
+	
+	// Only $2002 and $2007 reads change PPU state
+	if (_deferredRendering && ((address & 0x7) == 0x2 || (address & 0x7) == 0x7)) [self _logEvent:NESPPURegisterReadEvent address:address value:0 argument:0 onCycle:cycle];
+	
+	return value;
 }
 
 - (void)writeByte:(uint8_t)byte toPPUFromCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle
 {	
 	_registerWriteMethods[address & 0x7](self,@selector(_invalidPPURegisterWriteWithByte:onCycle:),byte,cycle);
+	
+	if (_recordsTimingEvents) [self _recordTimingEvent:NESPPUTimingRegisterWrite onCycle:cycle address:address & 0x7 value:byte];
+	if (_deferredRendering) [self _logEvent:NESPPURegisterWriteEvent address:address value:byte argument:0 onCycle:cycle];
 }
 
 // 0x2000
@@ -846,7 +2373,7 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	_8x16Sprites = (_ppuControlRegister1 & 0x20) ? YES : NO;
 	_NMIOnVBlank = (_ppuControlRegister1 & 0x80) ? YES : NO;
 	
-	if (_stateObservingInvocation != nil) [self _notifyStateObserver];
+	callPPUHook(_hooks + NESPPUControlChangedHook, &_hookState, _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, _cyclesSinceVINT);
 }
 
 // 0x2001
@@ -864,8 +2391,9 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	_backgroundEnabled = _ppuControlRegister2 & 0x8 ? YES : NO;
 	_spritesEnabled = _ppuControlRegister2 & 0x10 ? YES : NO;
 	_colorIntensity = _ppuControlRegister2 & 0xE0; // Top three bits are color intensity
+	_colorTable = _colorTables + ((((_colorIntensity >> 5) * 2) | _monochrome) * 64);
 	
-	if (_stateObservingInvocation != nil) [self _notifyStateObserver];
+	callPPUHook(_hooks + NESPPUControlChangedHook, &_hookState, _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, _cyclesSinceVINT);
 }
 
 // 2005
@@ -951,12 +2479,12 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	else if (effectiveAddress < 0x3F00) { 
 		
 		// Name or Attribute Table Read
-		_bufferedVRAMRead = _nameAndAttributeTables[_nameTableMirroring(effectiveAddress)];
+		_bufferedVRAMRead = _nameTablePages[(effectiveAddress >> 10) & 0x3][effectiveAddress & 0x3FF];
 	}
 	else { 
 		
 		// Palette Read (Unbuffered)
-		_bufferedVRAMRead = _nameAndAttributeTables[_nameTableMirroring(effectiveAddress)]; // 0x3000 mirrors 0x2000
+		_bufferedVRAMRead = _nameTablePages[(effectiveAddress >> 10) & 0x3][effectiveAddress & 0x3FF]; // 0x3000 mirrors 0x2000
 		valueToReturn = _palettes[effectiveAddress & 0x1F]; // modulo 32 as there are 32 entries
 	}
 	
@@ -986,6 +2514,9 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	
 		_sprRAM[sprRAMIndex++] = bytes[copyIndex];
 	}
+	
+	if (_recordsTimingEvents) [self _recordTimingEvent:NESPPUTimingOAMDMA onCycle:cycle address:0 value:_sprRAMAddress];
+	if (_deferredRendering) [self _logEvent:NESPPUOAMDMAEvent address:0 value:0 argument:appendDataToLog(_recordingLog,bytes,256) onCycle:cycle];
 	// FIXME: This is incrementing the SPRRAM address. I'm not entirely sure that's correct.
 }
 
@@ -1061,23 +2592,319 @@ static uint16_t applySingleScreenUpperMirroring(uint16_t vramAddress) {
 	return (remainingCycles / 3) + ((remainingCycles % 3) == 0 ? 0 : 1); 
 }
 
-- (void)observeStateForTarget:(id)target andSelector:(SEL)selector
+/* setHook:function:context:
+ * Registers a C function the PPU calls when the given event occurs, passing the context back along with the PPU
+ * registers and the cycle since VINT it happened on. A NULL function removes the hook; unregistered hooks cost a
+ * single branch.
+ */
+- (void)setHook:(NESPPUHookType)type function:(NESPPUHookFunction)function context:(void *)context
+{
+	_hooks[type].function = function;
+	_hooks[type].context = function != NULL ? context : NULL;
+	if ((type == NESPPUA12RiseHook) && (function == NULL)) _a12RiseDot = 0;
+}
+
+@end
+
+typedef enum {
+	
+	NESDotIdle = 0,
+	NESDotShift,
+	NESDotFetchNameTable,
+	NESDotFetchAttribute,
+	NESDotFetchLowPlane,
+	NESDotFetchHighPlane,
+	NESDotIncrementHorizontally,
+	NESDotIncrementVertically,
+	NESDotTransferHorizontally,
+	NESDotTransferVertically
+} NESDotAction;
+
+static uint8_t dotActions[CYCLES_IN_SCANLINE_NORMAL];
+static uint8_t idleDotsFollowing[CYCLES_IN_SCANLINE_NORMAL];
+
+@implementation NESDotPPUEmulator
+
+/* initialize
+ * Builds the per-dot action table the core switches on. Background fetches repeat every 8 dots through 1-256 and
+ * 321-336, with shifting on dots 2-257 and 322-337. Dot 256 increments vertically, 257 copies the horizontal scroll
+ * and evaluates sprites, and on the priming line 280-304 copy the vertical scroll. Runs of idle dots are recorded so
+ * they can be skipped in one step.
+ */
++ (void)initialize
+{
+	uint_fast32_t dot;
+	
+	if (self != [NESDotPPUEmulator class]) return;
+	
+	for (dot = 0; dot < CYCLES_IN_SCANLINE_NORMAL; dot++) {
+		
+		if (((dot >= 2) && (dot < 258)) || ((dot >= 321) && (dot < 338))) {
+			
+			switch ((dot - 1) % 8) {
+					
+				case 0:
+					dotActions[dot] = NESDotFetchNameTable;
+					break;
+				case 2:
+					dotActions[dot] = NESDotFetchAttribute;
+					break;
+				case 4:
+					dotActions[dot] = NESDotFetchLowPlane;
+					break;
+				case 6:
+					dotActions[dot] = NESDotFetchHighPlane;
+					break;
+				case 7:
+					dotActions[dot] = NESDotIncrementHorizontally;
+					break;
+				default:
+					dotActions[dot] = NESDotShift;
+					break;
+			}
+		}
+		else dotActions[dot] = NESDotIdle;
+		
+		if ((dot >= 280) && (dot <= 304)) dotActions[dot] = NESDotTransferVertically;
+	}
+	
+	dotActions[256] = NESDotIncrementVertically;
+	dotActions[257] = NESDotTransferHorizontally;
+	
+	for (dot = CYCLES_IN_SCANLINE_NORMAL; dot > 0; dot--) {
+		
+		idleDotsFollowing[dot - 1] = (dotActions[dot - 1] == NESDotIdle) ? ((dot < CYCLES_IN_SCANLINE_NORMAL) ? idleDotsFollowing[dot] : 0) + 1 : 0;
+	}
+}
+
+// Every dot is emulated in order on the CPU's thread, so there is no log to hand to another renderer
+- (BOOL)setDeferredRendering:(BOOL)flag
+{
+	if (!flag) return YES;
+	
+	NSLog(@"The dot-accurate PPU renders synchronously, deferred rendering is off.");
+	return NO;
+}
+
+/* Per-dot work
+ * Called straight from the action switch in _runDotsOnScanline:fromDot:toDot: rather than messaged, since each runs
+ * on nearly every dot of a visible line.
+ */
+static inline void shiftBackground(NESDotPPUEmulator *ppu)
+{
+	ppu->_patternLowShifter <<= 1;
+	ppu->_patternHighShifter <<= 1;
+	ppu->_attributeLowShifter <<= 1;
+	ppu->_attributeHighShifter <<= 1;
+}
+
+static inline void loadShifters(NESDotPPUEmulator *ppu)
+{
+	ppu->_patternLowShifter = (ppu->_patternLowShifter & 0xFF00) | ppu->_nextTileLowPlane;
+	ppu->_patternHighShifter = (ppu->_patternHighShifter & 0xFF00) | ppu->_nextTileHighPlane;
+	ppu->_attributeLowShifter = (ppu->_attributeLowShifter & 0xFF00) | ((ppu->_nextTileAttribute & 0x1) ? 0xFF : 0x00);
+	ppu->_attributeHighShifter = (ppu->_attributeHighShifter & 0xFF00) | ((ppu->_nextTileAttribute & 0x2) ? 0xFF : 0x00);
+}
+
+static inline uint8_t fetchBackgroundPatternPlane(NESDotPPUEmulator *ppu, uint_fast32_t plane)
+{
+	uint_fast32_t patternAddress = (ppu->_nextTileIndex * 16) + ((ppu->_VRAMAddress >> 12) & 0x7);
+	
+	return ppu->_chrrom[(ppu->_chrromBankIndices[ppu->_backgroundTileCacheIndex + (patternAddress / CHRROM_BANK_SIZE)] * CHRROM_BANK_SIZE) + (patternAddress & (CHRROM_BANK_SIZE - 1)) + plane];
+}
+
+// Dot pixel + 1 outputs from the shifters as they stand after that dot's shift
+static inline void outputPixel(NESDotPPUEmulator *ppu, uint_fast32_t pixel, uint_fast32_t scanline)
+{
+	uint16_t multiplexer = 0x8000 >> ppu->_fineHorizontalScroll;
+	uint_fast8_t backgroundPixel = 0;
+	uint_fast8_t spritePixel = 0;
+	uint_fast8_t spriteCounter;
+	uint_fast32_t spriteColumn;
+	BOOL spriteBehind = NO;
+	BOOL sprite0Pixel = NO;
+	
+	if (ppu->_backgroundEnabled && !(ppu->_clipBackground && (pixel < 8))) {
+		
+		backgroundPixel = ((ppu->_patternLowShifter & multiplexer) ? 0x1 : 0) | ((ppu->_patternHighShifter & multiplexer) ? 0x2 : 0);
+		if (backgroundPixel) backgroundPixel |= ((ppu->_attributeLowShifter & multiplexer) ? 0x4 : 0) | ((ppu->_attributeHighShifter & multiplexer) ? 0x8 : 0);
+	}
+	
+	if (ppu->_spritesEnabled && !(ppu->_clipSprites && (pixel < 8))) {
+		
+		for (spriteCounter = 0; spriteCounter < ppu->_numberOfLineSprites; spriteCounter++) {
+			
+			spriteColumn = pixel - ppu->_lineSpriteHorizontalOffsets[spriteCounter];
+			if (spriteColumn > 7) continue;
+			
+			spritePixel = ((ppu->_lineSpriteLowPlanes[spriteCounter] >> spriteColumn) & 0x1) | (((ppu->_lineSpriteHighPlanes[spriteCounter] >> spriteColumn) & 0x1) << 1);
+			
+			if (spritePixel) {
+				
+				spritePixel |= 0x10 | ((ppu->_lineSpriteAttributes[spriteCounter] & 0x3) << 2);
+				spriteBehind = (ppu->_lineSpriteAttributes[spriteCounter] & 0x20) != 0;
+				sprite0Pixel = (spriteCounter == 0) && ppu->_sprite0OnLine;
+				break;
+			}
+		}
+	}
+	
+	// The hit lands on the exact dot both opaque pixels meet; like the scanline engine, only a line's first one counts and
+	// it is reported through _reportSprite0HitOnScanline:fromCycle:toCycle:
+	if (sprite0Pixel && backgroundPixel && (pixel != 255) && ppu->_backgroundEnabled && ppu->_spritesEnabled) {
+		
+		ppu->_sprite0OnLine = NO;
+		ppu->_sprite0Hit = YES;
+		ppu->_sprite0HitCycle = pixel;
+	}
+	
+	if (ppu->_rendersOutput) ppu->_videoBuffer[(scanline * 256) + pixel] = ppu->_colorTable[ppu->_palettes[(spritePixel && (!spriteBehind || !backgroundPixel)) ? spritePixel : backgroundPixel]];
+}
+
+// Sprite rows are fetched all at once on dot 257, for the line that follows
+- (void)_fetchSpritesForScanline:(uint_fast8_t)scanline
+{
+	uint_fast8_t spriteCounter;
+	
+	[self _findInRangeSprites:scanline];
+	
+	_sprite0OnLine = _numberOfSpritesOnScanline && (_spritesOnCurrentScanline[0] == 0);
+	_numberOfLineSprites = _numberOfSpritesOnScanline;
+	
+	for (spriteCounter = 0; spriteCounter < _numberOfLineSprites; spriteCounter++) {
+		
+		fetchSpriteRow(_sprRAM + _spritesOnCurrentScanline[spriteCounter], scanline, _8x16Sprites, _spriteTileCacheIndex, _chrromBankIndices, _chrrom, _lineSpriteLowPlanes + spriteCounter, _lineSpriteHighPlanes + spriteCounter);
+		_lineSpriteHorizontalOffsets[spriteCounter] = _sprRAM[_spritesOnCurrentScanline[spriteCounter] + 3];
+		_lineSpriteAttributes[spriteCounter] = _sprRAM[_spritesOnCurrentScanline[spriteCounter] + 2];
+	}
+}
+
+/* _runDotsOnScanline:fromDot:toDot:
+ * The core loop, with scanline -1 being the priming scanline. Each dot dispatches through the action table, idle
+ * dots are skipped in runs and a line with rendering disabled only emits backdrop pixels.
+ */
+- (void)_runDotsOnScanline:(int_fast32_t)scanline fromDot:(uint_fast32_t)dot toDot:(uint_fast32_t)lastDot
 {
-	NSMethodSignature *signature;
+	uint_fast32_t lineStartingCycle = _cyclesSinceVINT - dot;
+	uint_fast32_t attributeShift;
+	uint_fast32_t backdrop;
+	uint8_t *nameTable;
+	
+	if (dot == 0) {
+		
+		_a12RiseDot = 0;
+		if (scanline >= 0) callPPUHook(_hooks + NESPPUScanlineStartHook, &_hookState, _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, _cyclesSinceVINT);
+	}
+	
+	if (!(_backgroundEnabled || _spritesEnabled)) {
+		
+		if ((scanline >= 0) && _rendersOutput) {
+			
+			// With rendering off the backdrop is the palette entry the VRAM address points at, if it points into the palettes
+			backdrop = _colorTable[_palettes[((_VRAMAddress & 0x3F00) == 0x3F00) ? (_VRAMAddress & 0x1F) : 0]];
+			for (; (dot < lastDot) && (dot <= 256); dot++) if (dot) _videoBuffer[(scanline * 256) + dot - 1] = backdrop;
+		}
+		
+		return;
+	}
+	
+	while (dot < lastDot) {
+		
+		if (_a12RiseDot && (dot == _a12RiseDot)) callPPUHook(_hooks + NESPPUA12RiseHook, &_hookState, _ppuControlRegister1, _ppuControlRegister2, _ppuStatusRegister, lineStartingCycle + dot);
+		
+		switch (dotActions[dot]) {
+				
+			case NESDotIdle:
+				// Nothing happens until the next action, so step over the whole run, stopping at an A12 rise
+				if ((scanline < 0) || (dot > 256)) {
+					
+					dot = ((_a12RiseDot > dot) && (_a12RiseDot < (dot + idleDotsFollowing[dot]))) ? _a12RiseDot : dot + idleDotsFollowing[dot];
+					continue;
+				}
+				break;
+			case NESDotShift:
+				shiftBackground(self);
+				break;
+			case NESDotFetchNameTable:
+				shiftBackground(self);
+				loadShifters(self);
+				_nextTileIndex = _nameTablePages[(_VRAMAddress >> 10) & 0x3][_VRAMAddress & 0x3FF];
+				break;
+			case NESDotFetchAttribute:
+				shiftBackground(self);
+				nameTable = _nameTablePages[(_VRAMAddress >> 10) & 0x3];
+				attributeShift = ((_VRAMAddress >> 4) & 0x4) | (_VRAMAddress & 0x2);
+				_nextTileAttribute = (nameTable[0x3C0 | ((_VRAMAddress >> 4) & 0x38) | ((_VRAMAddress >> 2) & 0x07)] >> attributeShift) & 0x3;
+				break;
+			case NESDotFetchLowPlane:
+				shiftBackground(self);
+				_nextTileLowPlane = fetchBackgroundPatternPlane(self, 0);
+				break;
+			case NESDotFetchHighPlane:
+				shiftBackground(self);
+				_nextTileHighPlane = fetchBackgroundPatternPlane(self, 8);
+				break;
+			case NESDotIncrementHorizontally:
+				shiftBackground(self);
+				incrementVRAMAddressHorizontally(&_VRAMAddress);
+				break;
+			case NESDotIncrementVertically:
+				shiftBackground(self);
+				incrementVRAMAddressHorizontally(&_VRAMAddress);
+				incrementVRAMAddressVertically(&_VRAMAddress);
+				break;
+			case NESDotTransferHorizontally:
+				shiftBackground(self);
+				loadShifters(self);
+				_VRAMAddress = (_VRAMAddress & 0xFBE0) | (_temporaryVRAMAddress & 0x041F);
+				[self _fetchSpritesForScanline:scanline + 1];
+				if (_hooks[NESPPUA12RiseHook].function != NULL) _a12RiseDot = a12RiseDotForSpriteFetches(_ppuControlRegister1, _sprRAM, _spritesOnCurrentScanline, _numberOfSpritesOnScanline);
+				break;
+			case NESDotTransferVertically:
+				if (scanline < 0) _VRAMAddress = (_VRAMAddress & 0x841F) | (_temporaryVRAMAddress & 0x7BE0);
+				break;
+		}
 		
-	if (_stateObservingInvocation != nil) {
+		// After this dot's shift, so dot 1 shows the tile's first pixel and dot 2 its second
+		if ((scanline >= 0) && (dot >= 1) && (dot <= 256)) {
+			
+			outputPixel(self, dot - 1, scanline);
+			if (_sprite0Hit) [self _reportSprite0HitOnScanline:scanline fromCycle:dot - 1 toCycle:dot];
+		}
 		
-		[_stateObservingInvocation release];
-		_stateObservingInvocation = nil;
+		dot++;
 	}
+}
+
+- (BOOL)completePrimingScanlineStoppingOnCycle:(uint_fast32_t)cycle
+{
+	uint_fast32_t scanlineStartingCycle = _cyclesSinceVINT - CYCLES_OF_VBLANK;
+	uint_fast32_t scanlineEndingCycle = (cycle >= (_shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL)) ? (_shortenPrimingScanline ? CYCLES_IN_SCANLINE_SHORT : CYCLES_IN_SCANLINE_NORMAL) : cycle - _cyclesSinceVINT + scanlineStartingCycle;
+	
+	[self _runDotsOnScanline:-1 fromDot:scanlineStartingCycle toDot:scanlineEndingCycle];
+	
+	_cyclesSinceVINT += scanlineEndingCycle - scanlineStartingCycle;
+	
+	return _cyclesSinceVINT == (_shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL);
+}
+
+- (void)_drawScanlinesStoppingOnCycle:(uint_fast32_t)endingCycle
+{
+	uint_fast32_t cyclesPastPrimingScanline, scanlineStartingCycle, scanlineEndingCycle, scanline;
 	
-	if (target != nil) {
+	while ((endingCycle > _cyclesSinceVINT) && (_cyclesSinceVINT < (_shortenPrimingScanline ? 89000 : 89001))) {
+		
+		cyclesPastPrimingScanline = _cyclesSinceVINT - (_shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL);
+		scanlineStartingCycle = cyclesPastPrimingScanline % CYCLES_IN_SCANLINE_NORMAL;
+		scanlineEndingCycle = (_cyclesSinceVINT + (CYCLES_IN_SCANLINE_NORMAL - scanlineStartingCycle)) <= endingCycle ? CYCLES_IN_SCANLINE_NORMAL : endingCycle - _cyclesSinceVINT + scanlineStartingCycle;
+		scanline = cyclesPastPrimingScanline / CYCLES_IN_SCANLINE_NORMAL;
+		
+		[self _runDotsOnScanline:scanline fromDot:scanlineStartingCycle toDot:scanlineEndingCycle];
 		
-		signature = [target methodSignatureForSelector:selector];
-		_stateObservingInvocation = [[NSInvocation invocationWithMethodSignature:signature] retain];
-		[_stateObservingInvocation setTarget:target];
-		[_stateObservingInvocation setSelector:selector];
-		[_stateObservingInvocation setArgument:&_observerState atIndex:2];
+		// Only lines whose visible dots just ran were drawn
+		if (_rendersOutput && (scanline < 240) && (scanlineStartingCycle <= 256) && (scanlineEndingCycle > 1)) _changedScanlines[scanline / 64] |= 1ULL << (scanline % 64);
+		
+		_cyclesSinceVINT += scanlineEndingCycle - scanlineStartingCycle;
 	}
 }
 
@@ -43,5 +43,6 @@
 - (uint_fast32_t *)videoBuffer;
 - (void)scaleForFullScreenDrawingWithWidth:(size_t)width height:(size_t)height;
 - (void)scaleForWindowedDrawing;
+- (void)setNeedsDisplayForScanlines:(uint64_t *)scanlines;
 
 @end
@@ -122,6 +122,27 @@ void VideoBufferProviderReleaseData(void *info, const void *data, size_t size)
 	CGDisplayShowCursor(kCGNullDirectDisplay);
 }
 
+// Invalidates only the rows spanning the given 256-bit scanline mask
+- (void)setNeedsDisplayForScanlines:(uint64_t *)scanlines
+{
+	uint_fast32_t firstScanline = 240;
+	uint_fast32_t lastScanline = 0;
+	uint_fast32_t maskWord;
+	
+	for (maskWord = 0; maskWord < 4; maskWord++) {
+		
+		if (!scanlines[maskWord]) continue;
+		if (firstScanline == 240) firstScanline = (maskWord * 64) + __builtin_ctzll(scanlines[maskWord]);
+		lastScanline = (maskWord * 64) + 63 - __builtin_clzll(scanlines[maskWord]);
+	}
+	
+	if (firstScanline == 240) return;
+	if (lastScanline > 239) lastScanline = 239;
+	
+	// Scanline 0 is at the top of the image, and the view's origin is at the bottom
+	[self setNeedsDisplayInRect:NSMakeRect(screenRect->origin.x * _scale, (screenRect->origin.y + 239 - lastScanline) * _scale, screenRect->size.width * _scale, (lastScanline - firstScanline + 1) * _scale)];
+}
+
 - (void)drawRect:(NSRect)rect {
     
 	CGContextRef context = [[NSGraphicsContext currentContext] graphicsPort]; // Obtain graphics port from the window
@@ -0,0 +1,51 @@
+/* NESROMImage.h
+ * 
+ * Copyright (c) 2010 Auston Stewart
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/* NESROMImage
+ * A ROM file mapped read-only into memory. Images are shared through a process-wide registry keyed by path, so every
+ * emulator instance running the same file references the same pages. Callers check an image out, point their PRGROM and
+ * CHRROM at its bytes and check it back in when done; the mapping is removed once the last user has checked in.
+ */
+@interface NESROMImage : NSObject {
+
+	NSString *_path;
+	uint8_t *_bytes;
+	size_t _length;
+	dev_t _device;
+	ino_t _inode;
+	struct timespec _modificationTime;
+	uint_fast32_t _users;
+	uint8_t *_decodedTiles;
+}
+
++ (NESROMImage *)checkOutImageAtPath:(NSString *)path error:(NSError **)error;
++ (uint_fast32_t)numberOfMappedImages;
+- (void)checkIn;
+- (const uint8_t *)bytes;
+- (size_t)length;
+- (uint_fast32_t)users;
+- (uint8_t *)decodedTilesForCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size;
+
+@end
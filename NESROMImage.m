@@ -0,0 +1,169 @@
+/* NESROMImage.m
+ * 
+ * Copyright (c) 2010 Auston Stewart
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#import "NESROMImage.h"
+#import "NESPPUEmulator.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static NSMutableDictionary *mappedImages = nil;
+
+@implementation NESROMImage
+
+- (BOOL)_matchesFileStatus:(const struct stat *)status
+{
+	return (status->st_dev == _device) && (status->st_ino == _inode) && ((size_t)status->st_size == _length) && (status->st_mtimespec.tv_sec == _modificationTime.tv_sec) && (status->st_mtimespec.tv_nsec == _modificationTime.tv_nsec);
+}
+
+- (id)_initWithPath:(NSString *)path fileDescriptor:(int)descriptor status:(const struct stat *)status
+{
+	void *mapping;
+	
+	[super init];
+	
+	// MAP_PRIVATE, so a stray write can never reach the file; pages stay shared until something writes them
+	mapping = mmap(NULL,(size_t)status->st_size,PROT_READ,MAP_PRIVATE,descriptor,0);
+	if (mapping == MAP_FAILED) {
+	
+		[self release];
+		return nil;
+	}
+	
+	_path = [path copy];
+	_bytes = (uint8_t *)mapping;
+	_length = (size_t)status->st_size;
+	_device = status->st_dev;
+	_inode = status->st_ino;
+	_modificationTime = status->st_mtimespec;
+	_users = 0;
+	_decodedTiles = NULL;
+	
+	return self;
+}
+
+- (void)dealloc
+{
+	free(_decodedTiles);
+	if (_bytes != NULL) munmap(_bytes,_length);
+	[_path release];
+	
+	[super dealloc];
+}
+
+/* checkOutImageAtPath:error:
+ * Returns the registered mapping of the file if it is unchanged on disk, otherwise maps it afresh. A file replaced while
+ * mapped gets a new image; users of the old one keep it until they check in.
+ */
++ (NESROMImage *)checkOutImageAtPath:(NSString *)path error:(NSError **)error
+{
+	NSString *key = [path stringByStandardizingPath];
+	NESROMImage *image;
+	struct stat status;
+	int descriptor;
+	
+	@synchronized(self) {
+	
+		if (mappedImages == nil) mappedImages = [[NSMutableDictionary alloc] init];
+		
+		descriptor = open([key fileSystemRepresentation],O_RDONLY);
+		if ((descriptor < 0) || (fstat(descriptor,&status) != 0) || (status.st_size == 0)) {
+			
+			if (descriptor >= 0) close(descriptor);
+			if (error) *error = [NSError errorWithDomain:@"NESFileErrorDomain" code:1 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"File could not be opened.",NSLocalizedDescriptionKey,@"Macifom was unable to open the file selected.",NSLocalizedRecoverySuggestionErrorKey,path,NSFilePathErrorKey,nil]];
+			return nil;
+		}
+		
+		image = [mappedImages objectForKey:key];
+		if ((image == nil) || ![image _matchesFileStatus:&status]) {
+		
+			image = [[[NESROMImage alloc] _initWithPath:key fileDescriptor:descriptor status:&status] autorelease];
+			if (image == nil) {
+			
+				close(descriptor);
+				if (error) *error = [NSError errorWithDomain:@"NESFileErrorDomain" code:1 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"File could not be mapped.",NSLocalizedDescriptionKey,@"Macifom was unable to map the file selected into memory.",NSLocalizedRecoverySuggestionErrorKey,path,NSFilePathErrorKey,nil]];
+				return nil;
+			}
+			
+			[mappedImages setObject:image forKey:key];
+		}
+		
+		close(descriptor); // The mapping holds its own reference to the file
+		
+		[image retain];
+		image->_users++;
+	}
+	
+	return image;
+}
+
++ (uint_fast32_t)numberOfMappedImages
+{
+	uint_fast32_t count;
+	
+	@synchronized(self) {
+	
+		count = [mappedImages count];
+	}
+	
+	return count;
+}
+
+- (void)checkIn
+{
+	@synchronized([NESROMImage class]) {
+	
+		// Drop the registry's reference with the last user, unless the file has since been mapped again under this path
+		if ((--_users == 0) && ([mappedImages objectForKey:_path] == self)) [mappedImages removeObjectForKey:_path];
+		[self release];
+	}
+}
+
+- (const uint8_t *)bytes
+{
+	return _bytes;
+}
+
+- (size_t)length
+{
+	return _length;
+}
+
+- (uint_fast32_t)users
+{
+	return _users;
+}
+
+// CHRROM in the image is decoded once, on first use, and the tiles are shared by every PPU rendering it
+- (uint8_t *)decodedTilesForCHRROM:(uint8_t *)chrrom length:(uint_fast32_t)size
+{
+	@synchronized(self) {
+	
+		if (_decodedTiles == NULL) _decodedTiles = [NESPPUEmulator newTileCacheForCHRROM:chrrom length:size];
+	}
+	
+	return _decodedTiles;
+}
+
+@end
@@ -0,0 +1,271 @@
+/*
+ *  NESResampler.h
+ *
+ * Copyright (c) 2010 Auston Stewart
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef NESRESAMPLER_H
+#define NESRESAMPLER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE__) && !defined(NES_RESAMPLER_SCALAR)
+#include <xmmintrin.h>
+#define NES_RESAMPLER_SSE 1
+#endif
+
+#define NES_RESAMPLER_TAPS 48 // Per output sample, a multiple of eight
+#define NES_RESAMPLER_PHASES 128 // Filter phases between input samples, interpolated linearly
+#define NES_RESAMPLER_INPUT_CAPACITY 2048 // Input samples buffered, including the filter's history
+#define NES_RESAMPLER_PASSBAND 0.91 // Cutoff as a fraction of the lower Nyquist frequency
+#define NES_RESAMPLER_KAISER_BETA 7.5
+
+/* NESResampler
+ * Polyphase windowed-sinc resampler from Blip_Buffer's synthesis rate to the device's. The phase table is designed once
+ * for the nominal ratio; the step through the input is a double that may be nudged on every call, which moves where the
+ * next output lands without any discontinuity, so the pacing controller can steer it frame by frame.
+ */
+typedef struct {
+
+	float *coefficients; // NES_RESAMPLER_PHASES + 1 rows of NES_RESAMPLER_TAPS, the last row phase 0 a tap later
+	float *input; // NES_RESAMPLER_INPUT_CAPACITY samples, oldest first
+	uint32_t inputCount;
+	double position; // Input index of the next output's first tap, with its fractional phase
+	double nominalStep; // Input samples per output sample
+	double step;
+
+} NESResampler;
+
+static inline double NESResamplerBesselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+
+	for (k = 1; k < 32; k++) {
+
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+
+	return sum;
+}
+
+static inline void NESResamplerReset(NESResampler *resampler)
+{
+	// Half the taps of silence put the first output on the first input sample
+	memset(resampler->input,0,sizeof(float) * NES_RESAMPLER_INPUT_CAPACITY);
+	resampler->inputCount = NES_RESAMPLER_TAPS / 2;
+	resampler->position = 1.0;
+}
+
+static inline NESResampler *NESResamplerCreate(long inputRate, long outputRate)
+{
+	NESResampler *resampler = (NESResampler *)calloc(1,sizeof(NESResampler));
+	double cutoff = 0.5 * NES_RESAMPLER_PASSBAND * ((outputRate < inputRate) ? (double)outputRate / inputRate : 1.0); // Cycles per input sample
+	double halfWidth = NES_RESAMPLER_TAPS / 2;
+	double t, x, sum;
+	float *row;
+	int phase, tap;
+
+	if (resampler == NULL) return NULL;
+	if ((posix_memalign((void **)&resampler->coefficients,16,sizeof(float) * (NES_RESAMPLER_PHASES + 1) * NES_RESAMPLER_TAPS) != 0) ||
+		(posix_memalign((void **)&resampler->input,16,sizeof(float) * NES_RESAMPLER_INPUT_CAPACITY) != 0)) {
+
+		free(resampler->coefficients);
+		free(resampler);
+		return NULL;
+	}
+
+	// Tap k of phase p weighs the input sample (k - (taps / 2 - 1) - p / phases) samples from the output instant
+	for (phase = 0; phase <= NES_RESAMPLER_PHASES; phase++) {
+
+		row = resampler->coefficients + (phase * NES_RESAMPLER_TAPS);
+		sum = 0.0;
+
+		for (tap = 0; tap < NES_RESAMPLER_TAPS; tap++) {
+
+			t = tap - (halfWidth - 1.0) - ((double)phase / NES_RESAMPLER_PHASES);
+			x = t / halfWidth;
+			row[tap] = (float)(((t == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * t) / (M_PI * t)) *
+							   ((x <= -1.0 || x >= 1.0) ? 0.0 : NESResamplerBesselI0(NES_RESAMPLER_KAISER_BETA * sqrt(1.0 - (x * x))) / NESResamplerBesselI0(NES_RESAMPLER_KAISER_BETA)));
+			sum += row[tap];
+		}
+
+		// Unity gain at DC for every phase, so steady levels don't ripple as the phase moves
+		for (tap = 0; tap < NES_RESAMPLER_TAPS; tap++) row[tap] = (float)(row[tap] / sum);
+	}
+
+	resampler->nominalStep = resampler->step = (double)inputRate / outputRate;
+	NESResamplerReset(resampler);
+
+	return resampler;
+}
+
+static inline void NESResamplerDestroy(NESResampler *resampler)
+{
+	if (resampler == NULL) return;
+	free(resampler->coefficients);
+	free(resampler->input);
+	free(resampler);
+}
+
+// Fractional change to the nominal ratio, positive for fewer output samples; takes effect from the next output sample
+static inline void NESResamplerSetAdjustment(NESResampler *resampler, double adjustment)
+{
+	resampler->step = resampler->nominalStep * (1.0 + adjustment);
+}
+
+// Input samples NESResamplerWrite: will currently accept
+static inline uint32_t NESResamplerSpace(const NESResampler *resampler)
+{
+	return NES_RESAMPLER_INPUT_CAPACITY - resampler->inputCount;
+}
+
+// Output samples that can be produced from the input buffered so far
+static inline uint32_t NESResamplerAvailable(const NESResampler *resampler)
+{
+	double last = (double)resampler->inputCount - NES_RESAMPLER_TAPS; // Furthest position with all its taps present
+
+	return (resampler->position > last) ? 0 : (uint32_t)floor((last - resampler->position) / resampler->step) + 1;
+}
+
+static inline uint32_t NESResamplerWrite(NESResampler *resampler, const int16_t *samples, uint32_t count)
+{
+	float *input = resampler->input + resampler->inputCount;
+	uint32_t space = NESResamplerSpace(resampler);
+	uint32_t sample;
+
+	if (count > space) count = space;
+	for (sample = 0; sample < count; sample++) input[sample] = samples[sample];
+	resampler->inputCount += count;
+
+	return count;
+}
+
+// Moves the unconsumed input, with the history the next output's taps reach back over, to the front
+static inline void NESResamplerCompact(NESResampler *resampler)
+{
+	uint32_t consumed = (uint32_t)resampler->position;
+
+	if (consumed > resampler->inputCount) consumed = resampler->inputCount;
+	memmove(resampler->input,resampler->input + consumed,sizeof(float) * (resampler->inputCount - consumed));
+	resampler->inputCount -= consumed;
+	resampler->position -= consumed;
+}
+
+/* NESResamplerConvolve:
+ * Filters the taps at input with the two phase rows bracketing the output's position and interpolates between them. Four
+ * lanes wide with SSE; the rows are 16-byte aligned, the input generally isn't.
+ */
+static inline float NESResamplerConvolve(const float *input, const float *row, float fraction)
+{
+	const float *nextRow = row + NES_RESAMPLER_TAPS;
+	int tap;
+
+#ifdef NES_RESAMPLER_SSE
+	// Two accumulators per row halve the add latency chain, which bounds this loop rather than the multiplies
+	__m128 sum = _mm_setzero_ps(), oddSum = _mm_setzero_ps();
+	__m128 nextSum = _mm_setzero_ps(), oddNextSum = _mm_setzero_ps();
+	__m128 samples, oddSamples;
+	float lanes[4];
+
+	for (tap = 0; tap < NES_RESAMPLER_TAPS; tap += 8) {
+
+		samples = _mm_loadu_ps(input + tap);
+		oddSamples = _mm_loadu_ps(input + tap + 4);
+		sum = _mm_add_ps(sum,_mm_mul_ps(samples,_mm_load_ps(row + tap)));
+		oddSum = _mm_add_ps(oddSum,_mm_mul_ps(oddSamples,_mm_load_ps(row + tap + 4)));
+		nextSum = _mm_add_ps(nextSum,_mm_mul_ps(samples,_mm_load_ps(nextRow + tap)));
+		oddNextSum = _mm_add_ps(oddNextSum,_mm_mul_ps(oddSamples,_mm_load_ps(nextRow + tap + 4)));
+	}
+
+	sum = _mm_add_ps(sum,oddSum);
+	nextSum = _mm_add_ps(nextSum,oddNextSum);
+	sum = _mm_add_ps(sum,_mm_mul_ps(_mm_sub_ps(nextSum,sum),_mm_set1_ps(fraction)));
+	_mm_storeu_ps(lanes,sum);
+
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+	float sum[4] = { 0, 0, 0, 0 };
+	float nextSum[4] = { 0, 0, 0, 0 };
+	int lane;
+
+	for (tap = 0; tap < NES_RESAMPLER_TAPS; tap += 4) {
+
+		for (lane = 0; lane < 4; lane++) {
+
+			sum[lane] += input[tap + lane] * row[tap + lane];
+			nextSum[lane] += input[tap + lane] * nextRow[tap + lane];
+		}
+	}
+
+	for (lane = 0; lane < 4; lane++) sum[lane] += (nextSum[lane] - sum[lane]) * fraction;
+
+	return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+}
+
+/* NESResamplerRead:
+ * Produces up to count samples from the buffered input, returning how many, and frees the input they used.
+ */
+static inline uint32_t NESResamplerRead(NESResampler *resampler, int16_t *destination, uint32_t count)
+{
+	uint32_t available = NESResamplerAvailable(resampler);
+	uint32_t produced;
+	uint32_t index, row;
+	double position = resampler->position;
+	double phase;
+	float sample;
+
+	if (count > available) count = available;
+
+	for (produced = 0; produced < count; produced++) {
+
+		index = (uint32_t)position;
+		phase = (position - index) * NES_RESAMPLER_PHASES;
+		row = (uint32_t)phase;
+		sample = NESResamplerConvolve(resampler->input + index,resampler->coefficients + (row * NES_RESAMPLER_TAPS),(float)(phase - row));
+		sample += (sample < 0) ? -0.5f : 0.5f;
+		destination[produced] = (sample >= 32767.0f) ? 32767 : (sample <= -32768.0f) ? -32768 : (int16_t)sample;
+		position += resampler->step;
+	}
+
+	resampler->position = position;
+	NESResamplerCompact(resampler);
+
+	return count;
+}
+
+// Skips every sample that could be produced, returning how many were dropped
+static inline uint32_t NESResamplerDropOutput(NESResampler *resampler)
+{
+	uint32_t dropped = NESResamplerAvailable(resampler);
+
+	resampler->position += dropped * resampler->step;
+	NESResamplerCompact(resampler);
+
+	return dropped;
+}
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ *  NESResamplerTest.cpp
+ *
+ * Copyright (c) 2010 Auston Stewart
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Quality and throughput check for NESResampler.h
+ * Not part of the application target. Build and run from the repository root with:
+ *
+ *	c++ -O2 -include climits -include assert.h -Ines_apu -Ines_apu/boost NESResamplerTest.cpp nes_apu/Blip_Buffer.cpp
+ *		nes_apu/Nes_Apu.cpp nes_apu/Nes_Oscs.cpp nes_apu/apu_snapshot.cpp -o NESResamplerTest && ./NESResamplerTest
+ *
+ * Add -DNES_RESAMPLER_SCALAR to measure the scalar convolution. Every signal goes through the resampler as
+ * _resampleIntoRing feeds it, in chunks of up to 512 samples with all available output read after each.
+ *
+ * THD+N: a -6 dBFS sine at 44.1kHz is resampled and a sine at the same frequency fitted to the output by least squares,
+ * at the input instant each output sample was taken from; whatever the fit leaves is noise and distortion. Each tone is
+ * run at a fixed ratio and again with the ratio stepped between -0.5% and +0.5% every frame, as the pacing controller
+ * may. The int16 rounding floor for this level is about -92 dB.
+ *
+ * Aliasing: tones between the output's Nyquist frequency and the input's, which must be filtered out when downsampling,
+ * are resampled to 32kHz and the output's total level taken against the tone's.
+ *
+ * Throughput: ten seconds of Nes_Apu tone channels at random settings, synthesized by Blip_Buffer at 44.1kHz and
+ * resampled to the device rate, against the same synthesized by Blip_Buffer at the device rate directly.
+ */
+
+#include "Blip_Buffer.h"
+#include "Nes_Apu.h"
+#include "NESResampler.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define TEST_INPUT_RATE 44100
+#define TEST_CHUNK 512
+#define TEST_FRAME 735 // Input samples between ratio changes
+#define TEST_SECONDS 10
+#define TEST_SETTLE 256 // Output samples skipped while the filter's history fills
+#define TEST_THDN_LIMIT -84.0 // dB
+#define TEST_ALIAS_LIMIT -60.0 // dB
+
+static int failures = 0;
+
+static double seconds()
+{
+	struct timespec now;
+	
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	
+	return now.tv_sec + (now.tv_nsec * 1e-9);
+}
+
+/* resampleTone
+ * Resamples count input samples of a sine at frequency and returns how many outputs were made. Each output's input
+ * instant, in samples, is recorded in instants; wobble steps the ratio every frame.
+ */
+static uint32_t resampleTone(long outputRate, double frequency, double amplitude, uint32_t count, bool wobble, int16_t *output, double *instants, uint32_t capacity)
+{
+	NESResampler *resampler = NESResamplerCreate(TEST_INPUT_RATE,outputRate);
+	int16_t chunk[TEST_CHUNK];
+	uint32_t written = 0;
+	uint32_t produced = 0;
+	uint32_t length, index, made;
+	double instant = 0;
+	int frame = -1;
+	
+	while (written < count) {
+		
+		length = NESResamplerSpace(resampler);
+		if (length > TEST_CHUNK) length = TEST_CHUNK;
+		if (length > count - written) length = count - written;
+		
+		// Ratio changes land where _resampleIntoRing's would, between writes at frame boundaries
+		if (wobble && ((int)(written / TEST_FRAME) != frame)) {
+			
+			frame = written / TEST_FRAME;
+			NESResamplerSetAdjustment(resampler,0.005 * sin(frame * 1.7));
+		}
+		if (wobble && ((written % TEST_FRAME) + length > TEST_FRAME)) length = TEST_FRAME - (written % TEST_FRAME);
+		
+		for (index = 0; index < length; index++) chunk[index] = (int16_t)floor((amplitude * sin(2.0 * M_PI * frequency * (written + index) / TEST_INPUT_RATE)) + 0.5);
+		NESResamplerWrite(resampler,chunk,length);
+		written += length;
+		
+		while ((made = NESResamplerAvailable(resampler)) > 0) {
+			
+			if (made > capacity - produced) made = capacity - produced;
+			if (made == 0) break;
+			for (index = 0; index < made; index++) {
+				
+				instants[produced + index] = instant;
+				instant += resampler->step;
+			}
+			produced += NESResamplerRead(resampler,output + produced,made);
+		}
+	}
+	
+	NESResamplerDestroy(resampler);
+	
+	return produced;
+}
+
+// Fits a sin + b cos + c at the given instants by least squares and returns the residual's level against the fit's, in dB
+static double residualLevel(const int16_t *output, const double *instants, uint32_t count, double frequency)
+{
+	double m[3][4] = { { 0 } };
+	double basis[3], solution[3];
+	double signal = 0, residual = 0, fit, scale;
+	uint32_t n;
+	int row, column, pivot;
+	
+	for (n = TEST_SETTLE; n < count; n++) {
+		
+		basis[0] = sin(2.0 * M_PI * frequency * instants[n] / TEST_INPUT_RATE);
+		basis[1] = cos(2.0 * M_PI * frequency * instants[n] / TEST_INPUT_RATE);
+		basis[2] = 1.0;
+		for (row = 0; row < 3; row++) {
+			
+			for (column = 0; column < 3; column++) m[row][column] += basis[row] * basis[column];
+			m[row][3] += basis[row] * output[n];
+		}
+	}
+	
+	// Gauss-Jordan on the 3x3 normal equations, which are well conditioned for these lengths
+	for (pivot = 0; pivot < 3; pivot++) {
+		
+		for (row = 0; row < 3; row++) {
+			
+			if (row == pivot) continue;
+			scale = m[row][pivot] / m[pivot][pivot];
+			for (column = 0; column < 4; column++) m[row][column] -= scale * m[pivot][column];
+		}
+	}
+	for (row = 0; row < 3; row++) solution[row] = m[row][3] / m[row][row];
+	
+	for (n = TEST_SETTLE; n < count; n++) {
+		
+		fit = (solution[0] * sin(2.0 * M_PI * frequency * instants[n] / TEST_INPUT_RATE)) + (solution[1] * cos(2.0 * M_PI * frequency * instants[n] / TEST_INPUT_RATE));
+		signal += fit * fit;
+		residual += (output[n] - fit - solution[2]) * (output[n] - fit - solution[2]);
+	}
+	
+	return 10.0 * log10(residual / signal);
+}
+
+static void testDistortion(void)
+{
+	static const long rates[] = { 48000, 96000, 32000 };
+	static const double tones[] = { 440, 1000, 5000, 10000, 14000 };
+	uint32_t inputCount = TEST_INPUT_RATE * 2;
+	uint32_t capacity = 96000 * 3;
+	int16_t *output = (int16_t *)malloc(sizeof(int16_t) * capacity);
+	double *instants = (double *)malloc(sizeof(double) * capacity);
+	double fixed, wobbled;
+	uint32_t count;
+	int rate, tone;
+	
+	printf("THD+N of a -6 dBFS sine from 44.1kHz, fixed ratio / ratio stepped +/-0.5%% per frame\n");
+	
+	for (rate = 0; rate < 3; rate++) {
+		
+		printf("%6ld Hz:",rates[rate]);
+		for (tone = 0; tone < 5; tone++) {
+			
+			count = resampleTone(rates[rate],tones[tone],16384,inputCount,false,output,instants,capacity);
+			fixed = residualLevel(output,instants,count,tones[tone]);
+			count = resampleTone(rates[rate],tones[tone],16384,inputCount,true,output,instants,capacity);
+			wobbled = residualLevel(output,instants,count,tones[tone]);
+			printf("  %5.0f Hz %.1f/%.1f dB",tones[tone],fixed,wobbled);
+			
+			if ((fixed > TEST_THDN_LIMIT) || (wobbled > TEST_THDN_LIMIT)) failures++;
+		}
+		printf("\n");
+	}
+	
+	free(output);
+	free(instants);
+}
+
+static void testAliasing(void)
+{
+	static const double tones[] = { 17000, 18000, 20000, 22000 };
+	uint32_t inputCount = TEST_INPUT_RATE * 2;
+	uint32_t capacity = 32000 * 3;
+	int16_t *output = (int16_t *)malloc(sizeof(int16_t) * capacity);
+	double *instants = (double *)malloc(sizeof(double) * capacity);
+	double power, level;
+	uint32_t count, n;
+	int tone;
+	
+	printf("Output level of a -6 dBFS sine above 16kHz, resampled to 32kHz\n");
+	
+	for (tone = 0; tone < 4; tone++) {
+		
+		count = resampleTone(32000,tones[tone],16384,inputCount,false,output,instants,capacity);
+		power = 0;
+		for (n = TEST_SETTLE; n < count; n++) power += (double)output[n] * output[n];
+		level = 10.0 * log10((power / (count - TEST_SETTLE)) / (16384.0 * 16384.0 / 2));
+		printf("  %5.0f Hz (aliases to %5.0f Hz): %.1f dB\n",tones[tone],32000 - tones[tone],level);
+		
+		if (level > TEST_ALIAS_LIMIT) failures++;
+	}
+}
+
+// Plays the same random register writes on each frame, so both paths synthesize the same audio
+static void writeFrame(Nes_Apu& apu, int frame)
+{
+	int write;
+	cpu_addr_t address;
+	
+	srand(frame);
+	for (write = 0; write < 16; write++) {
+		
+		address = 0x4000 + (rand() % 16);
+		if ((address >= 0x4010) && (address <= 0x4013)) continue; // The DMC stays idle; it has no memory to read here
+		apu.write_register(write * 1860,0x4015,0x0F);
+		apu.write_register(write * 1860,address,rand() & 0xFF);
+	}
+	apu.end_frame(29781);
+}
+
+/* timeSynthesis
+ * Seconds for TEST_SECONDS of frames synthesized at synthesisRate and, if resampling, resampled to outputRate. The
+ * total of the output is returned through sink so neither path can be optimized away.
+ */
+static double timeSynthesis(long synthesisRate, long outputRate, bool resampling, long *outputCount, long *sink)
+{
+	Blip_Buffer buffer;
+	Nes_Apu apu;
+	NESResampler *resampler = resampling ? NESResamplerCreate(synthesisRate,outputRate) : NULL;
+	blip_sample_t chunk[TEST_CHUNK];
+	int16_t output[TEST_CHUNK * 4];
+	long count, made;
+	double start;
+	int frame;
+	
+	buffer.sample_rate(synthesisRate,100);
+	buffer.clock_rate(1789773);
+	apu.output(&buffer);
+	*outputCount = 0;
+	
+	start = seconds();
+	for (frame = 0; frame < TEST_SECONDS * 60; frame++) {
+		
+		writeFrame(apu,frame);
+		buffer.end_frame(29781);
+		
+		if (resampler) {
+			
+			while ((count = buffer.samples_avail()) > 0) {
+				
+				if (count > (long)NESResamplerSpace(resampler)) count = NESResamplerSpace(resampler);
+				if (count > TEST_CHUNK) count = TEST_CHUNK;
+				NESResamplerWrite(resampler,chunk,(uint32_t)buffer.read_samples(chunk,count));
+				while ((made = NESResamplerRead(resampler,output,TEST_CHUNK * 4)) > 0) {
+					
+					*outputCount += made;
+					*sink += output[made - 1];
+				}
+			}
+		}
+		else {
+			
+			while ((count = buffer.read_samples(output,TEST_CHUNK)) > 0) {
+				
+				*outputCount += count;
+				*sink += output[count - 1];
+			}
+		}
+	}
+	
+	NESResamplerDestroy(resampler);
+	
+	return seconds() - start;
+}
+
+static void testThroughput(void)
+{
+	static const long rates[] = { 48000, 96000, 32000 };
+	double direct, resampled, bestDirect, bestResampled;
+	long directCount = 0, resampledCount = 0, sink = 0;
+	int rate, round;
+
+#ifdef NES_RESAMPLER_SSE
+	printf("Synthesis throughput, ns per output sample (SSE convolution)\n");
+#else
+	printf("Synthesis throughput, ns per output sample (scalar convolution)\n");
+#endif
+	
+	for (rate = 0; rate < 3; rate++) {
+		
+		bestDirect = bestResampled = 1e9;
+		
+		// Interleaved, keeping each one's best, so clock changes and cache state land on both alike
+		for (round = 0; round < 5; round++) {
+			
+			direct = timeSynthesis(rates[rate],rates[rate],false,&directCount,&sink);
+			resampled = timeSynthesis(TEST_INPUT_RATE,rates[rate],true,&resampledCount,&sink);
+			if (direct < bestDirect) bestDirect = direct;
+			if (resampled < bestResampled) bestResampled = resampled;
+		}
+		
+		printf("%6ld Hz: Blip_Buffer at %ld Hz %.1f, Blip_Buffer at 44100 Hz + NESResampler %.1f (%ld vs %ld samples)%s\n",
+			   rates[rate],rates[rate],bestDirect * 1e9 / directCount,bestResampled * 1e9 / resampledCount,directCount,resampledCount,(sink == 42) ? " " : "");
+	}
+}
+
+int main(void)
+{
+	testDistortion();
+	testAliasing();
+	testThroughput();
+	
+	printf("%s\n",failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
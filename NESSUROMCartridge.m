@@ -33,26 +33,12 @@
 
 - (void)_switch16KBPRGROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected16KBBank = index * (BANK_SIZE_16KB / PRGROM_BANK_SIZE);
-	
-	// Establish PRGROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_16KB / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter + (bank * BANK_SIZE_16KB / PRGROM_BANK_SIZE)] = _suromPRGROMBankOffset + selected16KBBank + bankCounter;
-	}
+	[self mapPRGROMSlot:(bank * BANK_SIZE_16KB / PRGROM_BANK_SIZE) count:(BANK_SIZE_16KB / PRGROM_BANK_SIZE) toBank:_suromPRGROMBankOffset + (index * (BANK_SIZE_16KB / PRGROM_BANK_SIZE))];
 }
 
 - (void)_switch32KBPRGROMToBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected32KBBank = index * (PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE);
-	
-	// Establish PRGROM indices
-	for (bankCounter = 0; bankCounter < (PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter] = _suromPRGROMBankOffset + selected32KBBank + bankCounter;
-	}
+	[self mapPRGROMSlot:0 count:(PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE) toBank:_suromPRGROMBankOffset + (index * (PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE))];
 }
 
 - (void)_setMMC1CHRROMBank0Register:(uint8_t)byte
@@ -33,50 +33,22 @@
 
 - (void)_switch4KBCHRROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected4KBBank = index * BANK_SIZE_4KB / CHRROM_BANK_SIZE;
-	
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_4KB / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter + (bank * BANK_SIZE_4KB / CHRROM_BANK_SIZE)] = selected4KBBank + bankCounter;
-	}
+	[self mapCHRROMSlot:(bank * BANK_SIZE_4KB / CHRROM_BANK_SIZE) count:(BANK_SIZE_4KB / CHRROM_BANK_SIZE) toBank:(index * BANK_SIZE_4KB / CHRROM_BANK_SIZE)];
 }
 
 - (void)_switch8KBCHRROMToBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected8KBBank = index * BANK_SIZE_8KB / CHRROM_BANK_SIZE;
-	
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter] = selected8KBBank + bankCounter;
-	}
+	[self mapCHRROMSlot:0 count:(CHRROM_APERTURE_SIZE / CHRROM_BANK_SIZE) toBank:(index * BANK_SIZE_8KB / CHRROM_BANK_SIZE)];
 }
 
 - (void)_switch16KBPRGROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected16KBBank = index * (BANK_SIZE_16KB / PRGROM_BANK_SIZE);
-	
-	// Establish PRGROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_16KB / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter + (bank * BANK_SIZE_16KB / PRGROM_BANK_SIZE)] = selected16KBBank + bankCounter;
-	}
+	[self mapPRGROMSlot:(bank * BANK_SIZE_16KB / PRGROM_BANK_SIZE) count:(BANK_SIZE_16KB / PRGROM_BANK_SIZE) toBank:(index * (BANK_SIZE_16KB / PRGROM_BANK_SIZE))];
 }
 
 - (void)_switch32KBPRGROMToBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected32KBBank = index * (PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE);
-	
-	// Establish PRGROM indices
-	for (bankCounter = 0; bankCounter < (PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter] = selected32KBBank + bankCounter;
-	}
+	[self mapPRGROMSlot:0 count:(PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE) toBank:(index * (PRGROM_APERTURE_SIZE / PRGROM_BANK_SIZE))];
 }
 
 - (void)_setMMC1CHRROMBank0Register:(uint8_t)byte
@@ -103,8 +75,6 @@
 	}
 	
 	_mmc1CHRROMBank0Register = byte;
-	
-	[self rebuildCHRROMPointers];
 }
 
 - (void)_setMMC1CHRROMBank1Register:(uint8_t)byte
@@ -119,8 +89,6 @@
 	}
 	
 	_mmc1CHRROMBank1Register = byte;
-	
-	[self rebuildCHRROMPointers];
 }
 
 - (void)_setMMC1PRGROMBankRegister:(uint8_t)byte
@@ -150,8 +118,6 @@
 	
 	// FIXME: Bit 4 (0x10) Toggles PRGRAM on MMC1B and MMC1C (0: enabled; 1: disabled; ignored on MMC1A)
 	_mmc1PRGROMBankRegister = byte;
-	
-	[self rebuildPRGROMPointers];
 }
 
 - (void)_setMMC1ControlRegister:(uint8_t)byte onCycle:(uint_fast32_t)cycle
@@ -268,10 +234,7 @@
 	
 	[self _switch16KBPRGROMBank:0 toBank:0];
 	[self _switch16KBPRGROMBank:1 toBank:(([self _outerPRGROMBankSize] - BANK_SIZE_16KB) / BANK_SIZE_16KB)];
-	[self rebuildPRGROMPointers];
-	
 	[self _switch8KBCHRROMToBank:0];
-	[self rebuildCHRROMPointers];
 }
 
 @end
@@ -31,7 +31,6 @@
 
 	BOOL _mmc3IRQEnabled;
 	BOOL _mmc3ReloadIRQCounter;
-	BOOL _mmc3A12NormalOscillation;
 	BOOL _mmc3HighPRGROMSwappable;
 	BOOL _mmc3LowCHRROMIn1kbBanks;
 	BOOL _mmc3WRAMWriteDisable;
@@ -45,11 +44,22 @@
 	uint8_t _bankRegisterToUpdate;
 	
 	uint_fast32_t _lastPPUCycle;
+	uint_fast32_t _mmc3A12RiseDot;
+	uint_fast32_t _predictedIRQCycle;
+	BOOL _lastPPUCycleOnShortFrame;
+	
+	BOOL _validatesIRQPrediction;
+	BOOL _referenceReloadIRQCounter;
+	uint8_t _referenceIRQCounter;
+	uint_fast32_t _irqPredictionMismatches;
 	
 	NES6502Interpreter *_cpu;
 }
 
 - (id)initWithPrgrom:(uint8_t *)prgrom chrrom:(uint8_t *)chrrom ppu:(NESPPUEmulator *)ppu cpu:(NES6502Interpreter *)cpu andiNesFlags:(iNESFlags *)flags;
-- (void)ppuStateChanged:(PPUState *)state;
+- (void)ppuStateChanged:(const PPUState *)state;
+- (void)setValidatesIRQPrediction:(BOOL)flag;
+- (BOOL)validatesIRQPrediction;
+- (uint_fast32_t)irqPredictionMismatches;
 
 @end
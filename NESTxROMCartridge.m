@@ -25,9 +25,70 @@
 #import "NES6502Interpreter.h"
 
 #define IRQ_DELAY 6
+#define A12_RISES_IN_FRAME 241
+#define NO_PREDICTED_IRQ 0xFFFFFFFF // Also what setNextIRQ: takes as NO_PENDING_IRQ
+
+/* mmc3A12RiseDot
+ * The dot on which A12 rises each scanline, or 0 when the fetch pattern doesn't give one predictable rise per line.
+ * With 8x8 sprites A12 rises on the first sprite fetch from $1000, or on the first background fetch for the next line
+ * from $1000. With 8x16 sprites and the background at $0000, empty sprite slots fetch tile $FF from $1000, so A12
+ * rises once within the sprite fetches; the exact dot depends on the line's sprites and is taken as the first fetch.
+ */
+static inline uint_fast32_t mmc3A12RiseDot(uint8_t controlRegister1, uint8_t controlRegister2) {
+	
+	if (!(controlRegister2 & 0x18)) return 0;
+	if (controlRegister1 & 0x20) return (controlRegister1 & 0x10) ? 0 : 260;
+	if ((controlRegister1 & 0x18) == 0x08) return 260;
+	if ((controlRegister1 & 0x18) == 0x10) return 324;
+	
+	return 0;
+}
+
+// A12 rises once on the priming scanline and once on each visible scanline: counts those before a cycle of the frame
+static inline uint_fast32_t a12RisesBeforeCycle(uint_fast32_t cycle, uint_fast32_t riseDot, BOOL shortenPrimingScanline) {
+	
+	uint_fast32_t firstVisibleRise = (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL) + riseDot;
+	uint_fast32_t rises;
+	
+	if (cycle <= (CYCLES_OF_VBLANK + riseDot)) return 0;
+	if (cycle <= firstVisibleRise) return 1;
+	
+	rises = 2 + ((cycle - firstVisibleRise - 1) / CYCLES_IN_SCANLINE_NORMAL);
+	return rises < A12_RISES_IN_FRAME ? rises : A12_RISES_IN_FRAME;
+}
+
+// The cycle of a frame on which the given rise occurs, counting from one
+static inline uint_fast32_t cycleOfA12Rise(uint_fast32_t rise, uint_fast32_t riseDot, BOOL shortenPrimingScanline) {
+	
+	if (rise == 1) return CYCLES_OF_VBLANK + riseDot;
+	
+	return (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL) + ((rise - 2) * CYCLES_IN_SCANLINE_NORMAL) + riseDot;
+}
+
+/* clockMMC3Counter
+ * Applies any number of A12 rises at once. A rise reloads a counter that is zero or flagged for reload and decrements
+ * it otherwise, so once the first rise is applied the counter just cycles from the latch value down to zero.
+ */
+static inline uint8_t clockMMC3Counter(uint8_t counter, BOOL reload, uint8_t latch, uint_fast32_t rises) {
+	
+	uint_fast32_t afterFirstRise;
+	
+	if (rises == 0) return counter;
+	
+	afterFirstRise = (reload || (counter == 0)) ? latch : counter - 1;
+	if ((rises - 1) <= afterFirstRise) return afterFirstRise - (rises - 1);
+	
+	return latch - ((rises - 2 - afterFirstRise) % (latch + 1));
+}
 
 @implementation NESTxROMCartridge
 
+// Control register writes and frame ends can change how A12 oscillates
+static void mmc3PPUStateChanged(void *context, const PPUState *state) {
+	
+	[(NESTxROMCartridge *)context ppuStateChanged:state];
+}
+
 - (id)initWithPrgrom:(uint8_t *)prgrom chrrom:(uint8_t *)chrrom ppu:(NESPPUEmulator *)ppu cpu:(NES6502Interpreter *)cpu andiNesFlags:(iNESFlags *)flags
 {
 	[super initWithPrgrom:prgrom chrrom:chrrom ppu:ppu andiNesFlags:flags];
@@ -39,38 +100,18 @@
 
 - (void)_switch1KBCHRROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected1KBBank = (index & _chrromIndexMask) * BANK_SIZE_1KB / CHRROM_BANK_SIZE;
-	
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_1KB / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter + (bank * BANK_SIZE_1KB / CHRROM_BANK_SIZE)] = selected1KBBank + bankCounter;
-	}
+	[self mapCHRROMSlot:bank count:1 toBank:(index & _chrromIndexMask)];
 }
 
 - (void)_switch2KBCHRROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected2KBBank = (index & _chrromIndexMask) * BANK_SIZE_1KB / CHRROM_BANK_SIZE;
-	
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_2KB / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter + (bank * BANK_SIZE_2KB / CHRROM_BANK_SIZE)] = (selected2KBBank + bankCounter) & _chrromIndexMask;
-	}
+	// The low bit of a 2KB bank number is ignored
+	[self mapCHRROMSlot:(bank * BANK_SIZE_2KB / CHRROM_BANK_SIZE) count:(BANK_SIZE_2KB / CHRROM_BANK_SIZE) toBank:(index & 0xFE & _chrromIndexMask)];
 }
 
 - (void)_switch8KBPRGROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected8KBBank = (index & _prgromIndexMask) * (BANK_SIZE_8KB / PRGROM_BANK_SIZE);
-	
-	// Establish PRGROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_8KB / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter + (bank * BANK_SIZE_8KB / PRGROM_BANK_SIZE)] = selected8KBBank + bankCounter;
-	}
+	[self mapPRGROMSlot:(bank * BANK_SIZE_8KB / PRGROM_BANK_SIZE) count:(BANK_SIZE_8KB / PRGROM_BANK_SIZE) toBank:((index & _prgromIndexMask) * (BANK_SIZE_8KB / PRGROM_BANK_SIZE))];
 }
 
 - (void)_updateCHRROMBankForRegister:(uint8_t)reg
@@ -84,6 +125,7 @@
 		case 1:
 			// Select 2 KB CHR bank at PPU $0800-$0FFF (or $1800-$1FFF)
 			[self _switch2KBCHRROMBank:(_mmc3LowCHRROMIn1kbBanks ? 3 : 1) toBank:_mmc3BankRegisters[1]];
+			break;
 		case 2:
 			// Select 1 KB CHR bank at PPU $1000-$13FF (or $0000-$03FF)
 			[self _switch1KBCHRROMBank:(_mmc3LowCHRROMIn1kbBanks ? 0 : 4) toBank:_mmc3BankRegisters[2]];
@@ -134,8 +176,8 @@
 
 - (void)_updatePRGROMBanks
 {
-	[self _updateCHRROMBankForRegister:6];
-	[self _updateCHRROMBankForRegister:7];
+	[self _updatePRGROMBankForRegister:6];
+	[self _updatePRGROMBankForRegister:7];
 	
 	// Either 0x8000-0x9FFF or 0xC000-0xDFFF is fixed to second-to-last 8KB PRGROM bank
 	[self _switch8KBPRGROMBank:(_mmc3HighPRGROMSwappable ? 0 : 2) toBank:((_iNesFlags->prgromSize - BANK_SIZE_16KB) / BANK_SIZE_8KB)];
@@ -143,181 +185,136 @@
 
 - (void)_catchUpScanlineCounter:(uint_fast32_t)ppuCycle
 {
-	uint_fast32_t ppuStartingCycle, startingCyclesSincePrimingScanline, endingCyclesSincePrimingScanline, scanlineStartingCycle, scanlineEndingCycle;
-	uint_fast32_t a12Raises = 0;
-	uint8_t startingScanline, endingScanline;
-	// uint8_t startingCounter = _mmc3IRQCounter;
+	uint_fast32_t a12Rises;
 	BOOL shortenPrimingScanline = [_ppu shortenPrimingScanline];
 	
-	ppuStartingCycle = _lastPPUCycle;
-	
-	if (ppuCycle < ppuStartingCycle) {
-	
-		// We must be on the previous frame
-		[self _catchUpScanlineCounter:(shortenPrimingScanline ? CYCLES_IN_FRAME_SHORT : CYCLES_IN_FRAME_NORMAL)];
-		ppuStartingCycle = _lastPPUCycle = 0;
-	}
-	
-	if (_mmc3A12NormalOscillation) {
-		
-		if ((ppuStartingCycle < (CYCLES_OF_VBLANK + 260)) && (ppuCycle >= (CYCLES_OF_VBLANK + 260))) {
-	
-			a12Raises++;
-		}
-	
-		if (ppuCycle > (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL)) {
-	
-			if (ppuStartingCycle < (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL)) {
-			
-				ppuStartingCycle = (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL);
-			}
-				
-			startingCyclesSincePrimingScanline = ppuStartingCycle - (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL);
-			endingCyclesSincePrimingScanline = ppuCycle - (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL);
-			startingScanline = startingCyclesSincePrimingScanline / CYCLES_IN_SCANLINE_NORMAL;
-			endingScanline = endingCyclesSincePrimingScanline / CYCLES_IN_SCANLINE_NORMAL;
-			scanlineStartingCycle = startingCyclesSincePrimingScanline % CYCLES_IN_SCANLINE_NORMAL;
-			scanlineEndingCycle = endingCyclesSincePrimingScanline % CYCLES_IN_SCANLINE_NORMAL;
-		
-			// Add a raise if we pass the beginning of sprite access in the starting scanline
-			if ((scanlineStartingCycle < 260) && ((scanlineEndingCycle >= 260) || (endingScanline > startingScanline))) {
-			
-				a12Raises++;
-			}
+	if (_mmc3A12RiseDot) {
 		
-			if (endingScanline > startingScanline) {
+		// Count the rises since the last catch-up, including the rest of the previous frame if it has ended
+		if (ppuCycle < _lastPPUCycle) a12Rises = (A12_RISES_IN_FRAME - a12RisesBeforeCycle(_lastPPUCycle, _mmc3A12RiseDot, _lastPPUCycleOnShortFrame)) + a12RisesBeforeCycle(ppuCycle, _mmc3A12RiseDot, shortenPrimingScanline);
+		else a12Rises = a12RisesBeforeCycle(ppuCycle, _mmc3A12RiseDot, shortenPrimingScanline) - a12RisesBeforeCycle(_lastPPUCycle, _mmc3A12RiseDot, shortenPrimingScanline);
 		
-				// If we end on a different scanline and pass the beginning of sprite access there
-				if (scanlineEndingCycle >= 260) a12Raises++;
+		if (a12Rises) {
 			
-				// Add for all sprite access in the intervening scanlines
-				a12Raises += endingScanline - startingScanline - 1;
-			}
-		}
-		// NSLog(@"Catching up scanline counter from PPU cycle %d to %d. %d A12 raises occurred.",_lastPPUCycle,ppuCycle,a12Raises);
-	
-		// Reload counter if the flag is set and at least one A12 rising edge occurred
-		if (_mmc3ReloadIRQCounter && a12Raises) {
-
-			a12Raises--;
+			_mmc3IRQCounter = clockMMC3Counter(_mmc3IRQCounter, _mmc3ReloadIRQCounter, _mmc3IRQCounterReloadValue, a12Rises);
 			_mmc3ReloadIRQCounter = NO;
-			_mmc3IRQCounter = _mmc3IRQCounterReloadValue;
-			// FIXME: An IRQ could also be caught here if starting counter is non-zero and reload is zero
-		}
-	
-		// Check to see if the counter reached zero
-		if (a12Raises > _mmc3IRQCounter) {
-		
-			_mmc3IRQCounter = _mmc3IRQCounterReloadValue - ((a12Raises - 1) - _mmc3IRQCounter);
-			// if (startingCounter) NSLog(@"MMC3 IRQ occurred during catch-up.");
 		}
-		else _mmc3IRQCounter -= a12Raises;
 	}
 	// else  NSLog(@"MMC3 IRQ catch-up routine aborted as A12 oscillation is atypical.");
-	// if (_mmc3IRQCounter < 0) NSLog(@"MMC3 IRQ Counter less than zero!");
-	// Set the last PPU cycle
-	// NSLog(@"MMC3 IRQ counter value is %d.",_mmc3IRQCounter);
 	
 	_lastPPUCycle = ppuCycle;
+	_lastPPUCycleOnShortFrame = shortenPrimingScanline;
+	
+	if (_validatesIRQPrediction && ((_referenceIRQCounter != _mmc3IRQCounter) || (_referenceReloadIRQCounter != _mmc3ReloadIRQCounter))) {
+		
+		_irqPredictionMismatches++;
+		NSLog(@"MMC3 scanline counter diverged on PPU cycle %lu: predicted %d, reference %d.",(unsigned long)ppuCycle,_mmc3IRQCounter,_referenceIRQCounter);
+		_referenceIRQCounter = _mmc3IRQCounter;
+		_referenceReloadIRQCounter = _mmc3ReloadIRQCounter;
+	}
 }
 
+/* _cpuCyclesBeforeIRQ
+ * The counter reaches zero on the rise after it has counted down from its next value, and every rise falls on a known
+ * dot of a known scanline, so the next IRQ is found without stepping through the rises. It can land at most two
+ * frames ahead, with the priming scanline alternating in length while rendering.
+ */
 - (uint_fast32_t)_cpuCyclesBeforeIRQ
 {
-	uint_fast32_t ppuCycle, cyclesToAdd, scanlineCycle, cyclesPastPrimingScanline, a12RaisesBeforeIRQ, ppuCyclesBeforeIRQ, counter;
-	// int_fast32_t estimatedIRQCyclePastPriming;
+	uint_fast32_t risesBeforeIRQ, rise, ppuCyclesBeforeIRQ;
 	BOOL shortenPrimingScanline = [_ppu shortenPrimingScanline];
 	
-	if (_mmc3IRQEnabled && _mmc3A12NormalOscillation) {
-				
-		if (_mmc3ReloadIRQCounter || (_mmc3IRQCounter == 0)) {
-		
-			// Non-zero counter will be reset to zero
-			if (_mmc3IRQCounterReloadValue == 0) {
-			
-				if (_mmc3IRQCounter > 0) a12RaisesBeforeIRQ = 1; // Will IRQ on the next raise
-				else return 0xFFFFFFFF; // If the counter is zero and we reload zero there'll be no IRQ
-			}
-			else {
-				
-				// Counter will reset and count down from non-zero to zero
-				a12RaisesBeforeIRQ = _mmc3IRQCounterReloadValue + 1;
-			}
-		}
-		else {
-		
-			// Counter will count down from non-zero to zero
-			a12RaisesBeforeIRQ = _mmc3IRQCounter;
-		}
+	_predictedIRQCycle = NO_PREDICTED_IRQ;
+	
+	// Perhaps sometime in the distant future, but not this frame
+	if (!_mmc3IRQEnabled || !_mmc3A12RiseDot) return NO_PREDICTED_IRQ;
+	
+	risesBeforeIRQ = ((_mmc3ReloadIRQCounter || (_mmc3IRQCounter == 0)) ? _mmc3IRQCounterReloadValue : _mmc3IRQCounter - 1) + 1;
+	rise = a12RisesBeforeCycle(_lastPPUCycle, _mmc3A12RiseDot, shortenPrimingScanline) + risesBeforeIRQ;
+	ppuCyclesBeforeIRQ = 0;
+	
+	if (rise > A12_RISES_IN_FRAME) {
 		
-		// Determine PPU cycles before next IRQ
-		ppuCyclesBeforeIRQ = 0;
-		ppuCycle = _lastPPUCycle;
+		ppuCyclesBeforeIRQ += (shortenPrimingScanline ? CYCLES_IN_FRAME_SHORT : CYCLES_IN_FRAME_NORMAL);
+		rise -= A12_RISES_IN_FRAME;
+		shortenPrimingScanline = !shortenPrimingScanline;
+	}
+	
+	if (rise > A12_RISES_IN_FRAME) {
 		
-		for (counter = 0; counter < a12RaisesBeforeIRQ; counter++) {
-			
-			if (ppuCycle < (CYCLES_OF_VBLANK + 260)) {
-			
-				ppuCyclesBeforeIRQ += (CYCLES_OF_VBLANK + 260) - ppuCycle;
-				ppuCycle = CYCLES_OF_VBLANK + 260;
-			}
-			else if (ppuCycle >= (shortenPrimingScanline ? 88919 : 88920)) {
-			
-				ppuCyclesBeforeIRQ += ((shortenPrimingScanline ? CYCLES_IN_FRAME_SHORT : CYCLES_IN_FRAME_NORMAL) - ppuCycle) + CYCLES_OF_VBLANK + 260;
-				ppuCycle = CYCLES_OF_VBLANK + 260;
-				shortenPrimingScanline = !shortenPrimingScanline;
-			}
-			else {
-			
-				// Figure out the odd/even frame timing in the priming scanline
-				if (ppuCycle < (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL)) {
-				
-					ppuCyclesBeforeIRQ += (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL) - ppuCycle;
-					ppuCycle = shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL;
-				}
-				
-				cyclesPastPrimingScanline = ppuCycle - (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL);
-				scanlineCycle = cyclesPastPrimingScanline % 341;
-				
-				if (scanlineCycle < 260) cyclesToAdd = 260 - scanlineCycle;
-				else cyclesToAdd = 260 + (341 - scanlineCycle);
-				
-				ppuCycle += cyclesToAdd;
-				ppuCyclesBeforeIRQ += cyclesToAdd;
-			}
-		}
-	} else return 0xffffffff; // Perhaps sometime in the distant future, but not this frame
+		ppuCyclesBeforeIRQ += (shortenPrimingScanline ? CYCLES_IN_FRAME_SHORT : CYCLES_IN_FRAME_NORMAL);
+		rise -= A12_RISES_IN_FRAME;
+		shortenPrimingScanline = !shortenPrimingScanline;
+	}
 	
-	// estimatedIRQCyclePastPriming = (((_lastPPUCycle + ppuCyclesBeforeIRQ) % (shortenPrimingScanline ? CYCLES_IN_FRAME_SHORT : CYCLES_IN_FRAME_NORMAL)) - (shortenPrimingScanline ? CYCLES_BEFORE_RENDERING_SHORT : CYCLES_BEFORE_RENDERING_NORMAL));
-	// NSLog(@"Next MMC3 IRQ expected to occur on PPU Scanline %d Cycle %d.",estimatedIRQCyclePastPriming / 341,estimatedIRQCyclePastPriming % 341);
+	_predictedIRQCycle = cycleOfA12Rise(rise, _mmc3A12RiseDot, shortenPrimingScanline);
+	ppuCyclesBeforeIRQ += _predictedIRQCycle - _lastPPUCycle;
+	// NSLog(@"Next MMC3 IRQ expected to occur on PPU cycle %d.",_predictedIRQCycle);
 	ppuCyclesBeforeIRQ += IRQ_DELAY; // FIXME: This actually needs to be accounted for in the CPU interpreter
 	
 	return (ppuCyclesBeforeIRQ / 3) + (ppuCyclesBeforeIRQ % 3 ? 1 : 0);
 }
 
-- (void)ppuStateChanged:(PPUState *)state
+- (void)ppuStateChanged:(const PPUState *)state
 {
-	BOOL newA12OscillationState;
+	uint_fast32_t newA12RiseDot;
 	
 	// NSLog(@"Notified of new PPU state.");
 	
 	// 1. Catch-up MMC3 Scanline Counter
 	[self _catchUpScanlineCounter:state->cycle];
 	
-	// FIXME: Doesn't take into consideration 8x16 sprites!
-	
-	// If PPU is on (i.e. background or sprite rendering enabled and sprites and background and loaded from upper and lower banks, respectively
-	newA12OscillationState = (((state->controlRegister2 & 0x8) || (state->controlRegister2 & 0x10)) && 
-		(state->controlRegister1 & 0x8) && !(state->controlRegister1 & 0x10));
+	// 2. See what changed in PPU status (e.g. Is A12 oscillation still predictable, and on which dot?)
+	newA12RiseDot = mmc3A12RiseDot(state->controlRegister1, state->controlRegister2);
 	
-	// 2. See what changed in PPU status (e.g. Is A12 oscillation normal?)
-	if (_mmc3A12NormalOscillation != newA12OscillationState) {
+	if (_mmc3A12RiseDot != newA12RiseDot) {
 	
-		// NSLog(@"PPU has changed A12 oscillation pattern to %@.",newA12OscillationState ? @"normal" : @"irregular");
-		_mmc3A12NormalOscillation = newA12OscillationState;
+		// NSLog(@"PPU has changed A12 oscillation to rise on dot %d.",newA12RiseDot);
+		_mmc3A12RiseDot = newA12RiseDot;
 		[_cpu setNextIRQ:[self _cpuCyclesBeforeIRQ]];
 	}
 }
 
+// Exact reference for the closed-form counter, stepped by the PPU on every A12 rise it actually performs
+- (void)_referenceA12RiseOnCycle:(uint_fast32_t)cycle
+{
+	if (_referenceReloadIRQCounter || (_referenceIRQCounter == 0)) {
+		
+		_referenceIRQCounter = _mmc3IRQCounterReloadValue;
+		_referenceReloadIRQCounter = NO;
+	}
+	else _referenceIRQCounter--;
+	
+	if ((_referenceIRQCounter == 0) && _mmc3IRQEnabled && (cycle != _predictedIRQCycle)) {
+		
+		_irqPredictionMismatches++;
+		NSLog(@"MMC3 IRQ prediction diverged: the counter reached zero on PPU cycle %lu, predicted %lu.",(unsigned long)cycle,(unsigned long)_predictedIRQCycle);
+	}
+}
+
+static void mmc3ReferenceA12Rise(void *context, const PPUState *state) {
+	
+	[(NESTxROMCartridge *)context _referenceA12RiseOnCycle:state->cycle];
+}
+
+- (void)setValidatesIRQPrediction:(BOOL)flag
+{
+	_validatesIRQPrediction = flag;
+	_referenceIRQCounter = _mmc3IRQCounter;
+	_referenceReloadIRQCounter = _mmc3ReloadIRQCounter;
+	[_ppu setHook:NESPPUA12RiseHook function:(flag ? mmc3ReferenceA12Rise : NULL) context:self];
+}
+
+- (BOOL)validatesIRQPrediction
+{
+	return _validatesIRQPrediction;
+}
+
+- (uint_fast32_t)irqPredictionMismatches
+{
+	return _irqPredictionMismatches;
+}
+
 - (void)servicedInterruptOnCycle:(uint_fast32_t)cycle
 {
 	[_ppu runPPUUntilCPUCycle:cycle];
@@ -343,13 +340,11 @@
 				// CHRROM Bank Update
 				[_ppu runPPUUntilCPUCycle:cycle];
 				[self _updateCHRROMBankForRegister:_bankRegisterToUpdate];
-				[self rebuildCHRROMPointers];
 			}
 			else {
 				
 				// PRGROM Bank update
 				[self _updatePRGROMBankForRegister:_bankRegisterToUpdate];
-				[self rebuildPRGROMPointers];
 			}
 		}
 		else {
@@ -367,13 +362,11 @@
 			
 				[_ppu runPPUUntilCPUCycle:cycle];
 				[self _updateCHRROMBanks];
-				[self rebuildCHRROMPointers];
 			}
 			
 			if (_mmc3HighPRGROMSwappable != oldPRGROMBankConfiguration) {
 				
 				[self _updatePRGROMBanks];
-				[self rebuildPRGROMPointers];
 			}
 		}
 	}
@@ -388,8 +381,8 @@
 		}
 		else {
 			
-			// Mirroring
-			[_ppu changeMirroringTypeTo:(byte & 0x1 ? NESHorizontalMirroring : NESVerticalMirroring) onCycle:cycle];
+			// Mirroring (hardwired on four-screen boards)
+			if (!_iNesFlags->usesFourScreenVRAMLayout) [_ppu changeMirroringTypeTo:(byte & 0x1 ? NESHorizontalMirroring : NESVerticalMirroring) onCycle:cycle];
 		}
 	}
 	else if (address < 0xE000) {
@@ -468,9 +461,11 @@
 	_mmc3WRAMChipEnable = NO;
 	
 	_lastPPUCycle = 0;
+	_lastPPUCycleOnShortFrame = NO;
+	_predictedIRQCycle = NO_PREDICTED_IRQ;
 	_mmc3IRQCounter = 0;
 	_mmc3IRQCounterReloadValue = 0;
-	_mmc3A12NormalOscillation = NO;
+	_mmc3A12RiseDot = 0;
 	_bankRegisterToUpdate = 0;
 	_prgromIndexMask = (_iNesFlags->prgromSize / BANK_SIZE_8KB) - 1;
 	_chrromIndexMask = (_iNesFlags->chrromSize / BANK_SIZE_1KB) - 1;
@@ -483,13 +478,12 @@
 	// CPU $E000-$FFFF: 8 KB PRG ROM bank, fixed to the last bank
 	[self _switch8KBPRGROMBank:3 toBank:((_iNesFlags->prgromSize - BANK_SIZE_8KB) / BANK_SIZE_8KB)];
 	[self _updatePRGROMBanks];
-	[self rebuildPRGROMPointers];
-	
 	[self _updateCHRROMBanks];
-	[self rebuildCHRROMPointers];
 	
 	// Listen to PPU state changes that could affect A12 oscillation
-	[_ppu observeStateForTarget:self andSelector:@selector(ppuStateChanged:)];
+	[_ppu setHook:NESPPUControlChangedHook function:mmc3PPUStateChanged context:self];
+	[_ppu setHook:NESPPUFrameEndHook function:mmc3PPUStateChanged context:self];
+	[self setValidatesIRQPrediction:_validatesIRQPrediction];
 }
 
 @end
@@ -27,15 +27,10 @@
 
 - (void)writeByte:(uint8_t)byte toPRGROMwithCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle
 {	
-	uint_fast32_t bankCounter;
 	uint_fast32_t first16KprgromBank = (byte & (_iNesFlags->prgromSize > (BANK_SIZE_16KB * 8) ? 0xF : 0x7)) * (BANK_SIZE_16KB / PRGROM_BANK_SIZE);
 	
-	// Rebuild PRGROM pointers for the first 16KB
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_16KB / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter] = first16KprgromBank + bankCounter;
-	}
-	[self rebuildPRGROMPointers];
+	// Remap the first 16KB
+	[self mapPRGROMSlot:0 count:(BANK_SIZE_16KB / PRGROM_BANK_SIZE) toBank:first16KprgromBank];
 }
 
 - (void)setInitialROMPointers
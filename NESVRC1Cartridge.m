@@ -13,26 +13,12 @@
 
 - (void)_switch4KBCHRROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected4KBBank = (index & _chrromIndexMask) * BANK_SIZE_4KB / CHRROM_BANK_SIZE;
-	
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_4KB / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter + (bank * BANK_SIZE_4KB / CHRROM_BANK_SIZE)] = selected4KBBank + bankCounter;
-	}
+	[self mapCHRROMSlot:(bank * BANK_SIZE_4KB / CHRROM_BANK_SIZE) count:(BANK_SIZE_4KB / CHRROM_BANK_SIZE) toBank:((index & _chrromIndexMask) * BANK_SIZE_4KB / CHRROM_BANK_SIZE)];
 }
 
 - (void)_switch8KBPRGROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected8KBBank = (index & _prgromIndexMask) * (BANK_SIZE_8KB / PRGROM_BANK_SIZE);
-	
-	// Establish PRGROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_8KB / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter + (bank * BANK_SIZE_8KB / PRGROM_BANK_SIZE)] = selected8KBBank + bankCounter;
-	}
+	[self mapPRGROMSlot:(bank * BANK_SIZE_8KB / PRGROM_BANK_SIZE) count:(BANK_SIZE_8KB / PRGROM_BANK_SIZE) toBank:((index & _prgromIndexMask) * (BANK_SIZE_8KB / PRGROM_BANK_SIZE))];
 }
 
 - (void)writeByte:(uint8_t)byte toPRGROMwithCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle
@@ -43,7 +29,6 @@
             
             // $8000:  [.... PPPP]   PRG Reg 0 (8k @ $8000)
             [self _switch8KBPRGROMBank:0 toBank:byte & 0xF];
-            [self rebuildPRGROMPointers];
         }
     }
     else if (address < 0xA000) {
@@ -64,33 +49,30 @@
         
         [self _switch4KBCHRROMBank:0 toBank:_vrc1CHRROMRegister0];
         [self _switch4KBCHRROMBank:1 toBank:_vrc1CHRROMRegister1];
-        [self rebuildCHRROMPointers];
     }
     else if (address < 0xB000) {
         
         // $A000:  [.... PPPP]   PRG Reg 1 (8k @ $A000)
         [self _switch8KBPRGROMBank:1 toBank:byte & 0xF];
-        [self rebuildPRGROMPointers];
     }
     else if ((address < 0xD000) && (address >= 0xC000)) {
         
         // $C000:  [.... PPPP]   PRG Reg 2 (8k @ $C000)
         [self _switch8KBPRGROMBank:2 toBank:byte & 0xF];
-        [self rebuildPRGROMPointers];
     }
     else if ((address < 0xF000) && (address >= 0xE000)) {
         
         // $E000:  [.... CCCC]   Low 4 bits of CHR Reg 0 (4k @ $0000)
+        [_ppu runPPUUntilCPUCycle:cycle];
         _vrc1CHRROMRegister0 = (_vrc1CHRROMRegister0 & 0x10) | (byte & 0xF);
         [self _switch4KBCHRROMBank:0 toBank:_vrc1CHRROMRegister0];
-        [self rebuildCHRROMPointers];
     }    
     else {
         
         // $F000:  [.... CCCC]   Low 4 bits of CHR Reg 1 (4k @ $1000)
+        [_ppu runPPUUntilCPUCycle:cycle];
         _vrc1CHRROMRegister1 = (_vrc1CHRROMRegister1 & 0x10) | (byte & 0xF);
         [self _switch4KBCHRROMBank:1 toBank:_vrc1CHRROMRegister1];
-        [self rebuildCHRROMPointers];
     }
 }
 
@@ -13,26 +13,12 @@
 
 - (void)_switch1KBCHRROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected1KBBank = (index & _chrromIndexMask) * BANK_SIZE_1KB / CHRROM_BANK_SIZE;
-	
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_1KB / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter + (bank * BANK_SIZE_1KB / CHRROM_BANK_SIZE)] = selected1KBBank + bankCounter;
-	}
+	[self mapCHRROMSlot:bank count:1 toBank:(index & _chrromIndexMask)];
 }
 
 - (void)_switch8KBPRGROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected8KBBank = (index & _prgromIndexMask) * (BANK_SIZE_8KB / PRGROM_BANK_SIZE);
-	
-	// Establish PRGROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_8KB / PRGROM_BANK_SIZE); bankCounter++) {
-		
-		_prgromBankIndices[bankCounter + (bank * BANK_SIZE_8KB / PRGROM_BANK_SIZE)] = selected8KBBank + bankCounter;
-	}
+	[self mapPRGROMSlot:(bank * BANK_SIZE_8KB / PRGROM_BANK_SIZE) count:(BANK_SIZE_8KB / PRGROM_BANK_SIZE) toBank:((index & _prgromIndexMask) * (BANK_SIZE_8KB / PRGROM_BANK_SIZE))];
 }
 
 - (void)_switchVRC2CHRROMBankWithByte:(uint8_t)byte andCPUAddress:(uint16_t)address
@@ -61,7 +47,6 @@
             
             // $8000-$8003:  [.... PPPP]   PRG Reg 0 (select 8k @ $8000)
             [self _switch8KBPRGROMBank:0 toBank:byte];
-            [self rebuildPRGROMPointers];
         }
     }
     else if (address < 0xA000) {
@@ -101,7 +86,6 @@
             
             // $A000-$A003:  [.... PPPP]   PRG Reg 1 (select 8k @ $A000)
             [self _switch8KBPRGROMBank:1 toBank:byte];
-            [self rebuildPRGROMPointers];
         }
     }
     else {
@@ -109,7 +93,6 @@
         // $B000-$E003:  [.... CCCC]   CHR Regs (see CHR Setup)
         [_ppu runPPUUntilCPUCycle:cycle];
         [self _switchVRC2CHRROMBankWithByte:byte andCPUAddress:address];
-        [self rebuildCHRROMPointers];
     }
 }
 
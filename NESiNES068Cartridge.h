@@ -13,5 +13,7 @@
 {
     uint8_t _prgromIndexMask;
 	uint8_t _chrromIndexMask;
+	uint8_t _ntromRegisters[2];
+	uint8_t _nameTableControl;
 }
 @end
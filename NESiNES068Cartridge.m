@@ -13,25 +13,60 @@
 
 - (void)_switch2KBCHRROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected2KBBank = (index & _chrromIndexMask) * (BANK_SIZE_2KB / CHRROM_BANK_SIZE);
-	
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_2KB / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter + (bank * BANK_SIZE_2KB / CHRROM_BANK_SIZE)] = selected2KBBank + bankCounter;
-	}
+	[self mapCHRROMSlot:(bank * BANK_SIZE_2KB / CHRROM_BANK_SIZE) count:(BANK_SIZE_2KB / CHRROM_BANK_SIZE) toBank:((index & _chrromIndexMask) * (BANK_SIZE_2KB / CHRROM_BANK_SIZE))];
 }
 
 - (void)_switch16KBPRGROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected16KBBank = (index & _prgromIndexMask) * (BANK_SIZE_16KB / PRGROM_BANK_SIZE);
+	[self mapPRGROMSlot:(bank * BANK_SIZE_16KB / PRGROM_BANK_SIZE) count:(BANK_SIZE_16KB / PRGROM_BANK_SIZE) toBank:((index & _prgromIndexMask) * (BANK_SIZE_16KB / PRGROM_BANK_SIZE))];
+}
+
+- (void)_updateNameTables
+{
+	uint_fast8_t nameTable;
+	uint_fast8_t ntromRegister;
 	
-	// Establish PRGROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_16KB / PRGROM_BANK_SIZE); bankCounter++) {
+	if (_nameTableControl & 0x10) {
+		
+		// NT-ROM: each nametable is a 1KB CHR-ROM bank from register 0 or 1, arranged by the mirroring bits
+		for (nameTable = 0; nameTable < 4; nameTable++) {
+			
+			switch (_nameTableControl & 0x3) {
+					
+				case 0:
+					ntromRegister = nameTable & 0x1;
+					break;
+				case 1:
+					ntromRegister = nameTable >> 1;
+					break;
+				case 2:
+					ntromRegister = 0;
+					break;
+				default:
+					ntromRegister = 1;
+					break;
+			}
+			
+			[_ppu setNameTable:nameTable toPage:_chrrom + (((_ntromRegisters[ntromRegister] | 0x80) & ((_iNesFlags->chrromSize / CHRROM_BANK_SIZE) - 1)) * CHRROM_BANK_SIZE) isWritable:NO];
+		}
+	}
+	else {
 		
-		_prgromBankIndices[bankCounter + (bank * BANK_SIZE_16KB / PRGROM_BANK_SIZE)] = selected16KBBank + bankCounter;
+		switch (_nameTableControl & 0x3) {
+            
+			case 0:
+				[_ppu setMirroringType:NESVerticalMirroring];
+				break;
+			case 1:
+				[_ppu setMirroringType:NESHorizontalMirroring];
+				break;
+			case 2:
+				[_ppu setMirroringType:NESSingleScreenLowerMirroring];
+				break;
+			case 3:
+				[_ppu setMirroringType:NESSingleScreenUpperMirroring];
+				break;
+		}
 	}
 }
 
@@ -41,11 +76,14 @@
     
     _prgromIndexMask = (_iNesFlags->prgromSize / BANK_SIZE_16KB) - 1;
     _chrromIndexMask = (_iNesFlags->chrromSize / BANK_SIZE_2KB) - 1;
+    _ntromRegisters[0] = _ntromRegisters[1] = 0;
+    _nameTableControl = 0;
+    
+    // Map the nametables for the reset control value rather than keeping whatever the PPU had
+    [self _updateNameTables];
     
     // Fix 0xC000 to the last 16KB Bank
-    // [_ppu setMirroringType:NESVerticalMirroring];
     [self _switch16KBPRGROMBank:1 toBank:_prgromIndexMask];
-	[self rebuildPRGROMPointers];
 }
 
 - (void)writeByte:(uint8_t)byte toPRGROMwithCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle
@@ -87,46 +125,20 @@
         
             [self _switch2KBCHRROMBank:3 toBank:byte];
         }
-        [self rebuildCHRROMPointers];
-    }
-    else if (address == 0xC000) {
-        
-        NSLog(@"Mapper 68 Cartridge Attempted to switch NT-ROM register 0!");
-    }
-    else if (address == 0xD000) {
-        
-        NSLog(@"Mapper 68 Cartridge Attempted to switch NT-ROM register 1!");
     }
-    else if (address == 0xE000) {
+    else if (address < 0xF000) {
         
         // Run PPU to current CPU cycle before swapping
         [_ppu runPPUUntilCPUCycle:cycle];
         
-        if (byte & 0x10) {
-            
-            NSLog(@"Mapper 68 Cartridge Attempted to enable built-in NT-ROM!");
-        }
+        if (address == 0xE000) _nameTableControl = byte;
+        else _ntromRegisters[(address - 0xC000) >> 12] = byte;
         
-        switch (byte & 0x3) {
-            
-            case 0:
-                [_ppu setMirroringType:NESVerticalMirroring];
-                break;
-            case 1:
-                [_ppu setMirroringType:NESHorizontalMirroring];
-                break;
-            case 2:
-                [_ppu setMirroringType:NESSingleScreenLowerMirroring];
-                break;
-            case 3:
-                [_ppu setMirroringType:NESSingleScreenUpperMirroring];
-                break;
-        }
+        [self _updateNameTables];
     }
     else {
      
         [self _switch16KBPRGROMBank:0 toBank:byte];
-        [self rebuildPRGROMPointers];
     }
 }
 
@@ -13,14 +13,7 @@
 
 - (void)_switch4KBCHRROMBank:(uint_fast32_t)bank toBank:(uint_fast32_t)index
 {
-	uint_fast32_t bankCounter;
-	uint_fast32_t selected4KBBank = index * BANK_SIZE_4KB / CHRROM_BANK_SIZE;
-	    
-	// Rebuild CHRROM indices
-	for (bankCounter = 0; bankCounter < (BANK_SIZE_4KB / CHRROM_BANK_SIZE); bankCounter++) {
-		
-		_chrromBankIndices[bankCounter + (bank * BANK_SIZE_4KB / CHRROM_BANK_SIZE)] = selected4KBBank + bankCounter;
-	}
+	[self mapCHRROMSlot:(bank * BANK_SIZE_4KB / CHRROM_BANK_SIZE) count:(BANK_SIZE_4KB / CHRROM_BANK_SIZE) toBank:(index * BANK_SIZE_4KB / CHRROM_BANK_SIZE)];
 }
 
 - (void)writeByte:(uint8_t)byte toWRAMwithCPUAddress:(uint16_t)address onCycle:(uint_fast32_t)cycle
@@ -39,8 +32,6 @@
     
     // Swap low 4KB CHRROM bank
     [self _switch4KBCHRROMBank:0 toBank:(byte & 0x7) & ((_iNesFlags->chrromSize / BANK_SIZE_4KB) - 1)];
-    
-    [self rebuildCHRROMPointers];
 }
 
 @end
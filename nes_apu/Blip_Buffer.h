@@ -194,6 +194,7 @@ class Blip_Impulse_ {
 	bool    generate;
 	
 	void fine_volume_unit();
+	void generate_impulse();
 	void scale_impulse( int unit, imp_t* ) const;
 public:
 	Blip_Buffer*    buf;
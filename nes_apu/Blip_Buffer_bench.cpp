@@ -0,0 +1,270 @@
+// Blip_Buffer::read_samples() benchmark: the scalar integrator against an SSE2 candidate
+
+// Not part of the application target. Build and run from the repository root with:
+//
+//	c++ -O2 -include climits -include assert.h -Ines_apu -Ines_apu/boost nes_apu/Blip_Buffer_bench.cpp
+//		nes_apu/Blip_Buffer.cpp nes_apu/Nes_Apu.cpp nes_apu/Nes_Oscs.cpp nes_apu/apu_snapshot.cpp
+//		-o Blip_Buffer_bench && ./Blip_Buffer_bench
+//
+// (The two -include flags supply headers the library's sources assume, which newer compilers no longer pull in.)
+//
+// Each frame, Nes_Apu plays the four tone channels at random settings into two identical Blip_Buffers. One is read
+// with read_samples(); the raw samples of the other are read with the SSE2 candidate, and the two must match sample for
+// sample. A second pass drives a Blip_Synth past full scale so both clamps are compared too.
+//
+// The timing loop reads a frame at a time, each read followed by the remove_samples() that read_samples() ends with.
+// read_samples() is timed alongside a copy of its loop built here, since the same loop can measure differently from
+// one translation unit to another; the candidate is judged against the copy, and the copy against the original.
+
+#include "Blip_Buffer.h"
+#include "Blip_Synth.h"
+#include "Nes_Apu.h"
+
+#include <emmintrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef Blip_Buffer::buf_t_ buf_t_;
+
+const int accum_fract = 15;
+const int sample_offset = 0x7F7F;
+const int timing_frames = 20000;
+const int timing_rounds = 25;
+
+// The loop in read_samples(), mono
+static long read_scalar( const buf_t_* buf, blip_sample_t* out, long count, long accum, int bass_shift )
+{
+	for ( long n = count; n--; ) {
+		long s = accum >> accum_fract;
+		accum -= accum >> bass_shift;
+		accum += (long (*buf++) - sample_offset) << accum_fract;
+		*out++ = (blip_sample_t) s;
+		
+		if ( (BOOST::int16_t) s != s )
+			out [-1] = blip_sample_t (0x7FFF - (s >> 24));
+	}
+	return accum;
+}
+
+// Widens and offsets eight deltas at a time, runs the serial accumulator over them, then saturates eight outputs at
+// once. packs matches the scalar clamp while outputs stay within 24 bits.
+static long read_sse2( const buf_t_* buf, blip_sample_t* out, long count, long accum, int bass_shift )
+{
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const offset = _mm_set1_epi32( sample_offset );
+	long n = count;
+	
+	for ( ; n >= 8; n -= 8 ) {
+		__m128i raw = _mm_loadu_si128( (__m128i const*) buf );
+		BOOST::int32_t deltas [8];
+		BOOST::int32_t samples [8];
+		
+		_mm_storeu_si128( (__m128i*) deltas, _mm_slli_epi32( _mm_sub_epi32(
+				_mm_unpacklo_epi16( raw, zero ), offset ), accum_fract ) );
+		_mm_storeu_si128( (__m128i*) (deltas + 4), _mm_slli_epi32( _mm_sub_epi32(
+				_mm_unpackhi_epi16( raw, zero ), offset ), accum_fract ) );
+		for ( int i = 0; i < 8; i++ ) {
+			samples [i] = BOOST::int32_t (accum >> accum_fract);
+			accum -= accum >> bass_shift;
+			accum += deltas [i];
+		}
+		
+		_mm_storeu_si128( (__m128i*) out, _mm_packs_epi32( _mm_loadu_si128( (__m128i const*) samples ),
+				_mm_loadu_si128( (__m128i const*) (samples + 4) ) ) );
+		buf += 8;
+		out += 8;
+	}
+	
+	return read_scalar( buf, out, n, accum, bass_shift );
+}
+
+static double seconds()
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static long compare_apu( long rate, int frames, unsigned seed )
+{
+	Blip_Buffer reference, candidate;
+	Nes_Apu reference_apu, candidate_apu;
+	blip_sample_t expected [4096], actual [4096];
+	long accum = 0;
+	long mismatches = 0;
+	
+	srand( seed );
+	reference.sample_rate( rate, 100 );
+	candidate.sample_rate( rate, 100 );
+	reference.clock_rate( 1789773 );
+	candidate.clock_rate( 1789773 );
+	reference_apu.output( &reference );
+	candidate_apu.output( &candidate );
+	
+	for ( int frame = 0; frame < frames; frame++ ) {
+		for ( int write = 0; write < 16; write++ ) {
+			cpu_time_t time = write * 1860;
+			cpu_addr_t address = 0x4000 + (rand() % 16);
+			int data = rand() & 0xFF;
+			
+			if ( address == 0x4010 || address == 0x4011 || address == 0x4012 || address == 0x4013 )
+				continue; // leave the DMC idle; it has no memory to read here
+			reference_apu.write_register( time, 0x4015, 0x0F );
+			candidate_apu.write_register( time, 0x4015, 0x0F );
+			reference_apu.write_register( time, address, data );
+			candidate_apu.write_register( time, address, data );
+		}
+		
+		reference_apu.end_frame( 29781 );
+		candidate_apu.end_frame( 29781 );
+		reference.end_frame( 29781 );
+		candidate.end_frame( 29781 );
+		
+		long count = candidate.samples_avail();
+		Blip_Reader reader;
+		int bass_shift = reader.begin( candidate );
+		accum = read_sse2( candidate.buffer_, actual, count, accum, bass_shift );
+		candidate.remove_samples( count );
+		
+		if ( reference.read_samples( expected, count ) != count )
+			return -1;
+		for ( long i = 0; i < count; i++ )
+			if ( expected [i] != actual [i] )
+				mismatches++;
+	}
+	
+	return mismatches;
+}
+
+// Full-scale steps every few samples, well past what 16 bits hold, to exercise both clamps
+static long compare_clipping( long rate, int frames, unsigned seed )
+{
+	Blip_Buffer reference, candidate;
+	Blip_Synth<blip_good_quality,15> synth;
+	blip_sample_t expected [4096], actual [4096];
+	long accum = 0;
+	long mismatches = 0;
+	long clipped = 0;
+	int amplitude = 0;
+	
+	srand( seed );
+	reference.sample_rate( rate, 100 );
+	candidate.sample_rate( rate, 100 );
+	reference.clock_rate( 1789773 );
+	candidate.clock_rate( 1789773 );
+	synth.volume( 3.0 );
+	
+	for ( int frame = 0; frame < frames; frame++ ) {
+		for ( blip_time_t time = rand() % 200; time < 29781; time += 100 + rand() % 400 ) {
+			int delta = (rand() % 31) - 15 - amplitude / 4;
+			amplitude += delta;
+			synth.offset( time, delta, &reference );
+			synth.offset( time, delta, &candidate );
+		}
+		
+		reference.end_frame( 29781 );
+		candidate.end_frame( 29781 );
+		
+		long count = candidate.samples_avail();
+		Blip_Reader reader;
+		int bass_shift = reader.begin( candidate );
+		accum = read_sse2( candidate.buffer_, actual, count, accum, bass_shift );
+		candidate.remove_samples( count );
+		
+		if ( reference.read_samples( expected, count ) != count )
+			return -1;
+		for ( long i = 0; i < count; i++ ) {
+			if ( expected [i] != actual [i] )
+				mismatches++;
+			if ( expected [i] == 0x7FFF || expected [i] == -0x8000 )
+				clipped++;
+		}
+	}
+	
+	printf( "  %ld clipped samples compared\n", clipped );
+	return mismatches;
+}
+
+typedef long (*integrator_t)( const buf_t_*, blip_sample_t*, long, long, int );
+
+// A frame's worth of raw samples is copied in and made available before each read, the same for every reader. With no
+// integrator given, read_samples() does the reading.
+static double time_frames( Blip_Buffer& source, const buf_t_* raw, long count, integrator_t integrator, long* sink )
+{
+	size_t raw_size = (count + Blip_Buffer::widest_impulse_ + 1) * sizeof (buf_t_);
+	blip_sample_t out [4096];
+	Blip_Reader reader;
+	int bass_shift = reader.begin( source );
+	long accum = 0;
+	double start = seconds();
+	
+	for ( int frame = 0; frame < timing_frames; frame++ ) {
+		memcpy( source.buffer_, raw, raw_size );
+		source.offset_ = Blip_Buffer::resampled_time_t (count) << BLIP_BUFFER_ACCURACY;
+		if ( integrator ) {
+			accum = integrator( source.buffer_, out, count, accum, bass_shift );
+			source.remove_samples( count );
+		}
+		else {
+			source.read_samples( out, count );
+		}
+		*sink += out [frame & 0xFF];
+	}
+	
+	return seconds() - start;
+}
+
+static void time_integrators( long rate )
+{
+	static const integrator_t integrators [3] = { NULL, read_scalar, read_sse2 };
+	Blip_Buffer source;
+	long count = rate / 60;
+	buf_t_* raw = new buf_t_ [count + Blip_Buffer::widest_impulse_ + 1];
+	double best [3] = { 1e9, 1e9, 1e9 };
+	long sink = 0;
+	
+	source.sample_rate( rate, 100 );
+	source.clock_rate( 1789773 );
+	
+	srand( 1 );
+	for ( long i = 0; i < count + Blip_Buffer::widest_impulse_ + 1; i++ )
+		raw [i] = (buf_t_) (sample_offset + (rand() % 4001) - 2000);
+	
+	// Interleave the readers so clock changes and cache state land on all alike; keep each one's best
+	for ( int round = 0; round < timing_rounds; round++ ) {
+		for ( int i = 0; i < 3; i++ ) {
+			double time = time_frames( source, raw, count, integrators [i], &sink );
+			if ( time < best [i] )
+				best [i] = time;
+		}
+	}
+	
+	double samples = (double) count * timing_frames;
+	printf( "%6ld Hz: read_samples() %.3f, copy %.3f (%+.1f%%), SSE2 %.3f ns/sample (%+.1f%% against the copy)%s\n",
+			rate, best [0] * 1e9 / samples, best [1] * 1e9 / samples, (best [1] / best [0] - 1.0) * 100,
+			best [2] * 1e9 / samples, (best [2] / best [1] - 1.0) * 100, (sink == 42) ? " " : "" );
+	
+	delete [] raw;
+}
+
+int main()
+{
+	static const long rates [] = { 44100, 48000, 96000 };
+	long failures = 0;
+	
+	for ( int i = 0; i < 3; i++ ) {
+		long apu = compare_apu( rates [i], 3600, 1 + i );
+		printf( "%6ld Hz: %ld mismatched samples over 3600 APU frames\n", rates [i], apu );
+		long clipping = compare_clipping( rates [i], 600, 11 + i );
+		printf( "%6ld Hz: %ld mismatched samples over 600 clipping frames\n", rates [i], clipping );
+		failures += (apu != 0) + (clipping != 0);
+	}
+	
+	for ( int i = 0; i < 3; i++ )
+		time_integrators( rates [i] );
+	
+	printf( "%s\n", failures ? "FAILED" : "passed" );
+	return failures ? 1 : 0;
+}
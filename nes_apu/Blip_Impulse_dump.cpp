@@ -0,0 +1,43 @@
+
+// Generator for Blip_Impulse_tables.h. Not part of the application target. Build and run from the repository root
+// with:
+//
+//	c++ -O2 -DBLIP_DUMP_IMPULSE -include climits -include assert.h -Ines_apu -Ines_apu/boost
+//		nes_apu/Blip_Impulse_dump.cpp nes_apu/Blip_Buffer.cpp -o Blip_Impulse_dump
+//	./Blip_Impulse_dump > nes_apu/Blip_Impulse_tables.h
+//
+// (The two -include flags supply headers the library's sources assume, which newer compilers no longer pull in.)
+// Setting a synth's volume synthesizes its base impulse for the default eq, which a BLIP_DUMP_IMPULSE build of
+// Blip_Impulse_::generate_impulse() prints; this adds the rest of the header around the two tables.
+
+#ifndef BLIP_DUMP_IMPULSE
+	#error "Build with BLIP_DUMP_IMPULSE defined, or there is nothing to dump"
+#endif
+
+#include "Blip_Synth.h"
+#include "Blip_Impulse_tables.h"
+
+#include <stdio.h>
+
+int main()
+{
+	printf( "\n// Blip_Buffer 0.3.3. Copyright (C) 2003-2005 Shay Green. GNU LGPL license.\n\n" );
+	printf( "// Base impulses for Blip_Impulse_'s default treble eq, so synths using it skip the DSF synthesis.\n" );
+	printf( "// Generated by Blip_Impulse_dump.cpp; regenerate rather than edit.\n\n" );
+	printf( "#ifndef BLIP_IMPULSE_TABLES_H\n#define BLIP_IMPULSE_TABLES_H\n\n" );
+	printf( "// Default low-pass used until treble_eq() is called\n" );
+	printf( "const double blip_default_treble = %.2f;\n", blip_default_treble );
+	printf( "const long blip_default_cutoff = %ld;\n", blip_default_cutoff );
+	printf( "const long blip_default_sample_rate = %ld;\n\n", blip_default_sample_rate );
+	printf( "// Unscaled impulse (res / 2 + 1 phases of 'width' samples, res = 1 << blip_res_bits_) for the default eq at\n" );
+	printf( "// the two widths the APU synths use: blip_med_quality (8) and blip_good_quality (12).\n\n" );
+	
+	Blip_Synth<blip_med_quality,1> med;
+	med.volume( 1.0 );
+	Blip_Synth<blip_good_quality,1> good;
+	good.volume( 1.0 );
+	
+	printf( "#endif\n\n" );
+	
+	return 0;
+}
@@ -0,0 +1,59 @@
+
+// Blip_Buffer 0.3.3. Copyright (C) 2003-2005 Shay Green. GNU LGPL license.
+
+// Base impulses for Blip_Impulse_'s default treble eq, so synths using it skip the DSF synthesis.
+// Generated by Blip_Impulse_dump.cpp; regenerate rather than edit.
+
+#ifndef BLIP_IMPULSE_TABLES_H
+#define BLIP_IMPULSE_TABLES_H
+
+// Default low-pass used until treble_eq() is called
+const double blip_default_treble = -8.87;
+const long blip_default_cutoff = 8800;
+const long blip_default_sample_rate = 44100;
+
+// Unscaled impulse (res / 2 + 1 phases of 'width' samples, res = 1 << blip_res_bits_) for the default eq at
+// the two widths the APU synths use: blip_med_quality (8) and blip_good_quality (12).
+
+static const BOOST::uint16_t blip_default_impulse_8 [136] = {
+	0x403E, 0x3D44, 0x827E, 0x827E, 0x3D44, 0x403E, 0x4000, 0x4000,
+	0x4064, 0x3C8B, 0x8008, 0x84DD, 0x3E19, 0x401C, 0x3FF7, 0x4000,
+	0x4085, 0x3BED, 0x7D7E, 0x8723, 0x3F0A, 0x3FF2, 0x3FF2, 0x4000,
+	0x40A0, 0x3B69, 0x7AE3, 0x894D, 0x4018, 0x3FC0, 0x3FEF, 0x4000,
+	0x40B7, 0x3AFD, 0x783A, 0x8B59, 0x4143, 0x3F86, 0x3FF0, 0x4000,
+	0x40C9, 0x3AA9, 0x7586, 0x8D44, 0x428C, 0x3F46, 0x3FF3, 0x4000,
+	0x40D6, 0x3A6B, 0x72C8, 0x8F0C, 0x43F3, 0x3EFF, 0x3FF9, 0x4000,
+	0x40DE, 0x3A43, 0x7006, 0x90B0, 0x4577, 0x3EB2, 0x4002, 0x4000,
+	0x40E2, 0x3A2E, 0x6D40, 0x922C, 0x4718, 0x3E5F, 0x400D, 0x4000,
+	0x40E2, 0x3A2B, 0x6A7A, 0x9381, 0x48D6, 0x3E09, 0x4019, 0x4000,
+	0x40DF, 0x3A38, 0x67B6, 0x94AB, 0x4AB1, 0x3DAF, 0x4028, 0x4000,
+	0x40D8, 0x3A55, 0x64F8, 0x95A9, 0x4CA6, 0x3D53, 0x4038, 0x4000,
+	0x40CE, 0x3A7F, 0x6242, 0x967B, 0x4EB7, 0x3CF5, 0x404A, 0x4000,
+	0x40C2, 0x3AB5, 0x5F96, 0x971F, 0x50E0, 0x3C98, 0x405C, 0x4000,
+	0x40B4, 0x3AF5, 0x5CF6, 0x9795, 0x5321, 0x3C3C, 0x406E, 0x4000,
+	0x40A4, 0x3B3E, 0x5A66, 0x97DC, 0x5579, 0x3BE3, 0x4081, 0x4000,
+	0x4093, 0x3B8D, 0x57E6, 0x97F4, 0x57E6, 0x3B8D, 0x4093, 0x4000,
+};
+
+static const BOOST::uint16_t blip_default_impulse_12 [204] = {
+	0x42B5, 0x3CA4, 0x403F, 0x3D3D, 0x832C, 0x832C, 0x3D3D, 0x403F, 0x3CA4, 0x42B5, 0x4000, 0x4000,
+	0x42B5, 0x3CAF, 0x4059, 0x3C82, 0x80AF, 0x8591, 0x3E14, 0x401C, 0x3C9E, 0x42A6, 0x400B, 0x4000,
+	0x42B2, 0x3CC1, 0x406B, 0x3BE2, 0x7E1F, 0x87DD, 0x3F08, 0x3FF2, 0x3CA0, 0x4293, 0x4018, 0x4000,
+	0x42AC, 0x3CD9, 0x4075, 0x3B5D, 0x7B7E, 0x8A0D, 0x4018, 0x3FBF, 0x3CA7, 0x4279, 0x4027, 0x4000,
+	0x42A3, 0x3CF7, 0x4077, 0x3AF0, 0x78CD, 0x8C1E, 0x4147, 0x3F85, 0x3CB5, 0x425A, 0x4039, 0x4000,
+	0x4297, 0x3D1B, 0x4071, 0x3A9B, 0x7612, 0x8E0E, 0x4293, 0x3F44, 0x3CC9, 0x4236, 0x404C, 0x4000,
+	0x4288, 0x3D44, 0x4064, 0x3A5D, 0x734E, 0x8FDB, 0x43FD, 0x3EFC, 0x3CE2, 0x420D, 0x4062, 0x4000,
+	0x4277, 0x3D72, 0x4050, 0x3A34, 0x7083, 0x9183, 0x4585, 0x3EAE, 0x3D01, 0x41DF, 0x4079, 0x4000,
+	0x4263, 0x3DA5, 0x4035, 0x3A1F, 0x6DB6, 0x9304, 0x472B, 0x3E5B, 0x3D25, 0x41AD, 0x4093, 0x4000,
+	0x424C, 0x3DDD, 0x4014, 0x3A1C, 0x6AE9, 0x945B, 0x48ED, 0x3E04, 0x3D4E, 0x4177, 0x40AD, 0x4000,
+	0x4234, 0x3E18, 0x3FEE, 0x3A29, 0x681E, 0x9588, 0x4ACD, 0x3DA9, 0x3D7B, 0x413C, 0x40CA, 0x4000,
+	0x421A, 0x3E56, 0x3FC3, 0x3A46, 0x6559, 0x968A, 0x4CC8, 0x3D4C, 0x3DAB, 0x40FF, 0x40E7, 0x4000,
+	0x41FE, 0x3E97, 0x3F94, 0x3A71, 0x629C, 0x975E, 0x4EDD, 0x3CEE, 0x3DDE, 0x40BF, 0x4106, 0x4000,
+	0x41E1, 0x3EDA, 0x3F61, 0x3AA7, 0x5FE8, 0x9804, 0x510C, 0x3C8F, 0x3E14, 0x407C, 0x4125, 0x4000,
+	0x41C3, 0x3F1F, 0x3F2C, 0x3AE8, 0x5D42, 0x987B, 0x5354, 0x3C32, 0x3E4C, 0x4038, 0x4144, 0x4000,
+	0x41A4, 0x3F65, 0x3EF5, 0x3B31, 0x5AAB, 0x98C2, 0x55B2, 0x3BD8, 0x3E84, 0x3FF2, 0x4164, 0x4000,
+	0x4184, 0x3FAC, 0x3EBD, 0x3B82, 0x5825, 0x98DA, 0x5825, 0x3B82, 0x3EBD, 0x3FAC, 0x4184, 0x4000,
+};
+
+#endif
+
@@ -33,12 +33,19 @@ Nes_Apu::Nes_Apu()
 	output( NULL );
 	volume( 1.0 );
 	reset( false );
+	clear_idle_clocks();
 }
 
 Nes_Apu::~Nes_Apu()
 {
 }
 
+void Nes_Apu::clear_idle_clocks()
+{
+	for ( int i = 0; i < osc_count; i++ )
+		oscs [i]->idle_clocks = 0;
+}
+
 void Nes_Apu::treble_eq( const blip_eq_t& eq )
 {
 	square_synth.treble_eq( eq );
@@ -19,7 +19,9 @@ public:
 	Nes_Apu();
 	~Nes_Apu();
 	
-	// Set buffer to generate all sound into, or disable sound if NULL
+	// Set buffer to generate all sound into, or disable sound if NULL. Without
+	// a buffer nothing is synthesized, but everything the CPU can observe
+	// (length counters, frame and DMC IRQs, DMC sample fetches) still runs.
 	void output( Blip_Buffer* );
 	
 	// Set memory reader callback used by DMC oscillator to fetch samples.
@@ -68,7 +70,8 @@ public:
 	void treble_eq( const blip_eq_t& );
 	
 	// Set sound output of specific oscillator to buffer. If buffer is NULL,
-	// the specified oscillator is muted and emulation accuracy is reduced.
+	// the specified oscillator is muted and stops tracking its waveform
+	// phase (a muted DMC still fetches samples).
 	// The oscillators are indexed as follows: 0) Square 1, 1) Square 2,
 	// 2) Triangle, 3) Noise, 4) DMC.
 	enum { osc_count = 5 };
@@ -91,10 +94,20 @@ public:
 	// 'count_dmc_reads( time )' would result in the same result.
 	int count_dmc_reads( cpu_time_t t, cpu_time_t* last_read = NULL ) const;
 	
+	// Earliest time t for which 'count_dmc_reads( t )' is non-zero, or no_irq
+	// if the DMC isn't reading. Changes only on register reads and writes and
+	// when the DMC actually reads.
+	cpu_time_t next_dmc_read() const;
+	
 	// Run APU until specified time, so that any DMC memory reads can be
 	// accounted for (i.e. inserting CPU wait states).
 	void run_until( cpu_time_t );
 	
+	// Number of clocks the specified oscillator (indexed as for osc_output())
+	// skipped over without synthesizing because it was silent or halted.
+	long idle_clocks( int index ) const;
+	void clear_idle_clocks();
+	
 // End of public interface.
 private:
 	friend class Nes_Nonlinearizer;
@@ -136,6 +149,12 @@ inline void Nes_Apu::osc_output( int osc, Blip_Buffer* buf )
 	oscs [osc]->output = buf;
 }
 
+inline long Nes_Apu::idle_clocks( int osc ) const
+{
+	assert(( "Nes_Apu::idle_clocks(): Index out of range", 0 <= osc && osc < osc_count ));
+	return oscs [osc]->idle_clocks;
+}
+
 inline cpu_time_t Nes_Apu::earliest_irq() const
 {
 	return earliest_irq_;
@@ -157,6 +176,11 @@ inline int Nes_Apu::count_dmc_reads( cpu_time_t time, cpu_time_t* last_read ) co
 {
 	return dmc.count_reads( time, last_read );
 }
+
+inline cpu_time_t Nes_Apu::next_dmc_read() const
+{
+	return dmc.next_read();
+}
 	
 #endif
 
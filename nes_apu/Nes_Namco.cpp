@@ -29,6 +29,7 @@ Nes_Namco::~Nes_Namco()
 
 void Nes_Namco::reset()
 {
+	last_time = 0;
 	addr_reg = 0;
 	
 	int i;
@@ -124,11 +125,21 @@ void Nes_Namco::run_until( cpu_time_t nes_end_time )
 			int last_amp = osc.last_amp;
 			int wave_pos = osc.wave_pos;
 			
-			do
+			// A channel whose wave is flat at its current level can't output anything,
+			// so step over the span at once. Only checked for spans covering at least
+			// a whole wave, where scanning the wave costs less than stepping through it.
+			if ( wave_pos < wave_size && (end_time - time) / period >= (Blip_Buffer::resampled_time_t) wave_size &&
+					flat_wave( osc_reg [6], wave_size, volume, last_amp ) )
+			{
+				long count = (end_time - time + period - 1) / period;
+				wave_pos = (wave_pos + count) % wave_size;
+				time += count * period;
+			}
+			else do
 			{
 				// read wave sample
 				int addr = wave_pos + osc_reg [6];
-				int sample = reg [addr >> 1];
+				int sample = reg [(addr >> 1) & (reg_count - 1)]; // wave RAM wraps
 				wave_pos++;
 				if ( addr & 1 )
 					sample >>= 4;
@@ -158,3 +169,17 @@ void Nes_Namco::run_until( cpu_time_t nes_end_time )
 	last_time = nes_end_time;
 }
 
+// True if every sample of the wave at nybble address 'start' plays at 'amp'
+bool Nes_Namco::flat_wave( int start, int wave_size, int volume, int amp ) const
+{
+	for ( int addr = start; addr < start + wave_size; addr++ )
+	{
+		int sample = reg [(addr >> 1) & (reg_count - 1)];
+		if ( addr & 1 )
+			sample >>= 4;
+		if ( (sample & 15) * volume != amp )
+			return false;
+	}
+	return true;
+}
+
@@ -60,6 +60,7 @@ private:
 	
 	BOOST::uint8_t& access();
 	void run_until( cpu_time_t );
+	bool flat_wave( int start, int wave_size, int volume, int amp ) const;
 };
 
 inline void Nes_Namco::volume( double v ) { synth.volume( 0.10 / osc_count * v ); }
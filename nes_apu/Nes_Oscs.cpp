@@ -93,6 +93,8 @@ void Nes_Square::run( cpu_time_t time, cpu_time_t end_time )
 	const int timer_period = (period + 1) * 2;
 	if ( volume == 0 || period < 8 || (period + offset) >= 0x800 )
 	{
+		idle_clocks += end_time - time;
+		
 		if ( last_amp ) {
 			synth->offset( time, -last_amp, output );
 			last_amp = 0;
@@ -183,13 +185,14 @@ void Nes_Triangle::run( cpu_time_t time, cpu_time_t end_time )
 	if ( delta )
 		synth.offset( time, delta, output );
 	
-	time += delay;
 	const int timer_period = period() + 1;
 	if ( length_counter == 0 || linear_counter == 0 || timer_period < 3 )
 	{
+		// sequencer is halted (or ultrasonic), so there is no phase to maintain
+		idle_clocks += end_time - time;
 		time = end_time;
 	}
-	else if ( time < end_time )
+	else if ( (time += delay) < end_time )
 	{
 		Blip_Buffer* const output = this->output;
 		
@@ -279,6 +282,15 @@ int Nes_Dmc::count_reads( cpu_time_t time, cpu_time_t* last_read ) const
 	return count;
 }
 
+cpu_time_t Nes_Dmc::next_read() const
+{
+	if ( length_counter == 0 )
+		return Nes_Apu::no_irq; // not reading
+	
+	// the read happens on the clock that empties the shift register, which run_until() covers once past it
+	return apu->last_time + delay + long (bits_remain - 1) * period + 1;
+}
+
 static const short dmc_period_table [2] [16] = {
 	0x1ac, 0x17c, 0x154, 0x140, 0x11e, 0x0fe, 0x0e2, 0x0d6, // NTSC
 	0x0be, 0x0a0, 0x08e, 0x080, 0x06a, 0x054, 0x048, 0x036,
@@ -309,7 +321,10 @@ void Nes_Dmc::write_register( int addr, int data )
 	if ( addr == 0 ) {
 		period = dmc_period_table [pal_mode] [data & 15];
 		irq_enabled = (data & 0xc0) == 0x80; // enabled only if loop disabled
-		irq_flag &= irq_enabled;
+		if ( irq_flag && !irq_enabled ) {
+			irq_flag = false;
+			apu->irq_changed(); // acknowledged
+		}
 		recalc_irq();
 	}
 	else if ( addr == 1 )
@@ -358,10 +373,52 @@ void Nes_Dmc::fill_buffer()
 	}
 }
 
+// Without output only what the CPU can observe matters, so this steps from byte to byte: the fetches, the
+// IRQ and the timing count_reads() relies on, but not the DAC
+void Nes_Dmc::run_fetches( cpu_time_t time, cpu_time_t end_time )
+{
+	time += delay;
+	while ( time < end_time )
+	{
+		if ( silence && buf_empty )
+		{
+			int count = (end_time - time + period - 1) / period;
+			bits_remain = (bits_remain - 1 + 8 - (count % 8)) % 8 + 1;
+			time += count * period;
+			break;
+		}
+		
+		// clock that empties the shift register
+		cpu_time_t last_bit = time + cpu_time_t (bits_remain - 1) * period;
+		if ( last_bit >= end_time )
+		{
+			int count = (end_time - time + period - 1) / period;
+			bits_remain -= count;
+			time += count * period;
+			break;
+		}
+		
+		time = last_bit + period;
+		bits_remain = 8;
+		if ( buf_empty ) {
+			silence = true;
+		}
+		else {
+			silence = false;
+			bits = buf;
+			buf_empty = true;
+			fill_buffer();
+		}
+	}
+	delay = time - end_time;
+}
+
 void Nes_Dmc::run( cpu_time_t time, cpu_time_t end_time )
 {
-	if ( !output )
+	if ( !output ) {
+		run_fetches( time, end_time );
 		return;
+	}
 	
 	int delta = update_amp( dac );
 	if ( delta )
@@ -373,6 +430,7 @@ void Nes_Dmc::run( cpu_time_t time, cpu_time_t end_time )
 		int bits_remain = this->bits_remain;
 		if ( silence && buf_empty )
 		{
+			idle_clocks += end_time - time;
 			int count = (end_time - time + period - 1) / period;
 			bits_remain = (bits_remain - 1 + 8 - (count % 8)) % 8 + 1;
 			time += count * period;
@@ -432,6 +490,62 @@ static const short noise_period_table [16] = {
 	0x0CA, 0x0FE, 0x17C, 0x1FC, 0x2FA, 0x3F8, 0x7F2, 0xFE4
 };
 
+// Noise register advanced 2^k clocks, looked up a nibble at a time. The register repeats every 32767 clocks
+// in long mode and every 93 in short mode, so a muted run of any length takes at most 15 jumps.
+struct Nes_Noise_Jumps {
+	enum { max_jumps = 15 };
+	unsigned short nibbles [2] [max_jumps] [4] [16]; // [short mode] [k] [nibble] [nibble value]
+	
+	Nes_Noise_Jumps();
+	int jump( int noise, int short_mode, int k ) const {
+		const unsigned short (*t) [16] = nibbles [short_mode] [k];
+		return t [0] [noise & 15] ^ t [1] [noise >> 4 & 15] ^ t [2] [noise >> 8 & 15] ^ t [3] [noise >> 12];
+	}
+	int advance( int noise, int short_mode, long count ) const;
+};
+
+Nes_Noise_Jumps::Nes_Noise_Jumps()
+{
+	for ( int mode = 0; mode < 2; mode++ )
+	{
+		// where each register bit ends up after one clock, then 2, 4, ...
+		const int tap = (mode ? 8 : 13);
+		int bits [15];
+		for ( int b = 0; b < 15; b++ ) {
+			int feedback = ((1 << b) << tap) ^ ((1 << b) << 14);
+			bits [b] = (feedback & 0x4000) | ((1 << b) >> 1);
+		}
+		
+		for ( int k = 0; k < max_jumps; k++ )
+		{
+			for ( int n = 0; n < 4; n++ ) {
+				for ( int v = 0; v < 16; v++ ) {
+					int out = 0;
+					for ( int b = 0; b < 4; b++ )
+						if ( (v >> b & 1) && n * 4 + b < 15 )
+							out ^= bits [n * 4 + b];
+					nibbles [mode] [k] [n] [v] = (unsigned short) out;
+				}
+			}
+			
+			// applying this jump twice gives the next one
+			for ( int b = 0; b < 15; b++ )
+				bits [b] = jump( bits [b], mode, k );
+		}
+	}
+}
+
+int Nes_Noise_Jumps::advance( int noise, int short_mode, long count ) const
+{
+	count %= (short_mode ? 93 : 32767);
+	for ( int k = 0; count; k++, count >>= 1 )
+		if ( count & 1 )
+			noise = jump( noise, short_mode, k );
+	return noise;
+}
+
+static const Nes_Noise_Jumps noise_jumps;
+
 void Nes_Noise::run( cpu_time_t time, cpu_time_t end_time )
 {
 	if ( !output )
@@ -451,15 +565,12 @@ void Nes_Noise::run( cpu_time_t time, cpu_time_t end_time )
 		int period = noise_period_table [regs [2] & 15];
 		if ( !volume )
 		{
-			// round to next multiple of period
-			time += (end_time - time + period - 1) / period * period;
+			idle_clocks += end_time - time;
 			
-			// approximate noise cycling while muted, by shuffling up noise register
-			// to do: precise muted noise cycling?
-			if ( !(regs [2] & mode_flag) ) {
-				int feedback = (noise << 13) ^ (noise << 14);
-				noise = (feedback & 0x4000) | (noise >> 1);
-			}
+			// round to next multiple of period, jumping the noise register the same number of clocks
+			long count = (end_time - time + period - 1) / period;
+			time += count * period;
+			noise = noise_jumps.advance( noise, (regs [2] & mode_flag) != 0, count );
 		}
 		else
 		{
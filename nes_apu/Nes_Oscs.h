@@ -18,6 +18,7 @@ struct Nes_Osc
 	int length_counter;// length counter (0 if unused by oscillator)
 	int delay;      // delay until next (potential) transition
 	int last_amp;   // last amplitude oscillator was outputting
+	long idle_clocks; // clocks skipped over without synthesis while silent or halted
 	
 	void clock_length( int halt_mask );
 	int period() const {
@@ -131,11 +132,13 @@ struct Nes_Dmc : Nes_Osc
 	void start();
 	void write_register( int, int );
 	void run( cpu_time_t, cpu_time_t );
+	void run_fetches( cpu_time_t, cpu_time_t );
 	void recalc_irq();
 	void fill_buffer();
 	void reload_sample();
 	void reset();
 	int count_reads( cpu_time_t, cpu_time_t* ) const;
+	cpu_time_t next_read() const;
 };
 
 #endif